@@ -1,7 +1,7 @@
 #include <XE_MIDI.h>
 
 #if defined(USBCON)
-#include <midi_UsbTransport.h>
+#include <XE_MIDI_UsbTransport.h>
 
 static const unsigned sUsbTransportBufferSize = 16;
 typedef midi::UsbTransport<sUsbTransportBufferSize> UsbTransport;
@@ -39,5 +39,15 @@ void setup() {
 }
 
 void loop() {
+#if defined(USBCON)
+    // Decode USB-MIDI packets directly, without going through the byte parser.
+    midi::UsbMidiEventPacket packet;
+    while (sUsbTransport.readPacket(packet)) {
+        MIDI.read(packet);
+    }
+    // Send the packets queued during this loop in a single transfer.
+    sUsbTransport.flush();
+#else
     MIDI.read();
+#endif
 }
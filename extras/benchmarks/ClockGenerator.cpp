@@ -0,0 +1,285 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+/*
+  Host benchmark: timing of MIDI clock generation, in virtual time, with a
+  loop() of varying load.
+
+  Each loop iteration costs 20 to 200 us, 2 ms one time in five (eg: a
+  display refresh) and 8 ms one time in a hundred (eg: an SD card write).
+  An hour of clock is generated at several tempos by:
+  - millis() delta: if (millis() - last >= ms) { last = millis(); send },
+  - micros() delta: the same with micros(),
+  - micros() grid:  if (micros() - last >= us) { last += us; send },
+  - ClockGenerator (see XE_MIDI_ClockGenerator.h).
+  The tick times are compared to the ideal grid: drift at the end of the
+  hour, lateness of ticks, and jitter of the intervals between them.
+  Then ClockGenerator fan-out, transport and the cost of update() are
+  checked.
+
+  Build & run from this directory:
+    c++ -O2 -I../../src -I../host ClockGenerator.cpp ../../src/XE_MIDI.cpp -o ClockGenerator
+    ./ClockGenerator
+*/
+
+#include <XE_MIDI.h>
+#include <XE_MIDI_ClockGenerator.h>
+#include <MockSerial.h>
+#include <UartSimulator.h>
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <vector>
+
+using midi::SimulatedTime;
+using midi::VirtualClock;
+
+static const SimulatedTime sDuration = 3600000000ULL;  // 1 hour
+static const unsigned long sTimeOffset = 0xf0000000UL; // micros() wraps around during the run
+
+/*! Records the virtual time of the Clock messages it is sent. */
+class TickRecorder
+{
+  public:
+    explicit TickRecorder(const VirtualClock& inClock)
+      : mClock(inClock)
+      , mSongPosition(0)
+    {
+    }
+
+    void sendRealTime(midi::MidiType inType)
+    {
+      if (inType == midi::Clock)
+      {
+        mTicks.push_back(mClock.now());
+      }
+      mTransport.push_back(inType);
+    }
+
+    void sendSongPosition(unsigned inBeats)
+    {
+      mSongPosition = inBeats;
+    }
+
+    const std::vector<SimulatedTime>& getTicks() const { return mTicks; }
+    const std::vector<midi::MidiType>& getTransport() const { return mTransport; }
+    unsigned getSongPosition() const { return mSongPosition; }
+
+  private:
+    const VirtualClock& mClock;
+    std::vector<SimulatedTime> mTicks;
+    std::vector<midi::MidiType> mTransport;
+    unsigned mSongPosition;
+};
+
+/*! Cost of a loop() iteration. */
+class LoopLoad
+{
+  public:
+    LoopLoad() : mRandom(1) {}
+
+    SimulatedTime next()
+    {
+      const unsigned draw = mRandom() % 100;
+      const SimulatedTime base = 20 + mRandom() % 181;
+      return draw == 0 ? base + 8000 : draw < 20 ? base + 2000 : base;
+    }
+
+  private:
+    std::mt19937 mRandom;
+};
+
+enum Method
+{
+  MillisDelta,
+  MicrosDelta,
+  MicrosGrid,
+  Generator,
+};
+
+static std::vector<SimulatedTime> generateTicks(Method inMethod, unsigned long inHundredthsOfBpm)
+{
+  VirtualClock clock;
+  TickRecorder recorder(clock);
+  midi::ClockGenerator<TickRecorder> generator(recorder);
+  generator.setBpm(inHundredthsOfBpm);
+
+  const double period        = 250000000.0 / inHundredthsOfBpm;
+  const unsigned long millis = (unsigned long)(period / 1000 + 0.5);
+  const unsigned long micros = (unsigned long)(period + 0.5);
+  unsigned long last = sTimeOffset;
+  LoopLoad load;
+
+  generator.start(sTimeOffset);
+  while (clock.now() < sDuration)
+  {
+    const unsigned long now = (unsigned long)(clock.now() + sTimeOffset);
+    switch (inMethod)
+    {
+      case MillisDelta:
+        if (now / 1000 - last / 1000 >= millis)
+        {
+          last = now;
+          recorder.sendRealTime(midi::Clock);
+        }
+        break;
+      case MicrosDelta:
+        if (now - last >= micros)
+        {
+          last = now;
+          recorder.sendRealTime(midi::Clock);
+        }
+        break;
+      case MicrosGrid:
+        while (now - last >= micros)
+        {
+          last += micros;
+          recorder.sendRealTime(midi::Clock);
+        }
+        break;
+      case Generator:
+        generator.update(now);
+        break;
+    }
+    clock.advance(load.next());
+  }
+  return recorder.getTicks();
+}
+
+static double getPercentile(std::vector<double> ioValues, double inPercentile)
+{
+  std::sort(ioValues.begin(), ioValues.end());
+  return ioValues[size_t(inPercentile / 100 * (ioValues.size() - 1))];
+}
+
+static void report(const char* inName, const std::vector<SimulatedTime>& inTicks,
+                   unsigned long inHundredthsOfBpm)
+{
+  const double period = 250000000.0 / inHundredthsOfBpm;
+  const double ideal  = sDuration / period;
+
+  // Tick n is due at n * period. The first ones of millis() delta wait
+  // for the first interval.
+  std::vector<double> lateness;
+  std::vector<double> jitter;
+  for (size_t i = 0; i < inTicks.size(); ++i)
+  {
+    lateness.push_back(inTicks[i] - i * period);
+    if (i > 0)
+    {
+      jitter.push_back(fabs(double(inTicks[i] - inTicks[i - 1]) - period));
+    }
+  }
+
+  printf("  %-16s %8zu ticks (%+7.0f) drift %+10.1f ms  lateness p50 %8.0f  p99 %8.0f  max %8.0f us  "
+         "interval error p99 %6.0f  max %6.0f us\n",
+         inName, inTicks.size(), inTicks.size() - ideal, lateness.back() / 1000,
+         getPercentile(lateness, 50), getPercentile(lateness, 99), getPercentile(lateness, 100),
+         getPercentile(jitter, 99), getPercentile(jitter, 100));
+}
+
+// -----------------------------------------------------------------------------
+
+static bool checkTransport()
+{
+  VirtualClock clock;
+  TickRecorder a(clock), b(clock), c(clock);
+  midi::ClockGenerator<TickRecorder, 3> generator(a);
+  generator.addOutput(b);
+  generator.addOutput(c);
+  const bool full = !generator.addOutput(c);
+  generator.setBpm(12000);
+
+  // 10 s, stop, jump to bar 5, 2 s more, tempo change.
+  generator.start(0);
+  for (; clock.now() < 10000000; clock.advance(100)) generator.update((unsigned long)clock.now());
+  generator.stop();
+  const unsigned stopPosition = generator.getSongPosition();
+  generator.setSongPosition(64);
+  generator.resume((unsigned long)clock.now());
+  generator.setTempo(250000); // 240 BPM
+  for (const SimulatedTime end = clock.now() + 2000000; clock.now() < end; clock.advance(100))
+  {
+    generator.update((unsigned long)clock.now());
+  }
+
+  // 10 s at 120 BPM: 480 ticks, 80 beats. 2 s at 240 BPM: 192 ticks, 32 beats.
+  const midi::MidiType transport[] = { midi::Start, midi::Stop, midi::Continue };
+  const std::vector<midi::MidiType>& sent = a.getTransport();
+  std::vector<midi::MidiType> events;
+  std::remove_copy(sent.begin(), sent.end(), std::back_inserter(events), midi::Clock);
+  const bool same = a.getTicks() == b.getTicks() && a.getTicks() == c.getTicks() &&
+                    a.getTransport() == c.getTransport();
+  const bool valid = full && same && stopPosition == 80 && a.getSongPosition() == 64 &&
+                     generator.getSongPosition() == 64 + 32 &&
+                     std::equal(events.begin(), events.end(), transport) && events.size() == 3;
+  printf("fan-out to 3 outputs %s, stopped at beat %u, resumed from beat %u, at beat %u 2 s later: %s\n",
+         same ? "identical" : "DIFFERENT", stopPosition, a.getSongPosition(),
+         generator.getSongPosition(), valid ? "ok" : "FAILED");
+  return valid;
+}
+
+static void measureCost()
+{
+  typedef midi::MidiInterface<midi::MockSerial> Interface;
+  static midi::MockSerial serials[4];
+  static Interface interfaces[4] = { Interface(serials[0]), Interface(serials[1]),
+                                     Interface(serials[2]), Interface(serials[3]) };
+  midi::ClockGenerator<Interface> generator(interfaces[0]);
+  for (unsigned i = 1; i < 4; ++i)
+  {
+    generator.addOutput(interfaces[i]);
+  }
+  for (unsigned i = 0; i < 4; ++i)
+  {
+    serials[i].setCaptureOutput(false);
+  }
+
+  // One microsecond of virtual time per call: a tick every 20833 calls.
+  const unsigned long calls = 100000000UL;
+  generator.start(0);
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (unsigned long now = 0; now < calls; ++now)
+  {
+    generator.update(now);
+  }
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  printf("update() with 4 outputs: %.2f ns per call (%lu ticks sent in %lu calls)\n",
+         seconds / calls * 1e9, generator.getTickCount(), calls);
+}
+
+int main()
+{
+  printf("1 hour of MIDI clock, loop() taking 20 us to 8 ms (virtual time):\n");
+  const unsigned long tempos[] = { 12000, 13333, 9750 };
+  for (size_t i = 0; i < sizeof(tempos) / sizeof(tempos[0]); ++i)
+  {
+    printf(" %.2f BPM, tick period %.3f us:\n", tempos[i] / 100.0, 250000000.0 / tempos[i]);
+    report("millis() delta",  generateTicks(MillisDelta, tempos[i]), tempos[i]);
+    report("micros() delta",  generateTicks(MicrosDelta, tempos[i]), tempos[i]);
+    report("micros() grid",   generateTicks(MicrosGrid,  tempos[i]), tempos[i]);
+    report("ClockGenerator",  generateTicks(Generator,   tempos[i]), tempos[i]);
+  }
+  const bool valid = checkTransport();
+  measureCost();
+  return valid ? 0 : 1;
+}
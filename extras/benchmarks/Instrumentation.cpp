@@ -0,0 +1,385 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+/*
+  Host checks for the instrumentation policies of MidiInterface (see
+  XE_MIDI_Statistics.h, XE_MIDI_Latency.h and XE_MIDI_Trace.h), timed with
+  a fake clock so that results are exact, and cost of enabling them.
+
+  Input bytes are read one by one, 320 us apart (the time of a byte at
+  31250 baud), with Real Time messages interleaved in SysEx frames and in
+  Running Status channel messages, on the serial and the USB-MIDI paths.
+
+  Build & run from this directory:
+    c++ -O2 -I../../src -I../host Instrumentation.cpp ../../src/XE_MIDI.cpp -o Instrumentation
+    ./Instrumentation
+*/
+
+#include <XE_MIDI.h>
+#include <MockSerial.h>
+#include <ChromeTrace.h>
+#include <chrono>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+static unsigned long sNow = 0;
+
+/*! Clock of the policies: time set by the checks. */
+struct FakeClock
+{
+  static unsigned long now()
+  {
+    return sNow;
+  }
+};
+
+static const unsigned long sByteTime = 320;
+
+struct LatencySettings : public midi::DefaultSettings
+{
+  typedef midi::LatencyHistograms<FakeClock> Latency;
+};
+
+typedef midi::MidiInterface<midi::MockSerial, LatencySettings> LatencyInterface;
+
+struct StatisticsSettings : public midi::DefaultSettings
+{
+  typedef midi::MidiStatistics Statistics;
+};
+
+typedef midi::MidiInterface<midi::MockSerial, StatisticsSettings> StatisticsInterface;
+
+struct TraceSettings : public midi::DefaultSettings
+{
+  typedef midi::TraceRing<FakeClock, 64> Tracer;
+};
+
+typedef midi::MidiInterface<midi::MockSerial, TraceSettings> TraceInterface;
+
+static unsigned sFailures = 0;
+
+static void check(bool inCondition, const char* inName)
+{
+  if (!inCondition)
+  {
+    printf("  FAIL: %s\n", inName);
+    sFailures++;
+  }
+}
+
+/*! Read the bytes one by one, sByteTime apart, the first one at time 0. */
+template<class Interface>
+static void readBytes(midi::MockSerial& ioSerial, Interface& ioMidi,
+                      const byte* inData, unsigned inSize)
+{
+  for (unsigned i = 0; i < inSize; ++i)
+  {
+    sNow = i * sByteTime;
+    ioSerial.setInput(inData + i, 1);
+    ioMidi.read();
+  }
+}
+
+// -----------------------------------------------------------------------------
+
+/*! Output for the statistics reports. */
+struct ByteOutput
+{
+  void write(byte inData) { bytes.push_back(inData); }
+  std::vector<byte> bytes;
+};
+
+static void checkStatistics()
+{
+  // Largest counters: all digits and bits in the reports.
+  midi::MidiStatistics statistics;
+  statistics.bytesReceived = 4294967295UL;
+  statistics.thruMessages  = 4000000000UL;
+
+  ByteOutput text;
+  statistics.writeText(text);
+  const std::string report(text.bytes.begin(), text.bytes.end());
+  check(report == "bytes_in 4294967295\nthru 4000000000\n", "statistics: text report");
+
+  ByteOutput sysEx;
+  statistics.writeSysEx(sysEx);
+  const unsigned count = sizeof(midi::MidiStatistics) / sizeof(midi::MidiStatistics::Counter);
+  bool valid = sysEx.bytes.size() == 4 + count * midi::MidiStatistics::sCounterSeptets;
+  for (unsigned i = 0; valid && i < count; ++i)
+  {
+    unsigned long long value = 0;
+    for (unsigned j = midi::MidiStatistics::sCounterSeptets; j-- > 0;)
+    {
+      const byte septet = sysEx.bytes[3 + i * midi::MidiStatistics::sCounterSeptets + j];
+      valid &= septet < 0x80;
+      value = value << 7 | septet;
+    }
+    valid &= value == (&statistics.bytesReceived)[i];
+  }
+  check(valid, "statistics: SysEx report");
+
+  // Thru counts only what is forwarded: a Tune Request goes out.
+  static midi::MockSerial serial;
+  static StatisticsInterface midi(serial);
+  midi.begin(MIDI_CHANNEL_OMNI);
+  midi.turnThruOn();
+  serial.setCaptureOutput(true);
+  const byte tuneRequest[] = { 0xf6 };
+  readBytes(serial, midi, tuneRequest, sizeof(tuneRequest));
+  check(serial.getOutput() == std::vector<byte>(1, 0xf6) && midi.getStatistics().thruMessages == 1,
+        "statistics: Tune Request thru");
+}
+
+static void checkLatency()
+{
+  static midi::MockSerial serial;
+  static LatencyInterface midi(serial);
+  midi.begin(MIDI_CHANNEL_OMNI);
+  midi.turnThruOn();
+
+  const midi::LatencyHistogram& parse = midi.getLatency().getHistogram(midi::LatencyStage::Parse);
+  const midi::LatencyHistogram& thru  = midi.getLatency().getHistogram(midi::LatencyStage::Thru);
+
+  // Clock in a SysEx frame: 0 us for the Clock, 7 bytes for the SysEx.
+  const byte sysEx[] = { 0xf0, 0x01, 0x02, 0x03, 0xf8, 0x04, 0x05, 0xf7 };
+  midi.resetLatency();
+  readBytes(serial, midi, sysEx, sizeof(sysEx));
+  check(parse.getCount() == 2 && parse.getBucket(0) == 1 && parse.getMax() == 7 * sByteTime,
+        "serial: Clock in SysEx, parse latency");
+  check(thru.getCount() == 2 && thru.getBucket(0) == 1 && thru.getMax() == 7 * sByteTime,
+        "serial: Clock in SysEx, thru latency");
+
+  // Clock in a Running Status Note On: 2 bytes for each note, 0 for the Clock.
+  const byte notes[] = { 0x90, 0x40, 0x7f, 0x41, 0xf8, 0x7f };
+  midi.resetLatency();
+  readBytes(serial, midi, notes, sizeof(notes));
+  check(parse.getCount() == 3 && parse.getBucket(0) == 1 && parse.getMax() == 2 * sByteTime,
+        "serial: Clock in Running Status, parse latency");
+
+  // Invalid status, then a message: timed from its own first byte.
+  const byte invalid[] = { 0xf4, 0x80, 0x40, 0x00 };
+  midi.resetLatency();
+  readBytes(serial, midi, invalid, sizeof(invalid));
+  check(parse.getCount() == 1 && parse.getMax() == 2 * sByteTime,
+        "serial: message after an invalid status");
+
+  // USB-MIDI: Clock packet between SysEx packets, a reserved packet before.
+  midi.resetLatency();
+  const byte packets[][4] = {
+    { 0x0f, 0xf0, 0x00, 0x00 },   // Single byte 0xf0: dropped
+    { 0x04, 0xf0, 0x01, 0x02 },
+    { 0x0f, 0xf8, 0x00, 0x00 },
+    { 0x04, 0x03, 0x04, 0x05 },
+    { 0x06, 0x06, 0xf7, 0x00 },
+  };
+  for (unsigned i = 0; i < sizeof(packets) / sizeof(packets[0]); ++i)
+  {
+    midi::UsbMidiEventPacket packet;
+    packet.setHeader(0, packets[i][0]);
+    packet.setMidiData(packets[i] + 1);
+    sNow = i * 4 * sByteTime;
+    midi.read(packet);
+  }
+  check(parse.getCount() == 2 && parse.getBucket(0) == 1 && parse.getMax() == 3 * 4 * sByteTime,
+        "USB-MIDI: Clock in SysEx, parse latency");
+}
+
+// -----------------------------------------------------------------------------
+
+/*! Chrome trace JSON of the Parse events of a ring. */
+template<class Ring>
+static std::string getParseTrace(const Ring& inRing)
+{
+  FILE* file = tmpfile();
+  midi::writeChromeTrace(inRing, file);
+  std::string trace(size_t(ftell(file)), '\0');
+  rewind(file);
+  trace.resize(fread(&trace[0], 1, trace.size(), file));
+  fclose(file);
+  return trace;
+}
+
+static bool hasSlice(const std::string& inTrace, unsigned long inStart, unsigned long inDuration,
+                     byte inType)
+{
+  char slice[128];
+  snprintf(slice, sizeof(slice), "\"name\":\"parse\",\"cat\":\"midi\",\"ph\":\"X\",\"ts\":%lu,\"dur\":%lu,"
+           "\"pid\":0,\"tid\":0,\"args\":{\"type\":\"0x%02x\"}", inStart, inDuration, unsigned(inType));
+  return inTrace.find(slice) != std::string::npos;
+}
+
+static void checkTrace()
+{
+  static midi::MockSerial serial;
+  static TraceInterface midi(serial);
+  midi.begin(MIDI_CHANNEL_OMNI);
+  midi.turnThruOff();
+
+  // Clock slice nested in the SysEx one.
+  const byte sysEx[] = { 0xf0, 0x01, 0x02, 0x03, 0xf8, 0x04, 0x05, 0xf7 };
+  midi.getTracer().clear();
+  readBytes(serial, midi, sysEx, sizeof(sysEx));
+  std::string trace = getParseTrace(midi.getTracer());
+  check(hasSlice(trace, 4 * sByteTime, 0, 0xf8), "serial: Clock in SysEx, Clock slice");
+  check(hasSlice(trace, 0, 7 * sByteTime, 0xf0), "serial: Clock in SysEx, SysEx slice");
+
+  const byte notes[] = { 0x90, 0x40, 0x7f, 0x41, 0xf8, 0x7f };
+  midi.getTracer().clear();
+  readBytes(serial, midi, notes, sizeof(notes));
+  trace = getParseTrace(midi.getTracer());
+  check(hasSlice(trace, 0, 2 * sByteTime, 0x90) && hasSlice(trace, 4 * sByteTime, 0, 0xf8) &&
+        hasSlice(trace, 3 * sByteTime, 2 * sByteTime, 0x90),
+        "serial: Clock in Running Status, slices");
+
+  // Dropped messages close their slice, with a 0 type.
+  const byte invalid[] = { 0xf4, 0x80, 0x40, 0x00 };
+  midi.getTracer().clear();
+  readBytes(serial, midi, invalid, sizeof(invalid));
+  trace = getParseTrace(midi.getTracer());
+  check(hasSlice(trace, 0, 0, 0x00) && hasSlice(trace, sByteTime, 2 * sByteTime, 0x80),
+        "serial: invalid status slice closed");
+
+  const midi::TraceRing<FakeClock, 64>& ring = midi.getTracer();
+  unsigned depth = 0;
+  for (unsigned i = 0; i < ring.getCount(); ++i)
+  {
+    if (ring.get(i).mEvent == midi::TraceEvent::Parse)
+    {
+      depth += ring.get(i).mPhase == midi::TraceEvent::Begin ? 1 : -1;
+    }
+  }
+  check(depth == 0, "serial: no parse begin left open");
+
+  // USB-MIDI: only Real Time is interleaved in a SysEx frame, a Note On
+  // packet drops the frame and is parsed on its own.
+  const byte packets[][4] = {
+    { 0x04, 0xf0, 0x01, 0x02 },
+    { 0x09, 0x90, 0x40, 0x7f },
+    { 0x06, 0x03, 0xf7, 0x00 },
+  };
+  midi.getTracer().clear();
+  bool noteOn = false;
+  bool frame  = false;
+  for (unsigned i = 0; i < sizeof(packets) / sizeof(packets[0]); ++i)
+  {
+    midi::UsbMidiEventPacket packet;
+    packet.setHeader(0, packets[i][0]);
+    packet.setMidiData(packets[i] + 1);
+    sNow = i * 4 * sByteTime;
+    if (midi.read(packet))
+    {
+      noteOn |= midi.getType() == midi::NoteOn;
+      frame  |= midi.getType() == midi::SystemExclusive;
+    }
+  }
+  trace = getParseTrace(ring);
+  check(noteOn && !frame && hasSlice(trace, 0, 4 * sByteTime, 0x00) &&
+        hasSlice(trace, 4 * sByteTime, 0, 0x90),
+        "USB-MIDI: Note On in SysEx, frame dropped");
+  depth = 0;
+  for (unsigned i = 0; i < ring.getCount(); ++i)
+  {
+    if (ring.get(i).mEvent == midi::TraceEvent::Parse)
+    {
+      depth += ring.get(i).mPhase == midi::TraceEvent::Begin ? 1 : -1;
+    }
+  }
+  check(depth == 0, "USB-MIDI: no parse begin left open");
+
+  // Every writer traces one Send slice, of its type.
+  midi.getTracer().clear();
+  midi.sendTuneRequest();
+  midi.sendTimeCodeQuarterFrame(0x12);
+  midi.sendSongPosition(100);
+  midi.sendSongSelect(3);
+  midi.sendRealTime(midi::Clock);
+  midi.sendStatistics();
+  const byte sent[] = { 0xf6, 0xf1, 0xf2, 0xf3, 0xf8, 0xf0 };
+  bool paired = ring.getCount() == 2 * sizeof(sent);
+  for (unsigned i = 0; paired && i < sizeof(sent); ++i)
+  {
+    const midi::TraceRing<FakeClock, 64>::Record& begin = ring.get(2 * i);
+    const midi::TraceRing<FakeClock, 64>::Record& end   = ring.get(2 * i + 1);
+    paired = begin.mEvent == midi::TraceEvent::Send && begin.mPhase == midi::TraceEvent::Begin &&
+             end.mEvent == midi::TraceEvent::Send && end.mPhase == midi::TraceEvent::End &&
+             begin.mArgument == sent[i] && end.mArgument == sent[i];
+  }
+  check(paired, "send: one slice per writer");
+}
+
+// -----------------------------------------------------------------------------
+
+/*! Parse cost of a policy, per byte of Running Status notes with Clocks. */
+template<class Settings>
+static double measureParse()
+{
+  static midi::MockSerial serial;
+  static midi::MidiInterface<midi::MockSerial, Settings> midi(serial);
+  midi.begin(MIDI_CHANNEL_OMNI);
+  midi.turnThruOff();
+
+  std::vector<byte> stream;
+  stream.push_back(0x90);
+  for (unsigned i = 0; i < 64 * 1024; ++i)
+  {
+    stream.push_back(i % 16 == 0 ? 0xf8 : byte(i & 0x7f));
+  }
+  serial.setInput(stream);
+
+  double best = 1e30;
+  for (unsigned run = 0; run < 20; ++run)
+  {
+    serial.rewind();
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while (serial.available() != 0)
+    {
+      midi.read();
+    }
+    const double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    best = time < best ? time : best;
+  }
+  return best / stream.size() * 1e9;
+}
+
+struct SteadyLatencySettings : public midi::DefaultSettings
+{
+  typedef midi::LatencyHistograms<midi::SteadyClock> Latency;
+};
+
+struct SteadyTraceSettings : public midi::DefaultSettings
+{
+  typedef midi::TraceRing<midi::SteadyClock, 64> Tracer;
+};
+
+int main()
+{
+  printf("Checks:\n");
+  checkStatistics();
+  checkLatency();
+  checkTrace();
+  printf("  %s (%u failures)\n", sFailures == 0 ? "all passed" : "FAILED", sFailures);
+
+  printf("Parse cost, per byte:\n");
+  printf("  no instrumentation  %6.2f ns\n", measureParse<midi::DefaultSettings>());
+  printf("  latency histograms  %6.2f ns\n", measureParse<SteadyLatencySettings>());
+  printf("  trace ring          %6.2f ns\n", measureParse<SteadyTraceSettings>());
+  return sFailures == 0 ? 0 : 1;
+}
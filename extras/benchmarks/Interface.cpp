@@ -0,0 +1,344 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+/*
+  Host benchmark for MidiInterface, using an in-memory serial port.
+
+  Measures parsing throughput on several traffic mixes (with 1-byte and
+  full-message parsing), every send method, the soft thru modes, and the
+  SysEx codec. Times are per byte (or per message for sends), cycles are
+  read from the time stamp counter on x86.
+
+  Build & run from this directory:
+    c++ -O2 -I../../src -I../host Interface.cpp ../../src/XE_MIDI.cpp -o Interface
+    ./Interface
+*/
+
+#include <XE_MIDI.h>
+#include <MockSerial.h>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline unsigned long long readCycles() { return __rdtsc(); }
+#else
+static inline unsigned long long readCycles() { return 0; }
+#endif
+
+typedef std::chrono::steady_clock Clock;
+
+struct Measure
+{
+  double mSeconds;  ///< Per call
+  double mCycles;   ///< Per call
+};
+
+// Repeat until at least 200ms were spent, keep the best run.
+template<class Function>
+static Measure measure(Function inFunction)
+{
+  Measure best = { 1e30, 0 };
+  const Clock::time_point begin = Clock::now();
+  do
+  {
+    const Clock::time_point start = Clock::now();
+    const unsigned long long cycles = readCycles();
+    inFunction();
+    const unsigned long long elapsedCycles = readCycles() - cycles;
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    if (seconds < best.mSeconds)
+    {
+      best.mSeconds = seconds;
+      best.mCycles  = double(elapsedCycles);
+    }
+  }
+  while (Clock::now() - begin < std::chrono::milliseconds(200));
+  return best;
+}
+
+// -----------------------------------------------------------------------------
+// Traffic mixes
+
+static const unsigned sStreamSize = 64 * 1024;
+
+static byte randomData()
+{
+  return byte(rand() & 0x7f);
+}
+
+static void makeNotes(std::vector<byte>& outStream, bool inRunningStatus)
+{
+  while (outStream.size() < sStreamSize)
+  {
+    if (!inRunningStatus || outStream.empty())
+    {
+      const byte channel = inRunningStatus ? 0 : byte(rand() & 0x0f);
+      outStream.push_back(0x90 | channel);
+    }
+    outStream.push_back(randomData());
+    outStream.push_back(randomData());
+  }
+}
+
+static void makeControllers(std::vector<byte>& outStream)
+{
+  outStream.push_back(0xb0);
+  while (outStream.size() < sStreamSize)
+  {
+    outStream.push_back(byte(rand() & 0x1f));
+    outStream.push_back(randomData());
+  }
+}
+
+static void makeSysExWithClock(std::vector<byte>& outStream)
+{
+  while (outStream.size() < sStreamSize)
+  {
+    outStream.push_back(0xf0);
+    for (unsigned i = 0; i < 120; ++i)
+    {
+      outStream.push_back(randomData());
+      if (i % 10 == 0)
+      {
+        outStream.push_back(0xf8);
+      }
+    }
+    outStream.push_back(0xf7);
+  }
+}
+
+static void makeMixed(std::vector<byte>& outStream)
+{
+  while (outStream.size() < sStreamSize)
+  {
+    switch (rand() % 6)
+    {
+      case 0:
+        outStream.push_back(0xf8);
+        break;
+      case 1:
+        outStream.push_back(0xc0 | byte(rand() & 0x0f));
+        outStream.push_back(randomData());
+        break;
+      case 2:
+        outStream.push_back(0xe0 | byte(rand() & 0x0f));
+        outStream.push_back(randomData());
+        outStream.push_back(randomData());
+        break;
+      case 3:
+        outStream.push_back(0xf0);
+        for (unsigned i = 0; i < 16; ++i)
+        {
+          outStream.push_back(randomData());
+        }
+        outStream.push_back(0xf7);
+        break;
+      default:
+        outStream.push_back(0x80 | byte(rand() & 0x1f));
+        outStream.push_back(randomData());
+        outStream.push_back(randomData());
+        break;
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+
+struct ByteSettings : public midi::DefaultSettings
+{
+  static const unsigned SysExMaxSize = 256;
+};
+
+struct MessageSettings : public ByteSettings
+{
+  static const bool Use1ByteParsing = false;
+};
+
+template<class Settings>
+static void benchmarkParse(const char* inName, const std::vector<byte>& inStream)
+{
+  static midi::MockSerial serial;
+  static midi::MidiInterface<midi::MockSerial, Settings> interface(serial);
+  interface.begin(MIDI_CHANNEL_OMNI);
+  interface.turnThruOff();
+  serial.setInput(inStream);
+
+  unsigned messages = 0;
+  const Measure result = measure([&]()
+  {
+    serial.rewind();
+    messages = 0;
+    while (serial.available())
+    {
+      messages += interface.read() ? 1 : 0;
+    }
+  });
+
+  printf("  %-24s %8.2f ns/byte %7.1f cycles/byte %8.2f M msg/s\n", inName,
+         result.mSeconds * 1e9 / inStream.size(),
+         result.mCycles / inStream.size(),
+         messages / result.mSeconds / 1e6);
+}
+
+static void benchmarkThru(const char* inName, midi::Thru::Mode inMode,
+                          const std::vector<byte>& inStream)
+{
+  static midi::MockSerial serial;
+  static midi::MidiInterface<midi::MockSerial, MessageSettings> interface(serial);
+  interface.begin(1);
+  interface.turnThruOn(inMode);
+  serial.setCaptureOutput(false);
+  serial.setInput(inStream);
+
+  const Measure result = measure([&]()
+  {
+    serial.rewind();
+    serial.clearOutput();
+    while (serial.available())
+    {
+      interface.read();
+    }
+  });
+
+  printf("  %-24s %8.2f ns/byte %7.1f cycles/byte  (%zu bytes out)\n", inName,
+         result.mSeconds * 1e9 / inStream.size(),
+         result.mCycles / inStream.size(),
+         serial.getBytesWritten());
+}
+
+// -----------------------------------------------------------------------------
+
+static midi::MockSerial sSendSerial;
+static midi::MidiInterface<midi::MockSerial> sSendInterface(sSendSerial);
+static const unsigned sSendCount = 1024;
+
+template<class Function>
+static void benchmarkSend(const char* inName, Function inFunction)
+{
+  sSendSerial.setCaptureOutput(false);
+  const Measure result = measure([&]()
+  {
+    for (unsigned i = 0; i < sSendCount; ++i)
+    {
+      inFunction(i);
+    }
+  });
+
+  printf("  %-24s %8.2f ns/msg  %7.1f cycles/msg  %8.2f M msg/s\n", inName,
+         result.mSeconds * 1e9 / sSendCount,
+         result.mCycles / sSendCount,
+         sSendCount / result.mSeconds / 1e6);
+}
+
+static void benchmarkSends()
+{
+  static const byte sysEx[64] = { 0 };
+  midi::MidiInterface<midi::MockSerial>& m = sSendInterface;
+  m.begin(MIDI_CHANNEL_OMNI);
+
+  benchmarkSend("sendNoteOn",         [&](unsigned i) { m.sendNoteOn(i & 0x7f, 100, 1); });
+  benchmarkSend("sendNoteOff",        [&](unsigned i) { m.sendNoteOff(i & 0x7f, 0, 1); });
+  benchmarkSend("sendControlChange",  [&](unsigned i) { m.sendControlChange(1, i & 0x7f, 1); });
+  benchmarkSend("sendProgramChange",  [&](unsigned i) { m.sendProgramChange(i & 0x7f, 1); });
+  benchmarkSend("sendPitchBend",      [&](unsigned i) { m.sendPitchBend(int(i) - 512, 1); });
+  benchmarkSend("sendPolyPressure",   [&](unsigned i) { m.sendAfterTouch(60, i & 0x7f, 1); });
+  benchmarkSend("sendAfterTouch",     [&](unsigned i) { m.sendAfterTouch(i & 0x7f, 1); });
+  benchmarkSend("sendSysEx (64)",     [&](unsigned)   { m.sendSysEx(sizeof(sysEx), sysEx); });
+  benchmarkSend("sendSysExEncoded",   [&](unsigned)   { m.sendSysExEncoded(56, sysEx); });
+  benchmarkSend("sendTimeCodeQF",     [&](unsigned i) { m.sendTimeCodeQuarterFrame(i & 0x7f); });
+  benchmarkSend("sendSongPosition",   [&](unsigned i) { m.sendSongPosition(i); });
+  benchmarkSend("sendSongSelect",     [&](unsigned i) { m.sendSongSelect(i & 0x7f); });
+  benchmarkSend("sendTuneRequest",    [&](unsigned)   { m.sendTuneRequest(); });
+  benchmarkSend("sendRealTime",       [&](unsigned)   { m.sendRealTime(midi::Clock); });
+  benchmarkSend("sendRpnValue",       [&](unsigned i) { m.sendRpnValue(i & 0x3fff, 1); });
+  benchmarkSend("sendNrpnValue",      [&](unsigned i) { m.sendNrpnValue(i & 0x3fff, 1); });
+}
+
+// -----------------------------------------------------------------------------
+
+static void benchmarkCodec()
+{
+  std::vector<byte> raw(sStreamSize);
+  std::vector<byte> encoded(sStreamSize + sStreamSize / 7 + 8);
+  std::vector<byte> decoded(sStreamSize + 8);
+  for (unsigned i = 0; i < sStreamSize; ++i)
+  {
+    raw[i] = byte(rand());
+  }
+
+  unsigned encodedLength = 0;
+  const Measure encode = measure([&]()
+  {
+    encodedLength = midi::encodeSysEx(&raw[0], &encoded[0], sStreamSize);
+  });
+  const Measure decode = measure([&]()
+  {
+    midi::decodeSysEx(&encoded[0], &decoded[0], encodedLength);
+  });
+
+  printf("  %-24s %8.2f ns/byte %7.1f cycles/byte\n", "encodeSysEx",
+         encode.mSeconds * 1e9 / sStreamSize, encode.mCycles / sStreamSize);
+  printf("  %-24s %8.2f ns/byte %7.1f cycles/byte\n", "decodeSysEx",
+         decode.mSeconds * 1e9 / encodedLength, decode.mCycles / encodedLength);
+}
+
+// -----------------------------------------------------------------------------
+
+int main()
+{
+  srand(42);
+
+  std::vector<byte> notes, runningNotes, controllers, sysEx, mixed;
+  makeNotes(notes, false);
+  makeNotes(runningNotes, true);
+  makeControllers(controllers);
+  makeSysExWithClock(sysEx);
+  makeMixed(mixed);
+
+  printf("Parse, 1 byte per read():\n");
+  benchmarkParse<ByteSettings>("notes",                notes);
+  benchmarkParse<ByteSettings>("notes, running status", runningNotes);
+  benchmarkParse<ByteSettings>("controllers",          controllers);
+  benchmarkParse<ByteSettings>("sysex + clock",        sysEx);
+  benchmarkParse<ByteSettings>("mixed",                mixed);
+
+  printf("Parse, full message per read():\n");
+  benchmarkParse<MessageSettings>("notes",                notes);
+  benchmarkParse<MessageSettings>("notes, running status", runningNotes);
+  benchmarkParse<MessageSettings>("controllers",          controllers);
+  benchmarkParse<MessageSettings>("sysex + clock",        sysEx);
+  benchmarkParse<MessageSettings>("mixed",                mixed);
+
+  printf("Thru (mixed traffic, input channel 1):\n");
+  benchmarkThru("Off",              midi::Thru::Off,              mixed);
+  benchmarkThru("Full",             midi::Thru::Full,             mixed);
+  benchmarkThru("SameChannel",      midi::Thru::SameChannel,      mixed);
+  benchmarkThru("DifferentChannel", midi::Thru::DifferentChannel, mixed);
+
+  printf("Send:\n");
+  benchmarkSends();
+
+  printf("SysEx codec:\n");
+  benchmarkCodec();
+  return 0;
+}
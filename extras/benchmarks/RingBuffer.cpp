@@ -0,0 +1,174 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+/*
+  Host benchmark for RingBuffer / SpscRingBuffer.
+
+  Measures byte-per-byte and bulk (64 byte chunks) transfers through both
+  buffers in a single thread, then streams data between a producer and a
+  consumer thread through SpscRingBuffer, checking for corruption.
+
+  Build & run from this directory:
+    c++ -O2 -pthread -I../../src RingBuffer.cpp -o RingBuffer
+    ./RingBuffer [megabytes]
+*/
+
+#include <XE_MIDI_Defs.h>
+#include <XE_MIDI_RingBuffer.h>
+#include <XE_MIDI_SpscRingBuffer.h>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+
+typedef std::chrono::steady_clock Clock;
+
+static const unsigned sBufferSize = 1024;
+static const unsigned sChunkSize  = 64;
+
+static volatile byte sSink;
+
+static double toMBps(unsigned inBytes, Clock::time_point inStart)
+{
+  const double seconds = std::chrono::duration<double>(Clock::now() - inStart).count();
+  return double(inBytes) / seconds / 1e6;
+}
+
+// -----------------------------------------------------------------------------
+
+template<class Buffer>
+static double measureBytes(Buffer& ioBuffer, unsigned inSize)
+{
+  const Clock::time_point start = Clock::now();
+  byte sum = 0;
+  for (unsigned done = 0; done < inSize; done += sChunkSize)
+  {
+    for (unsigned i = 0; i < sChunkSize; ++i)
+    {
+      ioBuffer.write(byte(done + i));
+    }
+    for (unsigned i = 0; i < sChunkSize; ++i)
+    {
+      sum += ioBuffer.read();
+    }
+  }
+  sSink = sum;
+  return toMBps(inSize, start);
+}
+
+template<class Buffer>
+static double measureBulk(Buffer& ioBuffer, unsigned inSize)
+{
+  byte chunk[sChunkSize];
+  for (unsigned i = 0; i < sChunkSize; ++i)
+  {
+    chunk[i] = byte(i);
+  }
+
+  const Clock::time_point start = Clock::now();
+  byte sum = 0;
+  for (unsigned done = 0; done < inSize; done += sChunkSize)
+  {
+    chunk[0] = byte(done);
+    ioBuffer.write(chunk, sChunkSize);
+    ioBuffer.read(chunk, sChunkSize);
+    sum += chunk[sChunkSize - 1];
+  }
+  sSink = sum;
+  return toMBps(inSize, start);
+}
+
+// -----------------------------------------------------------------------------
+
+static midi::SpscRingBuffer<byte, sBufferSize> sShared;
+
+static double measureThreads(unsigned inSize, bool& outValid)
+{
+  const Clock::time_point start = Clock::now();
+
+  std::thread producer([inSize]()
+  {
+    byte chunk[sChunkSize];
+    unsigned sent = 0;
+    while (sent < inSize)
+    {
+      for (unsigned i = 0; i < sChunkSize; ++i)
+      {
+        chunk[i] = byte(sent + i);
+      }
+      unsigned offset = 0;
+      while (offset < sChunkSize)
+      {
+        const unsigned space = sShared.getFreeSpace();
+        if (space == 0)
+        {
+          std::this_thread::yield();
+          continue;
+        }
+        const unsigned count = space < sChunkSize - offset ? space : sChunkSize - offset;
+        offset += sShared.write(chunk + offset, count);
+      }
+      sent += sChunkSize;
+    }
+  });
+
+  bool valid = true;
+  byte chunk[sChunkSize];
+  unsigned received = 0;
+  while (received < inSize)
+  {
+    const unsigned count = sShared.read(chunk, sChunkSize);
+    if (count == 0)
+    {
+      std::this_thread::yield();
+    }
+    for (unsigned i = 0; i < count; ++i)
+    {
+      valid &= chunk[i] == byte(received + i);
+    }
+    received += count;
+  }
+  producer.join();
+
+  outValid = valid && sShared.getOverflowCount() == 0;
+  return toMBps(inSize, start);
+}
+
+// -----------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+  const unsigned size = (argc > 1 ? unsigned(atoi(argv[1])) : 64) * 1024 * 1024;
+
+  static midi::RingBuffer<byte, sBufferSize> ringBuffer;
+  static midi::SpscRingBuffer<byte, sBufferSize> spscBuffer;
+
+  printf("Ring buffers, %u bytes, %u byte chunks (MB/s):\n", size, sChunkSize);
+  printf("  per byte  RingBuffer %8.1f  SpscRingBuffer %8.1f\n",
+         measureBytes(ringBuffer, size), measureBytes(spscBuffer, size));
+  printf("  bulk      RingBuffer %8.1f  SpscRingBuffer %8.1f\n",
+         measureBulk(ringBuffer, size), measureBulk(spscBuffer, size));
+
+  bool valid = false;
+  const double threaded = measureThreads(size, valid);
+  printf("  threads   SpscRingBuffer %8.1f  (%s)\n", threaded,
+         valid ? "data intact" : "DATA CORRUPTED");
+  return valid ? 0 : 1;
+}
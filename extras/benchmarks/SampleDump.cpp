@@ -0,0 +1,378 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+  Host benchmark for the Sample Dump Standard engine.
+
+  A sender and a receiver MidiInterface are connected by a simulated MIDI
+  cable pair running at 31250 baud (320us per byte, on a virtual clock), and
+  the receiver takes some time to process each packet (eg: flash writes).
+  Reports the transfer time and throughput as a fraction of the link capacity,
+  for various window sizes and packet error rates, after checking the
+  handshake corner cases (late answers after the open loop fallback, NAK of
+  lost packets).
+
+  Build & run from this directory:
+    c++ -O2 -I../../src -I../host SampleDump.cpp ../../src/XE_MIDI.cpp -o SampleDump
+    ./SampleDump [receiver processing time in us]
+*/
+
+#include <XE_MIDI.h>
+#include <XE_MIDI_SampleDump.h>
+#include <MockSerial.h>
+#include <deque>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+static const unsigned long sByteTimeUs = 320;
+static unsigned long long sNowUs = 0;
+
+// One direction of a MIDI cable: bytes arrive one byte time after each other.
+struct Wire
+{
+  struct Byte
+  {
+    unsigned long long arrival;
+    byte data;
+  };
+
+  Wire() : mFreeAt(0), mErrorRate(0.0), mInPacket(false), mPacketIndex(0) {}
+
+  void push(byte inData)
+  {
+    // Corrupt one data byte in some packets.
+    if (inData == 0xf0)
+    {
+      mInPacket = true;
+      mPacketIndex = 0;
+    }
+    if (mInPacket && ++mPacketIndex == 64 && rand() < mErrorRate * RAND_MAX)
+    {
+      inData ^= 0x01;
+    }
+
+    mFreeAt = (mFreeAt > sNowUs ? mFreeAt : sNowUs) + sByteTimeUs;
+    Byte entry = { mFreeAt, inData };
+    mBytes.push_back(entry);
+  }
+
+  unsigned available() const
+  {
+    unsigned count = 0;
+    for (std::deque<Byte>::const_iterator it = mBytes.begin(); it != mBytes.end() && it->arrival <= sNowUs; ++it)
+    {
+      count++;
+    }
+    return count;
+  }
+
+  std::deque<Byte> mBytes;
+  unsigned long long mFreeAt;
+  double mErrorRate;
+  bool mInPacket;
+  unsigned mPacketIndex;
+};
+
+struct WirePort
+{
+  WirePort(Wire& inRx, Wire& inTx) : mRx(inRx), mTx(inTx) {}
+
+  void begin(long) {}
+  unsigned available() { return mRx.available(); }
+  byte read()
+  {
+    const byte data = mRx.mBytes.front().data;
+    mRx.mBytes.pop_front();
+    return data;
+  }
+  void write(byte inData) { mTx.push(inData); }
+
+  Wire& mRx;
+  Wire& mTx;
+};
+
+struct Settings : public midi::DefaultSettings
+{
+  static const bool Use1ByteParsing = false;
+};
+
+typedef midi::MidiInterface<WirePort, Settings> Interface;
+
+// -----------------------------------------------------------------------------
+
+static std::vector<unsigned long> sSource;
+static std::vector<unsigned long> sDestination;
+
+static unsigned long readWord(unsigned long inIndex)
+{
+  return sSource[inIndex];
+}
+
+static void writeWord(unsigned long inIndex, unsigned long inWord)
+{
+  sDestination[inIndex] = inWord;
+}
+
+// Callbacks have no context: route SysEx to the current engines.
+static void (*sSenderSysEx)(byte*, unsigned)    = 0;
+static void (*sReceiverSysEx)(byte*, unsigned)  = 0;
+static void handleSenderSysEx(byte* inData, unsigned inSize)   { sSenderSysEx(inData, inSize); }
+static void handleReceiverSysEx(byte* inData, unsigned inSize) { sReceiverSysEx(inData, inSize); }
+
+template<unsigned WindowSize>
+struct Transfer
+{
+  typedef midi::SampleDumpSender<Interface, WindowSize>   Sender;
+  typedef midi::SampleDumpReceiver<Interface, WindowSize> Receiver;
+
+  static Sender*        sSender;
+  static Receiver*      sReceiver;
+  static Wire*          sReceiverOutput;
+  static unsigned long  sProcessingUs;
+  static bool           sReceiverBusy;
+
+  static void senderSysEx(byte* inData, unsigned inSize)
+  {
+    sSender->handleSysEx(inData, inSize, (unsigned long)(sNowUs / 1000));
+  }
+  static void receiverSysEx(byte* inData, unsigned inSize)
+  {
+    // Answers go out once the packet is processed.
+    const unsigned long long processed = sNowUs + sProcessingUs;
+    sReceiverOutput->mFreeAt = sReceiverOutput->mFreeAt > processed ? sReceiverOutput->mFreeAt : processed;
+    sReceiver->handleSysEx(inData, inSize);
+    sReceiverBusy = true;
+  }
+
+  static void run(unsigned long inWords, double inErrorRate, unsigned long inProcessingUs)
+  {
+    Wire toReceiver;
+    Wire toSender;
+    toReceiver.mErrorRate = inErrorRate;
+    WirePort senderPort(toSender, toReceiver);
+    WirePort receiverPort(toReceiver, toSender);
+    Interface senderMidi(senderPort);
+    Interface receiverMidi(receiverPort);
+
+    senderMidi.begin(MIDI_CHANNEL_OMNI);
+    receiverMidi.begin(MIDI_CHANNEL_OMNI);
+    senderMidi.turnThruOff();
+    receiverMidi.turnThruOff();
+
+    Sender sender(senderMidi, readWord);
+    Receiver receiver(receiverMidi, writeWord);
+    sSender = &sender;
+    sReceiver = &receiver;
+    sReceiverOutput = &toSender;
+    sProcessingUs = inProcessingUs;
+    sender.setRetryTimeout(WindowSize * 50 + 250);
+    sSenderSysEx = senderSysEx;
+    sReceiverSysEx = receiverSysEx;
+    senderMidi.setHandleSystemExclusive(handleSenderSysEx);
+    receiverMidi.setHandleSystemExclusive(handleReceiverSysEx);
+
+    sSource.resize(inWords);
+    sDestination.assign(inWords, 0);
+    for (unsigned long i = 0; i < inWords; ++i)
+    {
+      sSource[i] = rand() & 0xffff;
+    }
+
+    midi::SampleDumpHeader header = { 1, 16, 22676, inWords, 0, inWords - 1, 0x7f };
+    sNowUs = 0;
+    sender.begin(header, 0);
+
+    unsigned long long receiverFreeAt = 0;
+    while (sender.getStatus() != Sender::Done && sender.getStatus() != Sender::Cancelled &&
+           sNowUs < 600000000ull)
+    {
+      sNowUs += 20;
+      while (senderPort.available())
+      {
+        senderMidi.read();
+      }
+      if (sNowUs >= receiverFreeAt)
+      {
+        sReceiverBusy = false;
+        while (!sReceiverBusy && receiverPort.available())
+        {
+          receiverMidi.read();
+        }
+        if (sReceiverBusy)
+        {
+          receiverFreeAt = sNowUs + inProcessingUs;
+        }
+      }
+      sender.update((unsigned long)(sNowUs / 1000));
+    }
+
+    const bool intact = receiver.getStatus() == Receiver::Done && sSource == sDestination;
+    const double seconds = double(sNowUs) / 1e6;
+    const double linkBytes = double(sender.getPacketCount()) * midi::SampleDump::PacketSize;
+    printf("  window %2u  errors %4.1f%%  %7.2fs  %6.0f B/s  %5.1f%% of link  %3lu resent  %s\n",
+           WindowSize, inErrorRate * 100.0, seconds, inWords * 2 / seconds,
+           100.0 * linkBytes / (seconds * 1e6 / sByteTimeUs),
+           sender.getRetransmitCount(), intact ? "ok" : "CORRUPTED");
+  }
+};
+
+// -----------------------------------------------------------------------------
+// Handshake checks, on a mock serial port.
+
+typedef midi::MidiInterface<midi::MockSerial> MockInterface;
+
+static unsigned sFailures = 0;
+
+static void check(bool inCondition, const char* inName)
+{
+  if (!inCondition)
+  {
+    printf("  FAIL: %s\n", inName);
+    sFailures++;
+  }
+}
+
+static bool sentHandshakes(const midi::MockSerial& inSerial, const byte* inExpected, unsigned inCount)
+{
+  std::vector<byte> expected;
+  for (unsigned i = 0; i < inCount; ++i)
+  {
+    const byte message[] = { 0xf0, 0x7e, 0x00, inExpected[2 * i], inExpected[2 * i + 1], 0xf7 };
+    expected.insert(expected.end(), message, message + sizeof(message));
+  }
+  return inSerial.getOutput() == expected;
+}
+
+// Receiver gave no answer to the header, then answers packets sent in open
+// loop, more than 128 of them after the fallback.
+static void checkLateAnswers()
+{
+  typedef midi::SampleDumpSender<MockInterface, 8> Sender;
+  midi::MockSerial serial;
+  MockInterface midi(serial);
+  midi.begin(MIDI_CHANNEL_OMNI);
+  serial.setCaptureOutput(false);
+
+  const unsigned long words = 200 * midi::SampleDump::getWordsPerPacket(16);
+  sSource.assign(words, 0x1234);
+  Sender sender(midi, readWord);
+  midi::SampleDumpHeader header = { 1, 16, 22676, words, 0, words - 1, 0x7f };
+  sender.begin(header, 0);
+
+  unsigned long now = 0;
+  while (sender.getSentPacketCount() < 150)
+  {
+    sender.update(now += 20);
+  }
+  const byte ack[] = { 0xf0, 0x7e, 0x00, midi::SampleDump::Ack, 0x50, 0xf7 };
+  const byte nak[] = { 0xf0, 0x7e, 0x00, midi::SampleDump::Nak, 0x10, 0xf7 };
+  sender.handleSysEx(ack, sizeof(ack), now);
+  sender.handleSysEx(nak, sizeof(nak), now);
+  while (sender.getStatus() == Sender::Sending && now < 60000)
+  {
+    sender.update(now += 20);
+  }
+  check(sender.getStatus() == Sender::Done, "open loop: done after late answers");
+  check(sender.getSentPacketCount() == 200 && sender.getRetransmitCount() == 0,
+        "open loop: each packet sent once");
+}
+
+static void sendPacket(midi::SampleDumpReceiver<MockInterface, 8>& ioReceiver, byte inPacket)
+{
+  byte packet[midi::SampleDump::PacketSize] = { 0xf0, 0x7e, 0x00, midi::SampleDump::Packet, inPacket };
+  midi::XorChecksum checksum;
+  for (unsigned i = 1; i < midi::SampleDump::PacketSize - 2; ++i)
+  {
+    checksum.update(packet[i]);
+  }
+  packet[midi::SampleDump::PacketSize - 2] = checksum.get();
+  packet[midi::SampleDump::PacketSize - 1] = 0xf7;
+  ioReceiver.handleSysEx(packet, sizeof(packet));
+}
+
+// A lost packet is NAKed as soon as the next one arrives, once.
+static void checkGapNak()
+{
+  typedef midi::SampleDumpReceiver<MockInterface, 8> Receiver;
+  midi::MockSerial serial;
+  MockInterface midi(serial);
+  midi.begin(MIDI_CHANNEL_OMNI);
+  serial.setCaptureOutput(true);
+
+  const unsigned long words = 4 * midi::SampleDump::getWordsPerPacket(16);
+  sDestination.assign(words, 1);
+  Receiver receiver(midi, writeWord);
+  const byte header[midi::SampleDump::HeaderSize] = {
+    0xf0, 0x7e, 0x00, midi::SampleDump::Header, 1, 0, 16, 0x14, 0x31, 0x01,
+    byte(words & 0x7f), byte(words >> 7), 0, 0, 0, 0, byte((words - 1) & 0x7f), byte((words - 1) >> 7), 0,
+    0x7f, 0xf7 };
+  receiver.handleSysEx(header, sizeof(header));
+  serial.clearOutput();
+
+  sendPacket(receiver, 1);
+  const byte nakThenAck[] = { midi::SampleDump::Nak, 0, midi::SampleDump::Ack, 1 };
+  check(sentHandshakes(serial, nakThenAck, 2), "gap: NAK of the lost packet, then ACK");
+  serial.clearOutput();
+
+  sendPacket(receiver, 2);
+  const byte ackOnly[] = { midi::SampleDump::Ack, 2 };
+  check(sentHandshakes(serial, ackOnly, 1), "gap: lost packet NAKed once");
+  serial.clearOutput();
+
+  sendPacket(receiver, 0);
+  sendPacket(receiver, 3);
+  check(receiver.getStatus() == Receiver::Done && receiver.getNakCount() == 1,
+        "gap: transfer completes with the retransmission");
+  check(sDestination == std::vector<unsigned long>(words, 0), "gap: all words written");
+}
+
+// -----------------------------------------------------------------------------
+
+template<unsigned W> typename Transfer<W>::Sender*   Transfer<W>::sSender   = 0;
+template<unsigned W> typename Transfer<W>::Receiver* Transfer<W>::sReceiver = 0;
+template<unsigned W> Wire* Transfer<W>::sReceiverOutput = 0;
+template<unsigned W> unsigned long Transfer<W>::sProcessingUs = 0;
+template<unsigned W> bool Transfer<W>::sReceiverBusy = false;
+
+int main(int argc, char** argv)
+{
+  const unsigned long processingUs = argc > 1 ? atol(argv[1]) : 5000;
+  const unsigned long words = 30000; // 16-bit, 60kB of sample data.
+
+  printf("Handshake checks:\n");
+  checkLateAnswers();
+  checkGapNak();
+  printf("  %s (%u failures)\n", sFailures == 0 ? "all passed" : "FAILED", sFailures);
+
+  printf("Sample Dump, %lu 16-bit words, receiver processing %luus per packet:\n",
+         words, processingUs);
+
+  const double errorRates[] = { 0.0, 0.01, 0.05 };
+  for (unsigned i = 0; i < 3; ++i)
+  {
+    srand(42);
+    Transfer<1>::run(words, errorRates[i], processingUs);
+    srand(42);
+    Transfer<4>::run(words, errorRates[i], processingUs);
+    srand(42);
+    Transfer<8>::run(words, errorRates[i], processingUs);
+  }
+  return sFailures == 0 ? 0 : 1;
+}
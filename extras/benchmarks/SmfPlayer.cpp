@@ -0,0 +1,517 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+/*
+  Host benchmark: streaming SMF playback (SmfPlayer) on large multi-track
+  files, memory mapped.
+
+  Generates a type 1 file (or uses the given one), checks the player output
+  against a reference (all events loaded and sorted in memory), divided
+  SysEx interleaved with other tracks and the notes chased by a seek, then
+  measures the events per second, flat out and scheduled in 1ms steps of
+  virtual time, for a few window sizes, and the memory used.
+
+  Build & run from this directory:
+    c++ -O2 -I../../src -I../host SmfPlayer.cpp ../../src/XE_MIDI.cpp -o SmfPlayer
+    ./SmfPlayer [file.mid]
+*/
+
+#include <XE_MIDI.h>
+#include <XE_MIDI_SmfPlayer.h>
+#include <MappedFile.h>
+#include <MockSerial.h>
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <sys/resource.h>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+typedef midi::MidiInterface<midi::MockSerial> Interface;
+
+static const char* const sGeneratedPath = "/tmp/xe_midi_smf_benchmark.mid";
+
+// -----------------------------------------------------------------------------
+// Test file
+
+static void writeNumber(std::vector<byte>& ioTrack, unsigned long inValue)
+{
+  byte buffer[4];
+  unsigned count = 0;
+  do
+  {
+    buffer[count++] = byte(inValue & 0x7f);
+    inValue >>= 7;
+  }
+  while (inValue != 0);
+  while (count > 0)
+  {
+    --count;
+    ioTrack.push_back(buffer[count] | (count > 0 ? 0x80 : 0));
+  }
+}
+
+static void writeUInt(std::vector<byte>& ioFile, unsigned long inValue, unsigned inSize)
+{
+  while (inSize-- > 0)
+  {
+    ioFile.push_back(byte(inValue >> (8 * inSize)));
+  }
+}
+
+/*! Track 0: tempo changes, SysEx and escaped clocks, every 1/16th note.
+  Other tracks: notes with Running Status, controllers and program changes.
+*/
+static void generateFile(unsigned inTracks, unsigned long inEventsPerTrack, std::vector<byte>& outFile)
+{
+  static const unsigned division = 480;
+
+  outFile.clear();
+  outFile.insert(outFile.end(), (const byte*)"MThd", (const byte*)"MThd" + 4);
+  writeUInt(outFile, 6, 4);
+  writeUInt(outFile, 1, 2);
+  writeUInt(outFile, inTracks, 2);
+  writeUInt(outFile, division, 2);
+
+  unsigned seed = 1;
+  for (unsigned t = 0; t < inTracks; ++t)
+  {
+    std::vector<byte> track;
+    for (unsigned long e = 0; e < inEventsPerTrack; ++e)
+    {
+      seed = seed * 1103515245 + 12345;
+      const byte random = byte(seed >> 16);
+      if (t == 0)
+      {
+        writeNumber(track, division / 4);
+        if (e % 16 == 15)
+        {
+          static const byte sysEx[] = { 0xf0, 10, 0x7e, 0x7f, 0x06, 0x01, 1, 2, 3, 4, 5, 0xf7 };
+          track.insert(track.end(), sysEx + 0, sysEx + sizeof(sysEx));
+        }
+        else if (e % 4 == 3)
+        {
+          const byte clock[] = { 0xf7, 1, 0xf8 };
+          track.insert(track.end(), clock, clock + sizeof(clock));
+        }
+        else
+        {
+          const unsigned long tempo = 400000 + (random & 0x7f) * 1000;
+          const byte meta[] = { 0xff, 0x51, 3, byte(tempo >> 16), byte(tempo >> 8), byte(tempo) };
+          track.insert(track.end(), meta, meta + sizeof(meta));
+        }
+        continue;
+      }
+
+      const byte channel = byte((t - 1) & 0x0f);
+      writeNumber(track, (random & 3) == 0 ? 0 : 30 + (random & 0x3f));
+      switch (e % 16)
+      {
+        case 0:
+          track.push_back(0xc0 | channel);
+          track.push_back(random & 0x7f);
+          break;
+        case 1:
+        case 9:
+          track.push_back(0xb0 | channel);
+          track.push_back(7);
+          track.push_back(random & 0x7f);
+          break;
+        default:
+          if (e % 16 == 2 || e % 16 == 10)
+          {
+            track.push_back(0x90 | channel); // Then Running Status
+          }
+          track.push_back(byte(36 + (e % 48)));
+          track.push_back(e & 1 ? 0 : 100);
+          break;
+      }
+    }
+    const byte end[] = { 0, 0xff, 0x2f, 0 };
+    track.insert(track.end(), end, end + sizeof(end));
+
+    outFile.insert(outFile.end(), (const byte*)"MTrk", (const byte*)"MTrk" + 4);
+    writeUInt(outFile, track.size(), 4);
+    outFile.insert(outFile.end(), track.begin(), track.end());
+  }
+}
+
+// -----------------------------------------------------------------------------
+// Divided SysEx interleaved with the events of another track: the frame is
+// terminated before any message but Real Time, and the packets left are
+// skipped.
+
+static void appendTrack(std::vector<byte>& ioFile, const byte* inData, unsigned inSize)
+{
+  ioFile.insert(ioFile.end(), (const byte*)"MTrk", (const byte*)"MTrk" + 4);
+  writeUInt(ioFile, inSize + 4, 4);
+  ioFile.insert(ioFile.end(), inData, inData + inSize);
+  const byte end[] = { 0, 0xff, 0x2f, 0 };
+  ioFile.insert(ioFile.end(), end, end + sizeof(end));
+}
+
+static bool checkInterleaved(const char* inName,
+                             const byte* inTrackA, unsigned inSizeA,
+                             const byte* inTrackB, unsigned inSizeB,
+                             const byte* inExpected, unsigned inExpectedSize)
+{
+  std::vector<byte> data;
+  data.insert(data.end(), (const byte*)"MThd", (const byte*)"MThd" + 4);
+  writeUInt(data, 6, 4);
+  writeUInt(data, 1, 2);
+  writeUInt(data, 2, 2);
+  writeUInt(data, 96, 2);
+  appendTrack(data, inTrackA, inSizeA);
+  appendTrack(data, inTrackB, inSizeB);
+
+  midi::MockSerial serial;
+  Interface midi(serial);
+  midi.begin(MIDI_CHANNEL_OMNI);
+  serial.setCaptureOutput(true);
+
+  midi::SmfMemorySource source(&data[0], data.size());
+  midi::SmfPlayer<Interface, midi::SmfMemorySource> player(midi, source);
+  serial.clearOutput();
+  if (player.begin())
+  {
+    player.play(0);
+    for (unsigned long now = 0; !player.isFinished(); )
+    {
+      player.update(now += 1000000UL);
+    }
+  }
+
+  const std::vector<byte> expected(inExpected, inExpected + inExpectedSize);
+  const bool same = serial.getOutput() == expected;
+  printf("%s: %s\n", inName, same ? "ok" : "FAILED");
+  return same;
+}
+
+static bool checkInterleavedSysEx()
+{
+  // Track A: divided SysEx at ticks 0 and 10.
+  static const byte trackA[] = { 0, 0xf0, 3, 1, 2, 3,  10, 0xf7, 2, 4, 0xf7 };
+  // Track B: escaped clock at tick 5, note at tick 7.
+  static const byte trackB[] = { 5, 0xf7, 1, 0xf8,  2, 0x90, 0x40, 0x7f };
+  static const byte expectedB[] = { 0xf0, 1, 2, 3, 0xf8, 0xf7, 0x90, 0x40, 0x7f };
+
+  // Track C: escaped clock only, the frame continues.
+  static const byte trackA2[] = { 0, 0xf0, 2, 1, 2,  10, 0xf7, 2, 3, 0xf7 };
+  static const byte trackC[]  = { 5, 0xf7, 1, 0xf8 };
+  static const byte expectedC[] = { 0xf0, 1, 2, 0xf8, 3, 0xf7 };
+
+  // Track D: escape event (Tune Request) while track A is in SysEx, sent as
+  // a message, not as SysEx data.
+  static const byte trackD[]  = { 5, 0xf7, 1, 0xf6 };
+  static const byte expectedD[] = { 0xf0, 1, 2, 0xf7, 0xf6 };
+
+  bool ok = true;
+  ok &= checkInterleaved("divided SysEx, note on another track", trackA, sizeof(trackA),
+                         trackB, sizeof(trackB), expectedB, sizeof(expectedB));
+  ok &= checkInterleaved("divided SysEx, clock on another track", trackA2, sizeof(trackA2),
+                         trackC, sizeof(trackC), expectedC, sizeof(expectedC));
+  ok &= checkInterleaved("divided SysEx, escape on another track", trackA2, sizeof(trackA2),
+                         trackD, sizeof(trackD), expectedD, sizeof(expectedD));
+  return ok;
+}
+
+// -----------------------------------------------------------------------------
+// Seek: notes released by a velocity-0 Note On before the position are not
+// left hanging, notes started after the index entry and still held at the
+// position are restored, and RPN & NRPN values are restored after their
+// selection.
+
+struct VectorSink
+{
+  unsigned write(unsigned long inOffset, const byte* inData, unsigned inSize)
+  {
+    if (data.size() < inOffset + inSize)
+    {
+      data.resize(inOffset + inSize);
+    }
+    std::copy(inData, inData + inSize, data.begin() + inOffset);
+    return inSize;
+  }
+
+  std::vector<byte> data;
+};
+
+static bool checkSeek()
+{
+  // Index entries every 4 beats (96 ticks), seek to beat 7 (tick 168).
+  static const byte track[] = {
+    0,  0xb0, 0x65, 0x00,       // Pitch bend range: 12 semitones.
+    0,  0xb0, 0x64, 0x00,
+    0,  0xb0, 0x06, 0x0c,
+    0,  0xb0, 0x63, 0x01,       // NRPN 1/2: 5, selected last.
+    0,  0xb0, 0x62, 0x02,
+    0,  0xb0, 0x06, 0x05,
+    0,  0x90, 0x3c, 0x64,       // Held at the entry of tick 96.
+    120, 0x90, 0x3e, 0x50,      // Started after the entry, held at 168.
+    24, 0x90, 0x3c, 0x00,       // Released before 168.
+    48, 0x90, 0x3e, 0x00,
+  };
+  static const byte expected[] = {
+    0xb0, 0x7b, 0x00, 0xb0, 0x79, 0x00,     // Reset.
+    0xb0, 0x65, 0x00, 0xb0, 0x64, 0x00, 0xb0, 0x06, 0x0c,  // Snapshot.
+    0xb0, 0x63, 0x01, 0xb0, 0x62, 0x02, 0xb0, 0x06, 0x05,
+    0xb0, 0x63, 0x01, 0xb0, 0x62, 0x02,
+    0x90, 0x3c, 0x64,
+    0x90, 0x3c, 0x00,                       // Played up to the position.
+    0x90, 0x3e, 0x50,                       // Held at the position.
+  };
+
+  std::vector<byte> data;
+  data.insert(data.end(), (const byte*)"MThd", (const byte*)"MThd" + 4);
+  writeUInt(data, 6, 4);
+  writeUInt(data, 0, 2);
+  writeUInt(data, 1, 2);
+  writeUInt(data, 96, 2);
+  appendTrack(data, track, sizeof(track));
+
+  midi::MockSerial serial;
+  Interface midi(serial);
+  midi.begin(MIDI_CHANNEL_OMNI);
+
+  midi::SmfMemorySource source(&data[0], data.size());
+  midi::SmfPlayer<Interface, midi::SmfMemorySource> player(midi, source);
+  VectorSink sink;
+  bool same = player.begin() && player.writeSeekIndex(sink, 4);
+  if (same)
+  {
+    midi::SmfMemorySource index(&sink.data[0], sink.data.size());
+    serial.setCaptureOutput(true);
+    same = player.seek(index, 7, 0)
+        && serial.getOutput() == std::vector<byte>(expected, expected + sizeof(expected));
+  }
+  printf("seek, notes and parameters chased: %s\n", same ? "ok" : "FAILED");
+  return same;
+}
+
+// -----------------------------------------------------------------------------
+// Reference: parse everything in memory, sort, send.
+
+struct Event
+{
+  unsigned long mTick;
+  unsigned mTrack;
+  unsigned long mIndex;
+  std::vector<byte> mBytes;
+
+  bool operator<(const Event& inOther) const
+  {
+    if (mTick != inOther.mTick) return mTick < inOther.mTick;
+    if (mTrack != inOther.mTrack) return mTrack < inOther.mTrack;
+    return mIndex < inOther.mIndex;
+  }
+};
+
+static unsigned long readNumber(const byte*& ioData)
+{
+  unsigned long value = 0;
+  byte b;
+  do
+  {
+    b = *ioData++;
+    value = (value << 7) | (b & 0x7f);
+  }
+  while (b & 0x80);
+  return value;
+}
+
+static void render(const byte* inFile, size_t inSize, Interface& ioMidi)
+{
+  std::vector<Event> events;
+  const byte* data = inFile + 8 + midi::Smf::readUInt32(inFile + 4);
+  unsigned track = 0;
+  while (data < inFile + inSize)
+  {
+    const unsigned long length = midi::Smf::readUInt32(data + 4);
+    const byte* end = data + 8 + length;
+    data += 8;
+    unsigned long tick = 0;
+    byte runningStatus = 0;
+    while (data < end)
+    {
+      Event event;
+      tick += readNumber(data);
+      event.mTick  = tick;
+      event.mTrack = track;
+      event.mIndex = events.size();
+      byte status = *data;
+      if (status < 0x80) status = runningStatus; else data++;
+      event.mBytes.push_back(status);
+      if (status < 0xf0)
+      {
+        runningStatus = status;
+        const unsigned size = midi::Smf::getDataSize(status);
+        event.mBytes.insert(event.mBytes.end(), data, data + size);
+        data += size;
+      }
+      else
+      {
+        if (status == 0xff) event.mBytes.push_back(*data++);
+        const unsigned long size = readNumber(data);
+        event.mBytes.insert(event.mBytes.end(), data, data + size);
+        data += size;
+      }
+      if (status != 0xff) events.push_back(event);
+    }
+    data = end;
+    track++;
+  }
+
+  std::sort(events.begin(), events.end());
+  for (size_t i = 0; i < events.size(); ++i)
+  {
+    const std::vector<byte>& bytes = events[i].mBytes;
+    const byte status = bytes[0];
+    if (status < 0xf0)
+      ioMidi.send(midi::MidiType(status & 0xf0), bytes[1], bytes.size() > 2 ? bytes[2] : 0, (status & 0x0f) + 1);
+    else if (status == 0xf0)
+      ioMidi.sendSysEx(unsigned(bytes.size() - 2), &bytes[1]);
+    else
+      ioMidi.sendRealTime(midi::MidiType(bytes[1]));
+  }
+}
+
+// -----------------------------------------------------------------------------
+
+static long getPeakMemoryKB()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+template<unsigned WindowSize>
+static void benchmark(const midi::MappedFile& inFile, Interface& ioMidi, midi::MockSerial& ioSerial)
+{
+  typedef midi::SmfPlayer<Interface, midi::SmfMemorySource, 64, WindowSize> Player;
+  midi::SmfMemorySource source(inFile.getData(), inFile.getSize());
+  Player player(ioMidi, source);
+  player.begin();
+  ioSerial.setCaptureOutput(false);
+
+  // Flat out: 15 minutes of song per update.
+  double best = 1e30;
+  unsigned long events = 0;
+  for (unsigned run = 0; run < 3; ++run)
+  {
+    player.rewind();
+    const Clock::time_point start = Clock::now();
+    player.play(0);
+    for (unsigned long now = 0; !player.isFinished(); )
+    {
+      player.update(now += 900000000UL);
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    best = seconds < best ? seconds : best;
+    events = player.getEventCount();
+  }
+
+  // Scheduled: 1ms steps of virtual time, as a loop() would.
+  player.rewind();
+  player.play(0);
+  unsigned long long now = 0;
+  unsigned worstBurst = 0;
+  const Clock::time_point start = Clock::now();
+  while (!player.isFinished())
+  {
+    now += 1000;
+    const unsigned burst = player.update((unsigned long)now);
+    worstBurst = burst > worstBurst ? burst : worstBurst;
+  }
+  const double scheduled = std::chrono::duration<double>(Clock::now() - start).count();
+
+  printf("  window %3u: %6.2f M events/s flat out, %6.2f M events/s in 1ms steps "
+         "(%lu steps, %u events max per step), player %zu bytes\n",
+         WindowSize, events / best / 1e6, events / scheduled / 1e6,
+         (unsigned long)(now / 1000), worstBurst, sizeof(Player));
+}
+
+int main(int argc, char** argv)
+{
+  const char* path = argc > 1 ? argv[1] : sGeneratedPath;
+  if (argc <= 1)
+  {
+    std::vector<byte> data;
+    generateFile(32, 200000, data);
+    FILE* file = fopen(path, "wb");
+    if (file == 0 || fwrite(&data[0], 1, data.size(), file) != data.size())
+    {
+      fprintf(stderr, "Cannot write %s\n", path);
+      return 1;
+    }
+    fclose(file);
+  }
+
+  const long baseMemory = getPeakMemoryKB();
+  midi::MappedFile file;
+  if (!file.open(path))
+  {
+    fprintf(stderr, "Cannot open %s\n", path);
+    return 1;
+  }
+
+  static midi::MockSerial serial;
+  static Interface midi(serial);
+  midi.begin(MIDI_CHANNEL_OMNI);
+
+  midi::SmfMemorySource source(file.getData(), file.getSize());
+  midi::SmfPlayer<Interface, midi::SmfMemorySource, 64> player(midi, source);
+  if (!player.begin())
+  {
+    fprintf(stderr, "%s: not a Standard MIDI File\n", path);
+    return 1;
+  }
+  printf("%s: %zu bytes, format %u, %u tracks, division %u\n", path, file.getSize(),
+         player.getFormat(), player.getTrackCount(), player.getDivision());
+
+  benchmark<16>(file, midi, serial);
+  benchmark<64>(file, midi, serial);
+  benchmark<255>(file, midi, serial);
+  printf("peak resident memory: %ld kB before playing, %ld kB after "
+         "(mapped pages read included, the player allocates nothing)\n",
+         baseMemory, getPeakMemoryKB());
+
+  // Check against the reference, for the generated file (the reference
+  // parser only knows what the generator writes).
+  int result = checkInterleavedSysEx() ? 0 : 1;
+  result |= checkSeek() ? 0 : 1;
+  if (argc <= 1)
+  {
+    serial.setCaptureOutput(true);
+    serial.clearOutput();
+    player.play(0);
+    for (unsigned long now = 0; !player.isFinished(); )
+    {
+      player.update(now += 900000000UL);
+    }
+    const std::vector<byte> output = serial.getOutput();
+    serial.clearOutput();
+    render(file.getData(), file.getSize(), midi);
+    const bool same = output == serial.getOutput();
+    printf("output %s the reference (%zu bytes)\n", same ? "matches" : "DIFFERS FROM", output.size());
+    serial.clearOutput();
+    result |= same ? 0 : 1;
+  }
+  return result;
+}
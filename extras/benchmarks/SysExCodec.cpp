@@ -0,0 +1,279 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+  Host benchmark for encodeSysEx / decodeSysEx.
+
+  Compares the library codec against the original byte-at-a-time
+  implementation, after checking they are equivalent: every length up to
+  several blocks, at every alignment, with all MSB patterns, and the decode
+  of arbitrary bytes (high bits included). Both the 64-bit word kernels and
+  the per-block path (used on 32-bit targets) are checked, the latter built
+  here in its own namespace.
+
+  Build & run from this directory:
+    c++ -O2 -I../../src SysExCodec.cpp ../../src/XE_MIDI.cpp -o SysExCodec
+    ./SysExCodec [size in bytes]
+*/
+
+#include <XE_MIDI.h>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+// Per-block codec, as built without the word kernels.
+#undef MIDI_NAMESPACE
+#define MIDI_NAMESPACE blockcodec
+#define MIDI_SYSEX_WORD_KERNELS 0
+#include "XE_MIDI.cpp"
+#undef MIDI_SYSEX_WORD_KERNELS
+#undef MIDI_NAMESPACE
+#define MIDI_NAMESPACE midi
+
+// Path of the library codec, as chosen in XE_MIDI.cpp.
+#if defined(__LP64__) || defined(_WIN64)
+static const char* const sLibraryPath = "64-bit word";
+#else
+static const char* const sLibraryPath = "per-block";
+#endif
+
+// -----------------------------------------------------------------------------
+// Original byte-at-a-time codec, for reference.
+
+static unsigned referenceEncodeSysEx(const byte* inData, byte* outSysEx, unsigned inLength)
+{
+  unsigned outLength  = 0;
+  byte count          = 0;
+  outSysEx[0]         = 0;
+
+  for (unsigned i = 0; i < inLength; ++i)
+  {
+    const byte data = inData[i];
+    const byte msb  = data >> 7;
+    const byte body = data & 0x7f;
+
+    outSysEx[0] |= (msb << (6 - count));
+    outSysEx[1 + count] = body;
+
+    if (count++ == 6)
+    {
+      outSysEx   += 8;
+      outLength  += 8;
+      outSysEx[0] = 0;
+      count       = 0;
+    }
+  }
+  return outLength + count + (count != 0 ? 1 : 0);
+}
+
+static unsigned referenceDecodeSysEx(const byte* inSysEx, byte* outData, unsigned inLength)
+{
+  unsigned count  = 0;
+  byte msbStorage = 0;
+  byte byteIndex  = 0;
+
+  for (unsigned i = 0; i < inLength; ++i)
+  {
+    if ((i % 8) == 0)
+    {
+      msbStorage = inSysEx[i];
+      byteIndex  = 6;
+    }
+    else
+    {
+      const byte body = inSysEx[i];
+      const byte msb  = ((msbStorage >> byteIndex--) & 1) << 7;
+      outData[count++] = msb | body;
+    }
+  }
+  return count;
+}
+
+// -----------------------------------------------------------------------------
+
+typedef unsigned (*Codec)(const byte*, byte*, unsigned);
+
+// -----------------------------------------------------------------------------
+// Equivalence checks
+
+static const unsigned sMaxLength = 8 * 8 + 7;   ///< Raw bytes: 9 blocks and a partial one.
+static const unsigned sMaxOffset = 8;
+static const unsigned sGuard     = 16;          ///< Bytes after the output, never written.
+static const byte     sFill      = 0xa5;
+
+static unsigned sFailures = 0;
+
+static void check(bool inCondition, const char* inName, unsigned inLength,
+                  unsigned inInputOffset, unsigned inOutputOffset)
+{
+  if (!inCondition)
+  {
+    if (sFailures < 10)
+    {
+      printf("  FAIL: %s, length %u, offsets %u/%u\n", inName, inLength, inInputOffset, inOutputOffset);
+    }
+    sFailures++;
+  }
+}
+
+// Runs a codec and the reference on the same input, at the given alignments
+// of input and output, and compares lengths and outputs.
+static void compare(const char* inName, Codec inCodec, Codec inReference,
+                    const byte* inData, unsigned inLength,
+                    unsigned inInputOffset, unsigned inOutputOffset)
+{
+  byte input[sMaxOffset + 2 * sMaxLength];
+  byte output[sMaxOffset + 2 * sMaxLength + sGuard];
+  byte expected[sMaxOffset + 2 * sMaxLength + sGuard];
+
+  memcpy(input + inInputOffset, inData, inLength);
+  memset(output, sFill, sizeof(output));
+  memset(expected, sFill, sizeof(expected));
+
+  const unsigned length         = inCodec(input + inInputOffset, output + inOutputOffset, inLength);
+  const unsigned expectedLength = inReference(input + inInputOffset, expected + inOutputOffset, inLength);
+
+  // The reference writes the header of the next block ahead, only the
+  // library must leave the bytes after its output untouched.
+  const unsigned end = inOutputOffset + expectedLength;
+  bool untouched = true;
+  for (unsigned i = end; i < sizeof(output); ++i)
+  {
+    untouched &= output[i] == sFill;
+  }
+  check(length == expectedLength && memcmp(output, expected, end) == 0 && untouched,
+        inName, inLength, inInputOffset, inOutputOffset);
+}
+
+static void checkCodec(const char* inEncodeName, Codec inEncode,
+                       const char* inDecodeName, Codec inDecode)
+{
+  byte data[2 * sMaxLength];
+
+  // Every length and alignment, on random bytes (half of them with the MSB).
+  for (unsigned length = 0; length <= sMaxLength; ++length)
+  {
+    for (unsigned inputOffset = 0; inputOffset < sMaxOffset; ++inputOffset)
+    {
+      for (unsigned outputOffset = 0; outputOffset < sMaxOffset; ++outputOffset)
+      {
+        for (unsigned i = 0; i < length; ++i)
+        {
+          data[i] = byte(rand());
+        }
+        compare(inEncodeName, inEncode, referenceEncodeSysEx, data, length, inputOffset, outputOffset);
+
+        // Decode arbitrary bytes, not only valid SysEx data: encoded lengths
+        // go up to sMaxLength + sMaxLength / 7 + 1.
+        const unsigned encodedLength = length + length / 7 + 1;
+        for (unsigned i = 0; i < encodedLength; ++i)
+        {
+          data[i] = byte(rand());
+        }
+        compare(inDecodeName, inDecode, referenceDecodeSysEx, data, encodedLength, inputOffset, outputOffset);
+      }
+    }
+  }
+
+  // Every MSB pattern of a full block, and every header byte, at every
+  // position of the block in a longer message.
+  for (unsigned pattern = 0; pattern < 256; ++pattern)
+  {
+    for (unsigned block = 0; block < 3; ++block)
+    {
+      for (unsigned i = 0; i < 3 * 8; ++i)
+      {
+        data[i] = byte(rand()) & 0x7f;
+      }
+      for (unsigned i = 0; i < 7; ++i)
+      {
+        data[block * 7 + i] |= (pattern << (7 - i)) & 0x80;
+      }
+      compare(inEncodeName, inEncode, referenceEncodeSysEx, data, 3 * 7, 0, block);
+
+      data[block * 8] = byte(pattern);
+      compare(inDecodeName, inDecode, referenceDecodeSysEx, data, 3 * 8, block, 0);
+    }
+  }
+}
+
+static double measure(Codec inCodec, const std::vector<byte>& inData,
+                      std::vector<byte>& outData, unsigned inLength)
+{
+  typedef std::chrono::steady_clock Clock;
+
+  // Repeat until at least 200ms were spent, keep the best run.
+  double best = 1e30;
+  const Clock::time_point begin = Clock::now();
+  do
+  {
+    const Clock::time_point start = Clock::now();
+    inCodec(&inData[0], &outData[0], inLength);
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    best = seconds < best ? seconds : best;
+  }
+  while (Clock::now() - begin < std::chrono::milliseconds(200));
+
+  return double(inLength) / best / 1e6;
+}
+
+int main(int argc, char** argv)
+{
+  const unsigned size = argc > 1 ? unsigned(atoi(argv[1])) : 1024 * 1024;
+
+  std::vector<byte> raw(size);
+  std::vector<byte> encoded(size + size / 7 + 8);
+  std::vector<byte> reference(encoded.size());
+  std::vector<byte> decoded(size + 8);
+
+  srand(42);
+  for (unsigned i = 0; i < size; ++i)
+  {
+    raw[i] = byte(rand());
+  }
+
+  printf("SysEx codec equivalence (%s library path):\n",
+         sLibraryPath);
+  checkCodec("encode", midi::encodeSysEx, "decode", midi::decodeSysEx);
+  checkCodec("block encode", blockcodec::encodeSysEx, "block decode", blockcodec::decodeSysEx);
+
+  const unsigned encodedLength = midi::encodeSysEx(&raw[0], &encoded[0], size);
+  const unsigned referenceLength = referenceEncodeSysEx(&raw[0], &reference[0], size);
+  const unsigned decodedLength = midi::decodeSysEx(&encoded[0], &decoded[0], encodedLength);
+
+  check(encodedLength == referenceLength &&
+        memcmp(&encoded[0], &reference[0], encodedLength) == 0, "large encode", size, 0, 0);
+  check(decodedLength == size && memcmp(&decoded[0], &raw[0], size) == 0, "large round trip", size, 0, 0);
+  printf("  %s (%u failures)\n", sFailures == 0 ? "all passed" : "FAILED", sFailures);
+  if (sFailures != 0)
+  {
+    return 1;
+  }
+
+  printf("SysEx codec, %u bytes (MB/s of input):\n", size);
+  printf("  encode  reference %8.1f  library %8.1f\n",
+         measure(referenceEncodeSysEx, raw, reference, size),
+         measure(midi::encodeSysEx,    raw, encoded,   size));
+  printf("  decode  reference %8.1f  library %8.1f\n",
+         measure(referenceDecodeSysEx, encoded, decoded, encodedLength),
+         measure(midi::decodeSysEx,    encoded, decoded, encodedLength));
+  return 0;
+}
@@ -0,0 +1,335 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+/*
+  Host benchmark: queueing delays of a MIDI device on simulated 31250 baud
+  links (see extras/host/UartSimulator.h), in virtual time.
+
+  Traffic sources are scheduled on their own links ahead of time, a device
+  loop runs MidiInterface instances as an Arduino would (each iteration
+  costing sLoopTime), and a sink timestamps what comes out. Latency is
+  measured from the end of a message on the input wire to the end of the
+  same message on the output wire.
+
+  Scenarios:
+  - thru: note chords through the soft thru.
+  - merge: two inputs merged on one output (as in the DualMerger example),
+    below and above the output link capacity.
+  - sysex + clock: SysEx dumps on one input, MIDI clock on the other.
+
+  Build & run from this directory:
+    c++ -O2 -I../../src -I../host UartLatency.cpp ../../src/XE_MIDI.cpp -o UartLatency
+    ./UartLatency
+*/
+
+#include <XE_MIDI.h>
+#include <UartSimulator.h>
+#include <algorithm>
+#include <map>
+#include <stdio.h>
+#include <vector>
+
+using midi::SimulatedTime;
+using midi::SimulatedUart;
+using midi::VirtualClock;
+
+static const SimulatedTime sLoopTime = 10;        // us per loop() iteration
+static const SimulatedTime sDuration = 20000000;  // 20 s of traffic
+
+struct DeviceSettings : public midi::DefaultSettings
+{
+  static const unsigned SysExMaxSize = 2100;
+};
+
+typedef midi::MidiInterface<SimulatedUart, DeviceSettings> Interface;
+
+// -----------------------------------------------------------------------------
+
+/*! Matches messages seen on the output with the ones scheduled on inputs,
+  by kind (status byte, 0xf0 for SysEx), in order.
+*/
+class LatencyProbe
+{
+  public:
+    LatencyProbe()
+      : mStatus(0)
+      , mCount(0)
+    {
+    }
+
+    void schedule(SimulatedUart& ioSource, const byte* inMessage, unsigned inSize,
+                  SimulatedTime inTime)
+    {
+      SimulatedTime completion = 0;
+      for (unsigned i = 0; i < inSize; ++i)
+      {
+        completion = ioSource.writeAt(inMessage[i], inTime);
+      }
+      mSent[inMessage[0]].push_back(completion);
+    }
+
+    void receive(byte inData, SimulatedTime inTime)
+    {
+      if (inData >= 0xf8)
+      {
+        complete(inData, inTime);
+      }
+      else if (inData == 0xf7)
+      {
+        complete(0xf0, inTime);
+        mStatus = 0;
+      }
+      else if (inData >= 0x80)
+      {
+        mStatus = inData;
+        mCount  = 1;
+      }
+      else if (mStatus != 0 && mStatus < 0xf0)
+      {
+        const unsigned size = (mStatus & 0xe0) == 0xc0 ? 2 : 3;
+        if (++mCount == size)
+        {
+          complete(mStatus, inTime);
+          mCount = 1; // Running status
+        }
+      }
+    }
+
+    void print(const char* inName, byte inKind)
+    {
+      std::vector<SimulatedTime>& latencies = mLatencies[inKind];
+      const size_t lost = mSent[inKind].size();
+      if (latencies.empty())
+      {
+        printf("    %-10s no message out (%zu lost)\n", inName, lost);
+        return;
+      }
+      std::sort(latencies.begin(), latencies.end());
+      double sum = 0;
+      for (size_t i = 0; i < latencies.size(); ++i)
+      {
+        sum += double(latencies[i]);
+      }
+      printf("    %-10s %6zu msgs  mean %8.0f  p50 %8llu  p99 %8llu  max %8llu us  (%zu lost)\n",
+             inName, latencies.size(), sum / latencies.size(),
+             latencies[latencies.size() / 2],
+             latencies[latencies.size() * 99 / 100],
+             latencies.back(), lost);
+    }
+
+  private:
+    void complete(byte inKind, SimulatedTime inTime)
+    {
+      std::deque<SimulatedTime>& sent = mSent[inKind];
+      if (!sent.empty())
+      {
+        mLatencies[inKind].push_back(inTime - sent.front());
+        sent.pop_front();
+      }
+    }
+
+  private:
+    std::map<byte, std::deque<SimulatedTime> > mSent;
+    std::map<byte, std::vector<SimulatedTime> > mLatencies;
+    byte mStatus;
+    unsigned mCount;
+};
+
+// -----------------------------------------------------------------------------
+
+/*! Chords of 4 notes on a channel, every inPeriod. */
+static void scheduleChords(LatencyProbe& ioProbe, SimulatedUart& ioSource,
+                           byte inChannel, SimulatedTime inPeriod, SimulatedTime inOffset)
+{
+  for (SimulatedTime time = inOffset; time < sDuration; time += inPeriod)
+  {
+    for (byte note = 0; note < 4; ++note)
+    {
+      const byte message[3] = { byte(0x90 | inChannel), byte(60 + note * 4), 100 };
+      ioProbe.schedule(ioSource, message, 3, time);
+    }
+  }
+}
+
+static void drain(SimulatedUart& ioSink, LatencyProbe& ioProbe)
+{
+  while (ioSink.available())
+  {
+    const byte data = ioSink.read();
+    ioProbe.receive(data, ioSink.getLastReadTime());
+  }
+}
+
+/*! Send the message read on an interface to the output of another one. */
+static void forward(Interface& inFrom, Interface& ioTo)
+{
+  const midi::MidiType type = inFrom.getType();
+  if (type == midi::SystemExclusive)
+  {
+    ioTo.sendSysEx(inFrom.getSysExArrayLength(), inFrom.getSysExArray(), true);
+  }
+  else if (type >= midi::Clock)
+  {
+    ioTo.sendRealTime(type);
+  }
+  else
+  {
+    ioTo.send(type, inFrom.getData1(), inFrom.getData2(), inFrom.getChannel());
+  }
+}
+
+static void printPort(const char* inName, const SimulatedUart& inPort)
+{
+  printf("    %-10s rx overflows %lu, blocked in write %llu us\n", inName,
+         inPort.getRxOverflowCount(), inPort.getTxBlockedTime());
+}
+
+// -----------------------------------------------------------------------------
+
+static void runThru(SimulatedTime inChordPeriod)
+{
+  VirtualClock clock;
+  SimulatedUart source(clock), port(clock), sink(clock, 64, 1 << 20);
+  source.connect(port);
+  port.connect(sink);
+
+  static Interface interface(port);
+  interface.begin(MIDI_CHANNEL_OMNI);
+  interface.turnThruOn(midi::Thru::Full);
+
+  LatencyProbe probe;
+  scheduleChords(probe, source, 0, inChordPeriod, 0);
+
+  while (clock.now() < sDuration + 1000000)
+  {
+    interface.read();
+    drain(sink, probe);
+    clock.advance(sLoopTime);
+  }
+
+  printf("  thru, chords every %llu us (%.0f%% load):\n", inChordPeriod,
+         100.0 * 12 * port.getByteTime() / inChordPeriod);
+  probe.print("notes", 0x90);
+  printPort("device", port);
+}
+
+static void runMerge(SimulatedTime inChordPeriod)
+{
+  VirtualClock clock;
+  SimulatedUart sourceA(clock), sourceB(clock);
+  SimulatedUart portA(clock), portB(clock), sink(clock, 64, 1 << 20);
+  sourceA.connect(portA);
+  sourceB.connect(portB);
+  portA.connect(sink);
+
+  static Interface midiA(portA);
+  static Interface midiB(portB);
+  midiA.begin(MIDI_CHANNEL_OMNI);
+  midiB.begin(MIDI_CHANNEL_OMNI);
+  midiB.turnThruOff();
+
+  LatencyProbe probe;
+  scheduleChords(probe, sourceA, 0, inChordPeriod, 0);
+  scheduleChords(probe, sourceB, 1, inChordPeriod, inChordPeriod / 3);
+
+  while (clock.now() < sDuration + 1000000)
+  {
+    midiA.read(); // Thru on A
+    if (midiB.read())
+    {
+      forward(midiB, midiA);
+    }
+    drain(sink, probe);
+    clock.advance(sLoopTime);
+  }
+
+  printf("  merge, chords every %llu us on each input (%.0f%% output load):\n",
+         inChordPeriod, 100.0 * 24 * portA.getByteTime() / inChordPeriod);
+  probe.print("input A", 0x90);
+  probe.print("input B", 0x91);
+  printPort("port A", portA);
+  printPort("port B", portB);
+}
+
+static void runSysExAndClock()
+{
+  VirtualClock clock;
+  SimulatedUart sourceA(clock), sourceB(clock);
+  SimulatedUart portA(clock), portB(clock), sink(clock, 64, 1 << 20);
+  sourceA.connect(portA);
+  sourceB.connect(portB);
+  portA.connect(sink);
+
+  static Interface midiA(portA);
+  static Interface midiB(portB);
+  midiA.begin(MIDI_CHANNEL_OMNI);
+  midiB.begin(MIDI_CHANNEL_OMNI);
+  midiB.turnThruOff();
+
+  LatencyProbe probe;
+
+  // 2kB dumps every 2 seconds on A.
+  std::vector<byte> dump(2048, 0x55);
+  dump.front() = 0xf0;
+  dump.back()  = 0xf7;
+  for (SimulatedTime time = 0; time < sDuration; time += 2000000)
+  {
+    probe.schedule(sourceA, &dump[0], unsigned(dump.size()), time);
+  }
+
+  // Clock at 120 BPM (24 PPQN) on B.
+  const byte clockMessage = 0xf8;
+  for (SimulatedTime time = 0; time < sDuration; time += 20833)
+  {
+    probe.schedule(sourceB, &clockMessage, 1, time);
+  }
+
+  while (clock.now() < sDuration + 1000000)
+  {
+    midiA.read(); // Thru on A
+    if (midiB.read())
+    {
+      forward(midiB, midiA);
+    }
+    drain(sink, probe);
+    clock.advance(sLoopTime);
+  }
+
+  printf("  sysex + clock, 2kB dump every 2 s on A, 120 BPM clock on B:\n");
+  probe.print("sysex", 0xf0);
+  probe.print("clock", 0xf8);
+  printPort("port A", portA);
+  printPort("port B", portB);
+}
+
+// -----------------------------------------------------------------------------
+
+int main()
+{
+  printf("31250 baud links, %llu us per loop, %llu s of traffic (virtual time):\n",
+         sLoopTime, sDuration / 1000000);
+  runThru(20000);
+  runThru(4000);
+  runMerge(20000);
+  runMerge(8000);
+  runMerge(6000);
+  runSysExAndClock();
+  return 0;
+}
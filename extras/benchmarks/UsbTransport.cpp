@@ -0,0 +1,439 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+/*
+  Host conformance checks & benchmark for UsbTransport, built against the
+  MIDIUSB stand-in from extras/host.
+
+  Checks the USB-MIDI packets produced for every message type (Code Index
+  Numbers, SysEx packetization, real time interleaving, cable numbers,
+  batching), and the decoding of received packets through both the byte
+  path (read()) and the packet path (readPacket + read(packet)).
+  Then measures packets per second, MIDI bytes per packet and dropped
+  packets on the TX and RX paths.
+
+  Build & run from this directory:
+    c++ -O2 -I../../src -I../host UsbTransport.cpp ../../src/XE_MIDI.cpp -o UsbTransport
+    ./UsbTransport
+*/
+
+#include <MIDIUSB.h>
+#include <XE_MIDI.h>
+#include <XE_MIDI_UsbTransport.h>
+#include <chrono>
+#include <stdio.h>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+typedef midi::UsbTransport<256, 4> Transport;
+
+struct UsbSettings : public midi::DefaultSettings
+{
+  static const bool Use1ByteParsing = false;
+  static const unsigned SysExMaxSize = 4100;
+};
+
+typedef midi::MidiInterface<Transport, UsbSettings> Interface;
+
+static Transport sTransport;
+static midi::UsbCable<Transport> sCable2(sTransport, 2);
+static Interface sMidi(sTransport);
+static midi::MidiInterface<midi::UsbCable<Transport>, UsbSettings> sMidi2(sCable2);
+
+static unsigned sFailures = 0;
+
+static void check(bool inCondition, const char* inName)
+{
+  if (!inCondition)
+  {
+    printf("  FAIL: %s\n", inName);
+    sFailures++;
+  }
+}
+
+static bool isPacket(const midiEventPacket_t& inPacket,
+                     byte inHeader, byte inByte1, byte inByte2, byte inByte3)
+{
+  return inPacket.header == inHeader && inPacket.byte1 == inByte1 &&
+         inPacket.byte2  == inByte2  && inPacket.byte3 == inByte3;
+}
+
+/*! Flush the transport, and check that exactly one packet was sent. */
+static bool sentPacket(byte inHeader, byte inByte1, byte inByte2, byte inByte3)
+{
+  sTransport.flush();
+  std::deque<midiEventPacket_t>& sent = MidiUSB.getSent();
+  const bool result = sent.size() == 1 &&
+                      isPacket(sent.front(), inHeader, inByte1, inByte2, inByte3);
+  sent.clear();
+  return result;
+}
+
+// -----------------------------------------------------------------------------
+
+static void checkTransmit()
+{
+  MidiUSB.reset();
+  sMidi.begin(MIDI_CHANNEL_OMNI);
+  sMidi2.begin(MIDI_CHANNEL_OMNI);
+
+  sMidi.sendNoteOn(60, 100, 1);
+  check(sentPacket(0x09, 0x90, 60, 100), "tx note on");
+  sMidi.sendNoteOff(60, 0, 16);
+  check(sentPacket(0x08, 0x8f, 60, 0), "tx note off");
+  sMidi.sendAfterTouch(60, 10, 2);
+  check(sentPacket(0x0a, 0xa1, 60, 10), "tx poly pressure");
+  sMidi.sendControlChange(7, 127, 3);
+  check(sentPacket(0x0b, 0xb2, 7, 127), "tx control change");
+  sMidi.sendProgramChange(5, 4);
+  check(sentPacket(0x0c, 0xc3, 5, 0), "tx program change");
+  sMidi.sendAfterTouch(20, 5);
+  check(sentPacket(0x0d, 0xd4, 20, 0), "tx channel pressure");
+  sMidi.sendPitchBend(0, 6);
+  check(sentPacket(0x0e, 0xe5, 0x00, 0x40), "tx pitch bend");
+  sMidi.sendTimeCodeQuarterFrame(0x12);
+  check(sentPacket(0x02, 0xf1, 0x12, 0), "tx time code quarter frame");
+  sMidi.sendSongPosition(300);
+  check(sentPacket(0x03, 0xf2, 300 & 0x7f, 300 >> 7), "tx song position");
+  sMidi.sendSongSelect(3);
+  check(sentPacket(0x02, 0xf3, 3, 0), "tx song select");
+  sMidi.sendTuneRequest();
+  check(sentPacket(0x05, 0xf6, 0, 0), "tx tune request");
+  sMidi.sendRealTime(midi::Clock);
+  check(sentPacket(0x0f, 0xf8, 0, 0), "tx clock");
+  sMidi2.sendNoteOn(61, 90, 1);
+  check(sentPacket(0x29, 0x90, 61, 90), "tx cable 2");
+
+  // SysEx of every length modulo 3: start / continue packets, then the end
+  // packet matching the number of remaining bytes.
+  for (unsigned length = 0; length < 8; ++length)
+  {
+    byte data[8];
+    for (unsigned i = 0; i < length; ++i)
+    {
+      data[i] = byte(i + 1);
+    }
+    sMidi.sendSysEx(length, data);
+    sTransport.flush();
+
+    std::vector<byte> frame;
+    std::deque<midiEventPacket_t>& sent = MidiUSB.getSent();
+    bool valid = sent.size() == (length + 2 + 2) / 3;
+    for (size_t i = 0; i < sent.size(); ++i)
+    {
+      const byte cin = sent[i].header & 0x0f;
+      const byte size = midi::CodeIndexNumbers::getSize(cin);
+      const bool last = i + 1 == sent.size();
+      valid &= last ? (cin >= 0x05 && cin <= 0x07) : cin == 0x04;
+      frame.push_back(sent[i].byte1);
+      if (size > 1) frame.push_back(sent[i].byte2);
+      if (size > 2) frame.push_back(sent[i].byte3);
+    }
+    valid &= frame.size() == length + 2 && frame.front() == 0xf0 && frame.back() == 0xf7;
+    for (unsigned i = 0; valid && i < length; ++i)
+    {
+      valid &= frame[i + 1] == data[i];
+    }
+    sent.clear();
+    check(valid, "tx sysex packetization");
+  }
+
+  // Real time within SysEx goes out in its own packet, right away.
+  const byte interleaved[] = { 0xf0, 0x01, 0xf8, 0x02, 0x03, 0xf7 };
+  for (unsigned i = 0; i < sizeof(interleaved); ++i)
+  {
+    sTransport.write(interleaved[i]);
+  }
+  sTransport.flush();
+  {
+    std::deque<midiEventPacket_t>& sent = MidiUSB.getSent();
+    check(sent.size() == 3 &&
+          isPacket(sent[0], 0x0f, 0xf8, 0, 0) &&
+          isPacket(sent[1], 0x04, 0xf0, 0x01, 0x02) &&
+          isPacket(sent[2], 0x06, 0x03, 0xf7, 0),
+          "tx real time within sysex");
+    sent.clear();
+  }
+
+  // Batching: 16 packets per transfer, the rest on flush.
+  MidiUSB.reset();
+  for (unsigned i = 0; i < 20; ++i)
+  {
+    sMidi.sendNoteOn(60, 100, 1);
+  }
+  check(MidiUSB.getTransferCount() == 1 && MidiUSB.getSent().size() == 16, "tx batching");
+  sTransport.flush();
+  check(MidiUSB.getTransferCount() == 2 && MidiUSB.getSent().size() == 20, "tx flush");
+  MidiUSB.reset();
+}
+
+// -----------------------------------------------------------------------------
+
+struct Expected
+{
+  midiEventPacket_t mPacket;
+  midi::MidiType mType;
+  byte mData1;
+  byte mData2;
+};
+
+static void checkReceive()
+{
+  static const Expected expected[] = {
+    { { 0x09, 0x91, 60, 100 }, midi::NoteOn,               60,  100 },
+    { { 0x08, 0x81, 60, 10 },  midi::NoteOff,              60,  10 },
+    { { 0x0a, 0xa1, 60, 20 },  midi::AfterTouchPoly,       60,  20 },
+    { { 0x0b, 0xb1, 7, 127 },  midi::ControlChange,        7,   127 },
+    { { 0x0c, 0xc1, 5, 0 },    midi::ProgramChange,        5,   0 },
+    { { 0x0d, 0xd1, 30, 0 },   midi::AfterTouchChannel,    30,  0 },
+    { { 0x0e, 0xe1, 0, 64 },   midi::PitchBend,            0,   64 },
+    { { 0x02, 0xf1, 0x12, 0 }, midi::TimeCodeQuarterFrame, 0x12, 0 },
+    { { 0x03, 0xf2, 5, 2 },    midi::SongPosition,         5,   2 },
+    { { 0x02, 0xf3, 3, 0 },    midi::SongSelect,           3,   0 },
+    { { 0x05, 0xf6, 0, 0 },    midi::TuneRequest,          0,   0 },
+    { { 0x0f, 0xf8, 0, 0 },    midi::Clock,                0,   0 },
+    { { 0x0f, 0xfa, 0, 0 },    midi::Start,                0,   0 },
+  };
+  const unsigned count = sizeof(expected) / sizeof(expected[0]);
+
+  sMidi.begin(MIDI_CHANNEL_OMNI);
+  sMidi.turnThruOff();
+
+  for (unsigned path = 0; path < 2; ++path)
+  {
+    for (unsigned i = 0; i < count; ++i)
+    {
+      MidiUSB.inject(expected[i].mPacket);
+
+      bool received = false;
+      if (path == 0)
+      {
+        midi::UsbMidiEventPacket packet;
+        while (sTransport.readPacket(packet))
+        {
+          received |= sMidi.read(packet);
+        }
+      }
+      else
+      {
+        received = sMidi.read();
+      }
+
+      check(received &&
+            sMidi.getType()  == expected[i].mType &&
+            sMidi.getData1() == expected[i].mData1 &&
+            sMidi.getData2() == expected[i].mData2,
+            path == 0 ? "rx packet path" : "rx byte path");
+    }
+
+    // SysEx over 3 packets, with a clock packet in the middle.
+    MidiUSB.inject(0x04, 0xf0, 0x01, 0x02);
+    MidiUSB.inject(0x0f, 0xf8, 0, 0);
+    MidiUSB.inject(0x04, 0x03, 0x04, 0x05);
+    MidiUSB.inject(0x06, 0x06, 0xf7, 0);
+
+    unsigned clocks = 0;
+    bool sysEx = false;
+    if (path == 0)
+    {
+      midi::UsbMidiEventPacket packet;
+      while (sTransport.readPacket(packet))
+      {
+        if (sMidi.read(packet))
+        {
+          clocks += sMidi.getType() == midi::Clock;
+          sysEx  |= sMidi.getType() == midi::SystemExclusive && sMidi.getSysExArrayLength() == 8;
+        }
+      }
+    }
+    else
+    {
+      while (sTransport.available())
+      {
+        if (sMidi.read())
+        {
+          clocks += sMidi.getType() == midi::Clock;
+          sysEx  |= sMidi.getType() == midi::SystemExclusive && sMidi.getSysExArrayLength() == 8;
+        }
+      }
+    }
+    check(clocks == 1 && sysEx, path == 0 ? "rx packet path sysex" : "rx byte path sysex");
+  }
+
+  // Reserved Code Index Numbers and unknown cables are dropped.
+  MidiUSB.inject(0x00, 0x90, 60, 100);
+  MidiUSB.inject(0x01, 0x90, 60, 100);
+  MidiUSB.inject(0x59, 0x90, 60, 100);
+  check(!sMidi.read() && sTransport.available() == 0, "rx dropped packets");
+  MidiUSB.reset();
+}
+
+// -----------------------------------------------------------------------------
+
+template<class Function>
+static double measure(Function inFunction)
+{
+  double best = 1e30;
+  const Clock::time_point begin = Clock::now();
+  do
+  {
+    const Clock::time_point start = Clock::now();
+    inFunction();
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    best = seconds < best ? seconds : best;
+  }
+  while (Clock::now() - begin < std::chrono::milliseconds(200));
+  return best;
+}
+
+static void benchmarkTransmit(const char* inName, unsigned inMessages,
+                              void (*inSend)(unsigned))
+{
+  unsigned long packets = 0;
+  unsigned long bytes = 0;
+  unsigned long transfers = 0;
+  const double seconds = measure([&]()
+  {
+    MidiUSB.reset();
+    for (unsigned i = 0; i < inMessages; ++i)
+    {
+      inSend(i);
+    }
+    sTransport.flush();
+    packets   = MidiUSB.getSent().size();
+    transfers = MidiUSB.getTransferCount();
+  });
+
+  const std::deque<midiEventPacket_t>& sent = MidiUSB.getSent();
+  for (size_t i = 0; i < sent.size(); ++i)
+  {
+    bytes += midi::CodeIndexNumbers::getSize(sent[i].header & 0x0f);
+  }
+  printf("  %-22s %8.2f M packets/s  %4.2f bytes/packet  %5.1f packets/transfer\n",
+         inName, packets / seconds / 1e6, double(bytes) / packets,
+         double(packets) / transfers);
+}
+
+static void sendNotes(unsigned i)
+{
+  sMidi.sendNoteOn(i & 0x7f, 100, 1);
+}
+
+static void sendSysEx(unsigned)
+{
+  static byte data[4096] = { 0 };
+  sMidi.sendSysEx(sizeof(data), data);
+}
+
+static void sendMixed(unsigned i)
+{
+  switch (i % 4)
+  {
+    case 0:  sMidi.sendRealTime(midi::Clock); break;
+    case 1:  sMidi.sendProgramChange(i & 0x7f, 1); break;
+    default: sMidi.sendControlChange(1, i & 0x7f, 1); break;
+  }
+}
+
+static void benchmarkReceive(const char* inName, const std::vector<midiEventPacket_t>& inPackets)
+{
+  unsigned long messages[2] = { 0, 0 };
+  double seconds[2];
+  for (unsigned path = 0; path < 2; ++path)
+  {
+    seconds[path] = measure([&]()
+    {
+      MidiUSB.reset();
+      for (size_t i = 0; i < inPackets.size(); ++i)
+      {
+        MidiUSB.inject(inPackets[i]);
+      }
+      messages[path] = 0;
+      if (path == 0)
+      {
+        midi::UsbMidiEventPacket packet;
+        while (sTransport.readPacket(packet))
+        {
+          messages[path] += sMidi.read(packet);
+        }
+      }
+      else
+      {
+        while (sTransport.available())
+        {
+          messages[path] += sMidi.read();
+        }
+      }
+    });
+  }
+
+  unsigned long dropped = 0;
+  for (size_t i = 0; i < inPackets.size(); ++i)
+  {
+    dropped += midi::CodeIndexNumbers::getSize(inPackets[i].header & 0x0f) == 0 ? 1 : 0;
+  }
+  printf("  %-22s %8.2f / %8.2f M packets/s  (%lu messages, %lu dropped packets)\n",
+         inName, inPackets.size() / seconds[0] / 1e6, inPackets.size() / seconds[1] / 1e6,
+         messages[0], dropped);
+}
+
+// -----------------------------------------------------------------------------
+
+int main()
+{
+  printf("Conformance:\n");
+  checkTransmit();
+  checkReceive();
+  printf("  %s (%u failures)\n", sFailures == 0 ? "all passed" : "FAILED", sFailures);
+
+  printf("Transmit:\n");
+  sMidi.begin(MIDI_CHANNEL_OMNI);
+  benchmarkTransmit("notes",        4096, sendNotes);
+  benchmarkTransmit("sysex (4 kB)", 1,    sendSysEx);
+  benchmarkTransmit("mixed",        4096, sendMixed);
+
+  printf("Receive (packet path / byte path):\n");
+  sMidi.turnThruOff();
+
+  std::vector<midiEventPacket_t> notes, sysEx, mixed;
+  for (unsigned i = 0; i < 4096; ++i)
+  {
+    const midiEventPacket_t note = { 0x09, 0x90, byte(i & 0x7f), 100 };
+    notes.push_back(note);
+  }
+  for (unsigned i = 0; i < 1365; ++i)
+  {
+    const midiEventPacket_t data = { 0x04, byte(i == 0 ? 0xf0 : 0x55), 0x55, 0x55 };
+    sysEx.push_back(data);
+  }
+  const midiEventPacket_t end = { 0x06, 0x55, 0xf7, 0 };
+  sysEx.push_back(end);
+  for (unsigned i = 0; i < 4096; ++i)
+  {
+    // Every 16th packet uses a reserved Code Index Number.
+    const midiEventPacket_t packet = { byte(i % 16 == 0 ? 0x01 : 0x0b), 0xb0, 1, byte(i & 0x7f) };
+    mixed.push_back(packet);
+  }
+  benchmarkReceive("notes",        notes);
+  benchmarkReceive("sysex (4 kB)", sysEx);
+  benchmarkReceive("cc + reserved", mixed);
+
+  return sFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,134 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+/*
+  Host helper: file sink for CaptureRecorder (see XE_MIDI_Recorder.h), and
+  a reader for the resulting capture files.
+
+  Blocks are appended to the file as they are completed, so nothing is lost
+  when the RAM ring wraps around. A capture file is simply the sequence of
+  blocks, and blocks dumped from a device can be concatenated the same way.
+
+  Usage:
+    struct MySettings : public midi::DefaultSettings
+    {
+      typedef midi::CaptureRecorder<midi::SteadyClock, 255, 4,
+                                    midi::CaptureFileSink> Recorder;
+    };
+    MIDI.getRecorder().getSink().open("session.cap");
+    ...
+    MIDI.getRecorder().flush();
+    MIDI.getRecorder().getSink().close();
+*/
+
+#pragma once
+
+#include <XE_MIDI_Recorder.h>
+#include <stdio.h>
+#include <vector>
+
+BEGIN_MIDI_NAMESPACE
+
+class CaptureFileSink
+{
+  public:
+    inline CaptureFileSink()
+      : mFile(0)
+      , mBytesWritten(0)
+    {
+    }
+
+    inline ~CaptureFileSink()
+    {
+      close();
+    }
+
+    inline bool open(const char* inPath)
+    {
+      close();
+      mFile = fopen(inPath, "wb");
+      mBytesWritten = 0;
+      return mFile != 0;
+    }
+
+    inline void close()
+    {
+      if (mFile != 0)
+      {
+        fclose(mFile);
+        mFile = 0;
+      }
+    }
+
+    inline void write(const byte* inBlock, unsigned inSize)
+    {
+      if (mFile != 0)
+      {
+        mBytesWritten += fwrite(inBlock, 1, inSize, mFile);
+      }
+    }
+
+    inline unsigned long getBytesWritten() const
+    {
+      return mBytesWritten;
+    }
+
+  private:
+    FILE* mFile;
+    unsigned long mBytesWritten;
+};
+
+/*! \brief Load a capture file, and locate its blocks.
+  \return false if the file can't be read, or holds a malformed block.
+*/
+inline bool readCaptureFile(const char* inPath, std::vector<byte>& outData,
+                            std::vector<unsigned>& outBlockOffsets)
+{
+  outData.clear();
+  outBlockOffsets.clear();
+
+  FILE* file = fopen(inPath, "rb");
+  if (file == 0)
+  {
+    return false;
+  }
+  byte buffer[4096];
+  size_t count = 0;
+  while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+  {
+    outData.insert(outData.end(), buffer, buffer + count);
+  }
+  fclose(file);
+
+  for (size_t offset = 0; offset < outData.size(); )
+  {
+    if (outData.size() - offset < CaptureFormat::sHeaderSize ||
+        outData[offset + 4] < CaptureFormat::sHeaderSize ||
+        outData[offset + 4] > outData.size() - offset)
+    {
+      return false;
+    }
+    outBlockOffsets.push_back(unsigned(offset));
+    offset += outData[offset + 4];
+  }
+  return true;
+}
+
+END_MIDI_NAMESPACE
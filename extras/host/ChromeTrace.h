@@ -0,0 +1,108 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+/*
+  Host helper: export a TraceRing (see XE_MIDI_Trace.h) as Chrome trace
+  JSON, to be opened in chrome://tracing or https://ui.perfetto.dev.
+
+  Begin / end pairs are matched as nested pairs (eg: a Clock parsed inside
+  a SysEx frame), and written as complete ("X") events, so events cut by the
+  ring wrapping around don't leave open slices behind.
+
+  Usage:
+    FILE* file = fopen("trace.json", "w");
+    midi::writeChromeTrace(MIDI.getTracer(), file);
+    fclose(file);
+*/
+
+#pragma once
+
+#include <XE_MIDI_Trace.h>
+#include <stdio.h>
+#include <string.h>
+
+BEGIN_MIDI_NAMESPACE
+
+static inline const char* getTraceEventName(byte inEvent)
+{
+  static const char* const names[TraceEvent::Count] = {
+    "parse", "callback", "thru", "send"
+  };
+  return inEvent < TraceEvent::Count ? names[inEvent] : "unknown";
+}
+
+/*! \brief Write the records of a TraceRing as a Chrome trace JSON document.
+  \param inRing     The ring to export.
+  \param outFile    Destination file.
+  \param inThreadId Thread ID to use, to merge several interfaces in a trace.
+  \return The number of events written.
+*/
+template<class Ring>
+inline unsigned writeChromeTrace(const Ring& inRing, FILE* outFile, unsigned inThreadId = 0)
+{
+  // Stack of the pending begin records of each event.
+  static const unsigned sMaxDepth = 4;
+  unsigned begins[TraceEvent::Count][sMaxDepth];
+  unsigned depths[TraceEvent::Count] = { 0 };
+
+  unsigned written = 0;
+  fprintf(outFile, "{\"traceEvents\":[\n");
+
+  for (unsigned i = 0; i < inRing.getCount(); ++i)
+  {
+    const typename Ring::Record& record = inRing.get(i);
+    if (record.mEvent >= TraceEvent::Count)
+      continue;
+
+    unsigned* stack = begins[record.mEvent];
+    unsigned& depth = depths[record.mEvent];
+    if (record.mPhase == TraceEvent::Begin)
+    {
+      if (depth == sMaxDepth)
+      {
+        // Too deep to be real: drop the oldest begin.
+        memmove(stack, stack + 1, (sMaxDepth - 1) * sizeof(unsigned));
+        depth--;
+      }
+      stack[depth++] = i;
+      continue;
+    }
+    if (depth == 0)
+      continue; // Begin lost when the ring wrapped around.
+
+    const typename Ring::Record& begin = inRing.get(stack[--depth]);
+
+    fprintf(outFile,
+            "%s{\"name\":\"%s\",\"cat\":\"midi\",\"ph\":\"X\",\"ts\":%lu,\"dur\":%lu,"
+            "\"pid\":0,\"tid\":%u,\"args\":{\"type\":\"0x%02x\"}}",
+            written != 0 ? ",\n" : "",
+            getTraceEventName(record.mEvent),
+            begin.mTime,
+            record.mTime - begin.mTime,
+            inThreadId,
+            unsigned(record.mArgument));
+    written++;
+  }
+
+  fprintf(outFile, "\n]}\n");
+  return written;
+}
+
+END_MIDI_NAMESPACE
@@ -0,0 +1,124 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+/*
+  Host stand-in for the Arduino MIDIUSB library, so that UsbTransport can be
+  built and exercised on a computer (add this directory to the include path).
+
+  Packets from the host computer are injected in a queue, read back by
+  MidiUSB.read(). Packets written by the device are appended to another
+  queue, with counters of transfers (write calls) and flushes.
+  A single MidiUSB instance exists per translation unit.
+*/
+
+#pragma once
+
+#include <deque>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct
+{
+  uint8_t header;
+  uint8_t byte1;
+  uint8_t byte2;
+  uint8_t byte3;
+} midiEventPacket_t;
+
+class MIDI_
+{
+  public: // MIDIUSB API
+    MIDI_()
+      : mTransfers(0)
+      , mFlushes(0)
+    {
+    }
+
+    /*! \return The next packet from the host, or a null packet. */
+    midiEventPacket_t read()
+    {
+      if (mRx.empty())
+      {
+        const midiEventPacket_t none = { 0, 0, 0, 0 };
+        return none;
+      }
+      const midiEventPacket_t packet = mRx.front();
+      mRx.pop_front();
+      return packet;
+    }
+
+    size_t write(const uint8_t* inBuffer, size_t inSize)
+    {
+      mTransfers++;
+      for (size_t i = 0; i + 4 <= inSize; i += 4)
+      {
+        const midiEventPacket_t packet = {
+          inBuffer[i], inBuffer[i + 1], inBuffer[i + 2], inBuffer[i + 3]
+        };
+        mTx.push_back(packet);
+      }
+      return inSize;
+    }
+
+    void sendMIDI(midiEventPacket_t inPacket)
+    {
+      write(&inPacket.header, 4);
+    }
+
+    void flush()
+    {
+      mFlushes++;
+    }
+
+  public: // Test API
+    void inject(const midiEventPacket_t& inPacket)
+    {
+      mRx.push_back(inPacket);
+    }
+
+    void inject(uint8_t inHeader, uint8_t inByte1, uint8_t inByte2, uint8_t inByte3)
+    {
+      const midiEventPacket_t packet = { inHeader, inByte1, inByte2, inByte3 };
+      mRx.push_back(packet);
+    }
+
+    size_t getPendingRxCount() const { return mRx.size(); }
+
+    std::deque<midiEventPacket_t>& getSent() { return mTx; }
+
+    unsigned long getTransferCount() const { return mTransfers; }
+    unsigned long getFlushCount() const { return mFlushes; }
+
+    void reset()
+    {
+      mRx.clear();
+      mTx.clear();
+      mTransfers = 0;
+      mFlushes   = 0;
+    }
+
+  private:
+    std::deque<midiEventPacket_t> mRx;
+    std::deque<midiEventPacket_t> mTx;
+    unsigned long mTransfers;
+    unsigned long mFlushes;
+};
+
+static MIDI_ MidiUSB;
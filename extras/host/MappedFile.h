@@ -0,0 +1,109 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+/*
+  Host helper: read-only memory mapped file (POSIX), to give whole files to
+  sources like SmfMemorySource without reading them: the OS pages them in
+  as they are accessed.
+
+  Usage:
+    midi::MappedFile file;
+    if (file.open("song.mid"))
+    {
+      midi::SmfMemorySource source(file.getData(), file.getSize());
+      ...
+    }
+*/
+
+#pragma once
+
+#include <XE_MIDI_Defs.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+BEGIN_MIDI_NAMESPACE
+
+class MappedFile
+{
+  public:
+    inline MappedFile()
+      : mData(0)
+      , mSize(0)
+    {
+    }
+
+    inline ~MappedFile()
+    {
+      close();
+    }
+
+    inline bool open(const char* inPath)
+    {
+      close();
+      const int file = ::open(inPath, O_RDONLY);
+      if (file < 0)
+      {
+        return false;
+      }
+      struct stat status;
+      if (fstat(file, &status) == 0 && status.st_size > 0)
+      {
+        void* data = mmap(0, size_t(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        if (data != MAP_FAILED)
+        {
+          mData = static_cast<const byte*>(data);
+          mSize = size_t(status.st_size);
+        }
+      }
+      ::close(file);
+      return mData != 0;
+    }
+
+    inline void close()
+    {
+      if (mData != 0)
+      {
+        munmap(const_cast<byte*>(mData), mSize);
+        mData = 0;
+        mSize = 0;
+      }
+    }
+
+    inline const byte* getData() const
+    {
+      return mData;
+    }
+
+    inline size_t getSize() const
+    {
+      return mSize;
+    }
+
+  private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    const byte* mData;
+    size_t mSize;
+};
+
+END_MIDI_NAMESPACE
@@ -0,0 +1,140 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+/*
+  Host helper: in-memory SerialPort for MidiInterface, to run the library
+  on a computer (benchmarks, tools).
+
+  Input is read from a byte array, which can be rewound to replay it.
+  Output is appended to a vector, or only counted when capture is disabled
+  (to measure the library alone, without the cost of growing a vector).
+*/
+
+#pragma once
+
+#include <XE_MIDI_Defs.h>
+#include <vector>
+
+BEGIN_MIDI_NAMESPACE
+
+class MockSerial
+{
+  public:
+    inline MockSerial()
+      : mInput(0)
+      , mInputSize(0)
+      , mReadIndex(0)
+      , mBytesWritten(0)
+      , mCaptureOutput(true)
+    {
+    }
+
+  public: // Serial API, as used by MidiInterface
+    inline void begin(unsigned)
+    {
+    }
+
+    inline unsigned available() const
+    {
+      return unsigned(mInputSize - mReadIndex);
+    }
+
+    inline byte read()
+    {
+      return mInput[mReadIndex++];
+    }
+
+    inline void write(byte inData)
+    {
+      if (mCaptureOutput)
+      {
+        mOutput.push_back(inData);
+      }
+      else
+      {
+        // Still store the data somewhere, so writes are not optimised out.
+        mScratch[mBytesWritten % sScratchSize] = inData;
+      }
+      mBytesWritten++;
+    }
+
+    inline size_t write(const byte* inData, size_t inSize)
+    {
+      for (size_t i = 0; i < inSize; ++i)
+      {
+        write(inData[i]);
+      }
+      return inSize;
+    }
+
+  public:
+    /*! Set the input data, which must stay valid while being read. */
+    inline void setInput(const byte* inData, size_t inSize)
+    {
+      mInput     = inData;
+      mInputSize = inSize;
+      mReadIndex = 0;
+    }
+
+    inline void setInput(const std::vector<byte>& inData)
+    {
+      setInput(inData.empty() ? 0 : &inData[0], inData.size());
+    }
+
+    /*! Read the input again from its start. */
+    inline void rewind()
+    {
+      mReadIndex = 0;
+    }
+
+    inline void setCaptureOutput(bool inCapture)
+    {
+      mCaptureOutput = inCapture;
+    }
+
+    inline const std::vector<byte>& getOutput() const
+    {
+      return mOutput;
+    }
+
+    inline size_t getBytesWritten() const
+    {
+      return mBytesWritten;
+    }
+
+    inline void clearOutput()
+    {
+      mOutput.clear();
+      mBytesWritten = 0;
+    }
+
+  private:
+    static const unsigned sScratchSize = 64;
+
+    const byte* mInput;
+    size_t mInputSize;
+    size_t mReadIndex;
+    std::vector<byte> mOutput;
+    byte mScratch[sScratchSize];
+    size_t mBytesWritten;
+    bool mCaptureOutput;
+};
+
+END_MIDI_NAMESPACE
@@ -0,0 +1,94 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+/*
+  Host helper: file sink for SmfWriter (see XE_MIDI_SmfWriter.h) and
+  SmfPlayer::writeSeekIndex.
+
+  Usage:
+    midi::SmfFileSink file;
+    midi::SmfWriter<midi::SmfFileSink, 4096> writer(file);
+    file.open("session.mid");
+    writer.begin(now);
+    ...
+    writer.end(now);
+    file.close();
+*/
+
+#pragma once
+
+#include <XE_MIDI_Smf.h>
+#include <stdio.h>
+
+BEGIN_MIDI_NAMESPACE
+
+class SmfFileSink
+{
+  public:
+    inline SmfFileSink()
+      : mFile(0)
+      , mPosition(0)
+    {
+    }
+
+    inline ~SmfFileSink()
+    {
+      close();
+    }
+
+    inline bool open(const char* inPath)
+    {
+      close();
+      mFile = fopen(inPath, "wb");
+      mPosition = 0;
+      return mFile != 0;
+    }
+
+    inline void close()
+    {
+      if (mFile != 0)
+      {
+        fclose(mFile);
+        mFile = 0;
+      }
+    }
+
+    inline unsigned write(unsigned long inOffset, const byte* inData, unsigned inSize)
+    {
+      if (mFile == 0)
+      {
+        return 0;
+      }
+      // Only seek when writing out of order (eg: the track length).
+      if (inOffset != mPosition && fseek(mFile, long(inOffset), SEEK_SET) != 0)
+      {
+        return 0;
+      }
+      const size_t count = fwrite(inData, 1, inSize, mFile);
+      mPosition = inOffset + count;
+      return unsigned(count);
+    }
+
+  private:
+    FILE* mFile;
+    unsigned long mPosition;
+};
+
+END_MIDI_NAMESPACE
@@ -0,0 +1,206 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+/*
+  Host helper: seeded, reproducible MIDI byte streams from traffic profiles,
+  for benchmarks and worst-case testing of the parser.
+
+  The random generator is implemented here (xorshift32), so a given profile,
+  seed and size give the same bytes on every platform.
+*/
+
+#pragma once
+
+#include <XE_MIDI_Defs.h>
+#include <string.h>
+#include <vector>
+
+BEGIN_MIDI_NAMESPACE
+
+struct TrafficProfile
+{
+  enum Profile
+  {
+    RunningStatusNotes = 0, ///< Note On/Off streams using running status.
+    ControllerFlood,        ///< Dense Control Change / Pitch Bend sweeps.
+    ClockInSysEx,           ///< Large SysEx frames with dense interleaved clock.
+    Garbage,                ///< Undefined bytes (0xf9, 0xfd), stray data, cut messages.
+    Mixed,                  ///< All of the above, message by message.
+    Count,
+  };
+
+  static inline const char* getName(Profile inProfile)
+  {
+    static const char* const names[Count] = {
+      "notes", "controllers", "sysex-clock", "garbage", "mixed"
+    };
+    return inProfile < Count ? names[inProfile] : 0;
+  }
+
+  /*! \return The profile with this name, or Count if unknown. */
+  static inline Profile fromName(const char* inName)
+  {
+    for (unsigned i = 0; i < Count; ++i)
+    {
+      if (strcmp(inName, getName(Profile(i))) == 0)
+        return Profile(i);
+    }
+    return Count;
+  }
+};
+
+// -----------------------------------------------------------------------------
+
+class TrafficGenerator
+{
+  public:
+    inline explicit TrafficGenerator(unsigned inSeed)
+      : mState(inSeed != 0 ? inSeed : 0x9e3779b9)
+      , mRunningStatus(0)
+    {
+    }
+
+    /*! Append at least inSize bytes of the given profile to a stream
+      (whole messages are generated, so it can be slightly more).
+    */
+    inline void generate(TrafficProfile::Profile inProfile, size_t inSize,
+                         std::vector<byte>& outStream)
+    {
+      const size_t end = outStream.size() + inSize;
+      while (outStream.size() < end)
+      {
+        TrafficProfile::Profile profile = inProfile;
+        if (profile == TrafficProfile::Mixed)
+        {
+          profile = TrafficProfile::Profile(random(TrafficProfile::Mixed));
+        }
+        generateMessage(profile, outStream);
+      }
+    }
+
+  private:
+    inline unsigned random(unsigned inRange)
+    {
+      mState ^= mState << 13;
+      mState ^= mState >> 17;
+      mState ^= mState << 5;
+      return mState % inRange;
+    }
+
+    inline byte data()
+    {
+      return byte(random(128));
+    }
+
+    inline void status(byte inStatus, std::vector<byte>& outStream)
+    {
+      if (inStatus != mRunningStatus)
+      {
+        outStream.push_back(inStatus);
+      }
+      mRunningStatus = inStatus < 0xf0 ? inStatus : 0;
+    }
+
+    inline void generateMessage(TrafficProfile::Profile inProfile,
+                                std::vector<byte>& outStream)
+    {
+      switch (inProfile)
+      {
+        case TrafficProfile::RunningStatusNotes:
+        {
+          // Mostly on a single channel, sometimes switching.
+          const byte channel = random(8) == 0 ? byte(random(16)) : 0;
+          status((random(2) ? 0x90 : 0x80) | channel, outStream);
+          outStream.push_back(data());
+          outStream.push_back(data());
+          break;
+        }
+
+        case TrafficProfile::ControllerFlood:
+        {
+          const byte channel = byte(random(16));
+          if (random(4) == 0)
+          {
+            status(0xe0 | channel, outStream);
+            outStream.push_back(data());
+            outStream.push_back(data());
+          }
+          else
+          {
+            status(0xb0 | channel, outStream);
+            for (unsigned i = random(32); i != 0; --i)
+            {
+              outStream.push_back(byte(random(64)));
+              outStream.push_back(data());
+            }
+            outStream.push_back(byte(random(64)));
+            outStream.push_back(data());
+          }
+          break;
+        }
+
+        case TrafficProfile::ClockInSysEx:
+        {
+          status(0xf0, outStream);
+          for (unsigned i = 64 + random(512); i != 0; --i)
+          {
+            outStream.push_back(data());
+            if (random(8) == 0)
+            {
+              outStream.push_back(0xf8);
+            }
+          }
+          outStream.push_back(0xf7);
+          break;
+        }
+
+        case TrafficProfile::Garbage:
+        {
+          switch (random(4))
+          {
+            case 0:
+              outStream.push_back(random(2) ? 0xf9 : 0xfd);
+              break;
+            case 1:
+              outStream.push_back(data()); // Stray data
+              break;
+            case 2:
+              outStream.push_back(0x90 | byte(random(16))); // Cut message
+              outStream.push_back(data());
+              break;
+            default:
+              outStream.push_back(0xf7); // EOX without SysEx
+              break;
+          }
+          mRunningStatus = 0; // Not reliable anymore
+          break;
+        }
+
+        default:
+          break;
+      }
+    }
+
+  private:
+    uint32_t mState;
+    byte mRunningStatus;
+};
+
+END_MIDI_NAMESPACE
@@ -0,0 +1,241 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+/*
+  Host helper: wire-accurate serial link simulation, to observe output
+  congestion and queueing delays that instant mock ports hide.
+
+  SimulatedUart implements the SerialPort API used by MidiInterface. Each
+  byte takes 10 bit times on the wire (320us at 31250 baud), the TX FIFO has
+  a fixed depth (write blocks while it is full, like HardwareSerial), and the
+  RX FIFO drops bytes when it overflows.
+
+  Time comes from a VirtualClock shared by all ports. In the default
+  deterministic mode it only moves when advanced (by the simulation loop, or
+  by a blocking write), so runs are reproducible and need no real time. In
+  real time mode it follows std::chrono::steady_clock and advancing sleeps.
+*/
+
+#pragma once
+
+#include <XE_MIDI_Defs.h>
+#include <chrono>
+#include <deque>
+#include <thread>
+
+BEGIN_MIDI_NAMESPACE
+
+typedef unsigned long long SimulatedTime; ///< Microseconds
+
+class VirtualClock
+{
+  public:
+    inline VirtualClock()
+      : mNow(0)
+      , mRealTime(false)
+      , mStart(std::chrono::steady_clock::now())
+    {
+    }
+
+    inline void setRealTime(bool inRealTime)
+    {
+      mRealTime = inRealTime;
+      mStart    = std::chrono::steady_clock::now();
+      mNow      = 0;
+    }
+
+    inline SimulatedTime now() const
+    {
+      if (mRealTime)
+      {
+        return SimulatedTime(std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - mStart).count());
+      }
+      return mNow;
+    }
+
+    inline void advanceTo(SimulatedTime inTime)
+    {
+      if (mRealTime)
+      {
+        std::this_thread::sleep_until(mStart + std::chrono::microseconds(inTime));
+      }
+      else if (inTime > mNow)
+      {
+        mNow = inTime;
+      }
+    }
+
+    inline void advance(SimulatedTime inDuration)
+    {
+      advanceTo(now() + inDuration);
+    }
+
+  private:
+    SimulatedTime mNow;
+    bool mRealTime;
+    std::chrono::steady_clock::time_point mStart;
+};
+
+// -----------------------------------------------------------------------------
+
+class SimulatedUart
+{
+  public:
+    inline SimulatedUart(VirtualClock& inClock,
+                         unsigned inTxFifoSize = 64,
+                         unsigned inRxFifoSize = 64)
+      : mClock(inClock)
+      , mPeer(0)
+      , mByteTime(320)
+      , mTxFifoSize(inTxFifoSize)
+      , mRxFifoSize(inRxFifoSize)
+      , mLastTxCompletion(0)
+      , mLastReadTime(0)
+      , mRxOverflows(0)
+      , mTxBlockedTime(0)
+    {
+    }
+
+    /*! Wire the TX line of this port to the RX line of another one. */
+    inline void connect(SimulatedUart& ioPeer)
+    {
+      mPeer = &ioPeer;
+    }
+
+  public: // Serial API, as used by MidiInterface
+    inline void begin(unsigned long inBaudrate)
+    {
+      // 1 start bit, 8 data bits, 1 stop bit.
+      mByteTime = (10 * 1000000UL + inBaudrate / 2) / inBaudrate;
+    }
+
+    inline unsigned available()
+    {
+      receive();
+      return unsigned(mRxFifo.size());
+    }
+
+    inline byte read()
+    {
+      const WireByte data = mRxFifo.front();
+      mRxFifo.pop_front();
+      mLastReadTime = data.mTime;
+      return data.mData;
+    }
+
+    /*! Queue a byte, blocking (advancing the clock) while the TX FIFO is full. */
+    inline void write(byte inData)
+    {
+      const SimulatedTime now = mClock.now();
+      discardSentBytes(now);
+
+      if (mTxFifo.size() >= mTxFifoSize)
+      {
+        const SimulatedTime freed = mTxFifo.front() - mByteTime;
+        mTxBlockedTime += freed - now;
+        mClock.advanceTo(freed);
+        discardSentBytes(freed);
+      }
+      mTxFifo.push_back(writeAt(inData, mClock.now()));
+    }
+
+  public:
+    /*! Schedule a byte to be sent at a given time, without FIFO limit
+      (for traffic sources). Bytes are sent in the order they are written.
+      \return When the byte will be completely received by the peer.
+    */
+    inline SimulatedTime writeAt(byte inData, SimulatedTime inTime)
+    {
+      const SimulatedTime start = inTime > mLastTxCompletion ? inTime : mLastTxCompletion;
+      mLastTxCompletion = start + mByteTime;
+
+      if (mPeer != 0)
+      {
+        const WireByte wireByte = { inData, mLastTxCompletion };
+        mPeer->mWire.push_back(wireByte);
+      }
+      return mLastTxCompletion;
+    }
+
+    /*! When the last byte returned by read() was received. */
+    inline SimulatedTime getLastReadTime() const { return mLastReadTime; }
+
+    /*! When the TX line will be idle. */
+    inline SimulatedTime getTxIdleTime() const { return mLastTxCompletion; }
+
+    inline unsigned long getRxOverflowCount() const { return mRxOverflows; }
+
+    /*! Total time spent blocked in write(), waiting for the TX FIFO. */
+    inline SimulatedTime getTxBlockedTime() const { return mTxBlockedTime; }
+
+    inline SimulatedTime getByteTime() const { return mByteTime; }
+
+  private:
+    struct WireByte
+    {
+      byte mData;
+      SimulatedTime mTime; ///< End of the stop bit.
+    };
+
+    inline void receive()
+    {
+      const SimulatedTime now = mClock.now();
+      while (!mWire.empty() && mWire.front().mTime <= now)
+      {
+        if (mRxFifo.size() < mRxFifoSize)
+        {
+          mRxFifo.push_back(mWire.front());
+        }
+        else
+        {
+          mRxOverflows++;
+        }
+        mWire.pop_front();
+      }
+    }
+
+    inline void discardSentBytes(SimulatedTime inNow)
+    {
+      // A byte leaves the FIFO when it starts being shifted out.
+      while (!mTxFifo.empty() && mTxFifo.front() - mByteTime <= inNow)
+      {
+        mTxFifo.pop_front();
+      }
+    }
+
+  private:
+    VirtualClock& mClock;
+    SimulatedUart* mPeer;
+    SimulatedTime mByteTime;
+    unsigned mTxFifoSize;
+    unsigned mRxFifoSize;
+
+    std::deque<SimulatedTime> mTxFifo;  ///< Completion times of queued bytes.
+    SimulatedTime mLastTxCompletion;
+
+    std::deque<WireByte> mWire;         ///< Bytes sent by the peer, in flight.
+    std::deque<WireByte> mRxFifo;
+    SimulatedTime mLastReadTime;
+    unsigned long mRxOverflows;
+    SimulatedTime mTxBlockedTime;
+};
+
+END_MIDI_NAMESPACE
@@ -0,0 +1,243 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+/*
+  Host tool: record MIDI traffic in the CaptureRecorder log format (see
+  XE_MIDI_Recorder.h), and decode capture logs.
+
+  Build from this directory:
+    c++ -O2 -I../../src -I../host Capture.cpp ../../src/XE_MIDI.cpp -o Capture
+
+  Usage:
+    ./Capture record <raw MIDI file> <capture file>
+    ./Capture decode <capture file>
+
+  record replays a raw MIDI dump (eg: made with ./Corpus generate) through a
+  MidiInterface with soft thru on, recording both input and output, and
+  reports the cost of recording per message and the size of the log.
+  decode prints the events of a capture file, or of blocks dumped from a
+  device and concatenated, one per line: time in microseconds since the
+  first event, direction, bytes and message type.
+*/
+
+#include <XE_MIDI.h>
+#include <MockSerial.h>
+#include <CaptureFile.h>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+struct PlainSettings : public midi::DefaultSettings
+{
+  static const unsigned SysExMaxSize = 1024;
+};
+
+struct RamSettings : public PlainSettings
+{
+  typedef midi::CaptureRecorder<midi::SteadyClock, 255, 16> Recorder;
+};
+
+struct FileSettings : public PlainSettings
+{
+  typedef midi::CaptureRecorder<midi::SteadyClock, 255, 4, midi::CaptureFileSink> Recorder;
+};
+
+static bool load(const char* inPath, std::vector<byte>& outData)
+{
+  FILE* file = fopen(inPath, "rb");
+  if (file == 0)
+  {
+    return false;
+  }
+  byte buffer[4096];
+  size_t count;
+  while ((count = fread(buffer, 1, sizeof(buffer), file)) != 0)
+  {
+    outData.insert(outData.end(), buffer, buffer + count);
+  }
+  fclose(file);
+  return true;
+}
+
+static const char* getTypeName(byte inStatus)
+{
+  static const char* const channel[] = {
+    "NoteOff", "NoteOn", "AfterTouchPoly", "ControlChange",
+    "ProgramChange", "AfterTouchChannel", "PitchBend"
+  };
+  static const char* const system[] = {
+    "SystemExclusive", "TimeCodeQuarterFrame", "SongPosition", "SongSelect",
+    "Undefined", "Undefined", "TuneRequest", "SystemExclusiveEnd",
+    "Clock", "Undefined", "Start", "Continue",
+    "Stop", "Undefined", "ActiveSensing", "SystemReset"
+  };
+  return inStatus < 0xf0 ? channel[(inStatus >> 4) - 8] : system[inStatus & 0x0f];
+}
+
+// -----------------------------------------------------------------------------
+
+/*! Replay the stream, returns the time taken and the number of messages. */
+template<class Settings>
+static double replay(midi::MidiInterface<midi::MockSerial, Settings>& ioInterface,
+                     midi::MockSerial& ioSerial, unsigned long& outMessages)
+{
+  ioInterface.begin(MIDI_CHANNEL_OMNI);
+  ioSerial.rewind();
+  outMessages = 0;
+
+  const Clock::time_point start = Clock::now();
+  while (ioSerial.available())
+  {
+    outMessages += ioInterface.read() ? 1 : 0;
+  }
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+template<class Settings>
+static double measure(const std::vector<byte>& inStream, unsigned long& outMessages)
+{
+  static midi::MockSerial serial;
+  static midi::MidiInterface<midi::MockSerial, Settings> interface(serial);
+  serial.setInput(inStream);
+
+  double best = 1e30;
+  for (unsigned run = 0; run < 5; ++run)
+  {
+    const double seconds = replay(interface, serial, outMessages);
+    best = seconds < best ? seconds : best;
+  }
+  return best;
+}
+
+static int record(const char* inInput, const char* inOutput)
+{
+  std::vector<byte> stream;
+  if (!load(inInput, stream) || stream.empty())
+  {
+    fprintf(stderr, "Cannot read %s\n", inInput);
+    return 1;
+  }
+
+  unsigned long messages = 0;
+  const double plain = measure<PlainSettings>(stream, messages);
+  const double ram   = measure<RamSettings>(stream, messages);
+
+  static midi::MockSerial serial;
+  static midi::MidiInterface<midi::MockSerial, FileSettings> interface(serial);
+  serial.setInput(stream);
+  FileSettings::Recorder& recorder = interface.getRecorder();
+  if (!recorder.getSink().open(inOutput))
+  {
+    fprintf(stderr, "Cannot write %s\n", inOutput);
+    return 1;
+  }
+  const double file = replay(interface, serial, messages);
+  recorder.flush();
+
+  const unsigned long logSize = recorder.getSink().getBytesWritten();
+  recorder.getSink().close();
+
+  // Each message read is forwarded by the soft thru: two events per message.
+  printf("%zu bytes, %lu messages (%lu events recorded)\n", stream.size(), messages, messages * 2);
+  printf("per message: %.1f ns without recorder, +%.1f ns recording to RAM, +%.1f ns to file\n",
+         plain / messages * 1e9, (ram - plain) / messages * 1e9, (file - plain) / messages * 1e9);
+  printf("%s: %lu bytes, %.2f bytes per event\n", inOutput, logSize, double(logSize) / (messages * 2));
+  return 0;
+}
+
+// -----------------------------------------------------------------------------
+
+static int decode(const char* inPath)
+{
+  std::vector<byte> data;
+  std::vector<unsigned> blocks;
+  if (!midi::readCaptureFile(inPath, data, blocks))
+  {
+    fprintf(stderr, "Cannot read %s, or malformed block\n", inPath);
+    return 1;
+  }
+
+  unsigned long events = 0;
+  unsigned long origin = 0;
+  unsigned errors = 0;
+  for (size_t i = 0; i < blocks.size(); ++i)
+  {
+    midi::CaptureReader reader(&data[blocks[i]], unsigned(data.size() - blocks[i]));
+    midi::CaptureReader::Event event;
+    unsigned position = 0;
+    while (reader.read(event))
+    {
+      if (events++ == 0)
+      {
+        origin = event.mTime;
+      }
+      printf("%12lu %-3s %02x", (event.mTime - origin) & 0xffffffffUL,
+             event.mDirection == midi::CaptureDirection::Input ? "in" : "out", event.mStatus);
+
+      if (event.mStatus == midi::SystemExclusive)
+      {
+        for (unsigned j = 0; j < event.mSysExKept && j < 8; ++j)
+        {
+          printf(" %02x", event.mSysExData[j]);
+        }
+        printf("%s f7  %s, %u bytes%s\n", event.mSysExLength > 8 ? " .." : "",
+               getTypeName(event.mStatus), event.mSysExLength,
+               event.mSysExKept < event.mSysExLength ? " (truncated)" : "");
+        continue;
+      }
+
+      const byte size = midi::CaptureFormat::getDataSize(event.mStatus);
+      if (size > 0) printf(" %02x", event.mData1);
+      if (size > 1) printf(" %02x", event.mData2);
+      printf("%*s%s", 3 * (2 - size) + 2, "", getTypeName(event.mStatus));
+      if (event.mStatus < 0xf0)
+      {
+        printf(" ch%u", (event.mStatus & 0x0f) + 1);
+      }
+      printf("\n");
+    }
+    position = reader.getSize();
+    errors += position == 0 ? 1 : 0;
+  }
+
+  printf("-- %zu blocks, %zu bytes, %lu events\n", blocks.size(), data.size(), events);
+  return errors == 0 ? 0 : 1;
+}
+
+// -----------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+  if (argc == 4 && strcmp(argv[1], "record") == 0)
+  {
+    return record(argv[2], argv[3]);
+  }
+  if (argc == 3 && strcmp(argv[1], "decode") == 0)
+  {
+    return decode(argv[2]);
+  }
+  fprintf(stderr, "Usage:\n"
+                  "  %s record <raw MIDI file> <capture file>\n"
+                  "  %s decode <capture file>\n", argv[0], argv[0]);
+  return 1;
+}
@@ -0,0 +1,212 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+/*
+  Host tool: generate reproducible MIDI traffic corpora, and replay them (or
+  raw captures) through MidiInterface.
+
+  Build from this directory:
+    c++ -O2 -I../../src -I../host Corpus.cpp ../../src/XE_MIDI.cpp -o Corpus
+
+  Usage:
+    ./Corpus generate <profile> <seed> <size in bytes> <output file>
+    ./Corpus replay <file> [--messages]
+
+  Profiles: notes, controllers, sysex-clock, garbage, mixed.
+  Any raw dump of MIDI bytes can be replayed. The replay reports the
+  throughput, the decoded events per type, parser statistics and the worst
+  time spent in a single read() call. --messages parses a full message per
+  read() (Use1ByteParsing = false) instead of one byte.
+*/
+
+#include <XE_MIDI.h>
+#include <MockSerial.h>
+#include <TrafficGenerator.h>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+struct ByteSettings : public midi::DefaultSettings
+{
+  static const unsigned SysExMaxSize = 1024;
+  typedef midi::MidiStatistics Statistics;
+};
+
+struct MessageSettings : public ByteSettings
+{
+  static const bool Use1ByteParsing = false;
+};
+
+struct TextOutput
+{
+  void write(byte inData)
+  {
+    putchar(inData);
+  }
+};
+
+// -----------------------------------------------------------------------------
+
+static int generate(const char* inProfile, unsigned inSeed, size_t inSize, const char* inPath)
+{
+  const midi::TrafficProfile::Profile profile = midi::TrafficProfile::fromName(inProfile);
+  if (profile == midi::TrafficProfile::Count)
+  {
+    fprintf(stderr, "Unknown profile: %s\n", inProfile);
+    return 1;
+  }
+
+  std::vector<byte> stream;
+  midi::TrafficGenerator generator(inSeed);
+  generator.generate(profile, inSize, stream);
+
+  FILE* file = fopen(inPath, "wb");
+  if (file == 0 || fwrite(&stream[0], 1, stream.size(), file) != stream.size())
+  {
+    fprintf(stderr, "Cannot write %s\n", inPath);
+    return 1;
+  }
+  fclose(file);
+  printf("%s: %zu bytes of '%s' traffic (seed %u)\n", inPath, stream.size(), inProfile, inSeed);
+  return 0;
+}
+
+// -----------------------------------------------------------------------------
+
+template<class Settings>
+static void replay(const std::vector<byte>& inStream)
+{
+  static midi::MockSerial serial;
+  static midi::MidiInterface<midi::MockSerial, Settings> interface(serial);
+  interface.begin(MIDI_CHANNEL_OMNI);
+  interface.turnThruOff();
+  serial.setInput(inStream);
+
+  // Throughput, best of a few runs.
+  double best = 1e30;
+  for (unsigned run = 0; run < 5; ++run)
+  {
+    serial.rewind();
+    const Clock::time_point start = Clock::now();
+    while (serial.available())
+    {
+      interface.read();
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    best = seconds < best ? seconds : best;
+  }
+
+  // Events and worst case, with each read() timed. The pass is done a few
+  // times, keeping the lowest worst case, to filter out preemption by the OS.
+  unsigned long events = 0;
+  double worst = 1e30;
+  size_t worstOffset = 0;
+  for (unsigned run = 0; run < 3; ++run)
+  {
+    interface.begin(MIDI_CHANNEL_OMNI);
+    interface.turnThruOff();
+    interface.resetStatistics();
+    serial.rewind();
+
+    unsigned long runEvents = 0;
+    double runWorst = 0;
+    size_t runWorstOffset = 0;
+    while (serial.available())
+    {
+      const size_t offset = inStream.size() - serial.available();
+      const Clock::time_point start = Clock::now();
+      runEvents += interface.read() ? 1 : 0;
+      const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+      if (seconds > runWorst)
+      {
+        runWorst = seconds;
+        runWorstOffset = offset;
+      }
+    }
+
+    events = runEvents;
+    if (runWorst < worst)
+    {
+      worst = runWorst;
+      worstOffset = runWorstOffset;
+    }
+  }
+
+  printf("%zu bytes, %lu events\n", inStream.size(), events);
+  printf("throughput %.1f MB/s, %.2f M events/s\n",
+         inStream.size() / best / 1e6, events / best / 1e6);
+  printf("worst read() %.0f ns, at byte %zu\n", worst * 1e9, worstOffset);
+  printf("-- statistics\n");
+
+  TextOutput output;
+  interface.getStatistics().writeText(output);
+}
+
+static int replay(const char* inPath, bool inMessages)
+{
+  FILE* file = fopen(inPath, "rb");
+  if (file == 0)
+  {
+    fprintf(stderr, "Cannot read %s\n", inPath);
+    return 1;
+  }
+
+  std::vector<byte> stream;
+  byte buffer[4096];
+  size_t count;
+  while ((count = fread(buffer, 1, sizeof(buffer), file)) != 0)
+  {
+    stream.insert(stream.end(), buffer, buffer + count);
+  }
+  fclose(file);
+
+  if (inMessages)
+    replay<MessageSettings>(stream);
+  else
+    replay<ByteSettings>(stream);
+  return 0;
+}
+
+// -----------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+  if (argc == 6 && strcmp(argv[1], "generate") == 0)
+  {
+    return generate(argv[2], unsigned(strtoul(argv[3], 0, 0)),
+                    size_t(strtoul(argv[4], 0, 0)), argv[5]);
+  }
+  if ((argc == 3 || argc == 4) && strcmp(argv[1], "replay") == 0)
+  {
+    return replay(argv[2], argc == 4 && strcmp(argv[3], "--messages") == 0);
+  }
+
+  fprintf(stderr,
+          "Usage:\n"
+          "  %s generate <profile> <seed> <size in bytes> <output file>\n"
+          "  %s replay <file> [--messages]\n"
+          "Profiles: notes, controllers, sysex-clock, garbage, mixed\n",
+          argv[0], argv[0]);
+  return 1;
+}
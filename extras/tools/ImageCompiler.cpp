@@ -0,0 +1,276 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+/*
+  Host tool: compile a Standard MIDI File into a playback image (see
+  XE_MIDI_PlaybackImage.h), for PlaybackImagePlayer.
+
+  Build from this directory:
+    c++ -O2 -I../../src -I../host ImageCompiler.cpp ../../src/XE_MIDI.cpp -o ImageCompiler
+
+  Usage:
+    ./ImageCompiler <input.mid> <output> [--no-running-status] [--benchmark]
+
+  The file is rendered offline by SmfPlayer (tracks merged, tempo map
+  applied) into a MidiInterface, and the bytes it sends are grouped by time.
+  An output name ending with .h gives a C header holding the image as a
+  PROGMEM array, to be built into a sketch. The image playback is checked
+  against SmfPlayer, and --benchmark compares their CPU time.
+*/
+
+#include <XE_MIDI.h>
+#include <XE_MIDI_SmfPlayer.h>
+#include <XE_MIDI_PlaybackImage.h>
+#include <MappedFile.h>
+#include <MockSerial.h>
+#include <chrono>
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+struct RunningStatusSettings : public midi::DefaultSettings
+{
+  static const bool UseRunningStatus = true;
+};
+
+struct PlainSettings : public midi::DefaultSettings
+{
+  static const bool UseRunningStatus = false;
+};
+
+static void writeUInt(std::vector<byte>& ioImage, unsigned long inValue, unsigned inSize)
+{
+  for (unsigned i = 0; i < inSize; ++i)
+  {
+    ioImage.push_back(byte(inValue >> (8 * i)));
+  }
+}
+
+static void writeGroup(std::vector<byte>& ioImage, unsigned long inDelta,
+                       const byte* inData, size_t inLength)
+{
+  writeUInt(ioImage, inDelta, 4);
+  writeUInt(ioImage, inLength, 2);
+  ioImage.insert(ioImage.end(), inData, inData + inLength);
+}
+
+template<class Settings>
+static bool compile(const midi::MappedFile& inFile, std::vector<byte>& outImage,
+                    unsigned long& outEvents)
+{
+  typedef midi::MidiInterface<midi::MockSerial, Settings> Interface;
+  static midi::MockSerial serial;
+  static Interface interface(serial);
+  interface.begin(MIDI_CHANNEL_OMNI);
+
+  midi::SmfMemorySource source(inFile.getData(), inFile.getSize());
+  midi::SmfPlayer<Interface, midi::SmfMemorySource, 255, 64> player(interface, source);
+  if (!player.begin())
+  {
+    return false;
+  }
+
+  outImage.clear();
+  outImage.insert(outImage.end(), (const byte*)"MIMG", (const byte*)"MIMG" + 4);
+  outImage.push_back(midi::PlaybackImage::Version);
+  outImage.push_back(Settings::UseRunningStatus ? byte(midi::PlaybackImage::RunningStatus) : byte(0));
+  writeUInt(outImage, 0, 2);
+  writeUInt(outImage, 0, 8); // Group count & duration, written below
+
+  // Render: jump from one event time to the next, each update sends the
+  // events due at that time.
+  unsigned long groups = 0;
+  unsigned long groupTime = 0;
+  unsigned long now = 0;
+  player.play(0);
+  while (!player.isFinished())
+  {
+    now = player.getNextEventTime();
+    player.update(now);
+
+    const std::vector<byte>& output = serial.getOutput();
+    for (size_t offset = 0; offset < output.size(); offset += midi::PlaybackImage::MaxGroupLength)
+    {
+      size_t length = output.size() - offset;
+      length = length < unsigned(midi::PlaybackImage::MaxGroupLength) ? length : unsigned(midi::PlaybackImage::MaxGroupLength);
+      writeGroup(outImage, now - groupTime, &output[offset], length);
+      groupTime = now;
+      groups++;
+    }
+    serial.clearOutput();
+  }
+  writeGroup(outImage, now - groupTime, 0, 0); // End of the song
+
+  for (unsigned i = 0; i < 4; ++i)
+  {
+    outImage[8 + i]  = byte(groups >> (8 * i));
+    outImage[12 + i] = byte(now >> (8 * i));
+  }
+  outEvents = player.getEventCount();
+  return true;
+}
+
+static bool writeImage(const std::vector<byte>& inImage, const char* inPath)
+{
+  FILE* file = fopen(inPath, "wb");
+  if (file == 0)
+  {
+    return false;
+  }
+
+  const size_t pathLength = strlen(inPath);
+  if (pathLength > 2 && strcmp(inPath + pathLength - 2, ".h") == 0)
+  {
+    // C header, the array named after the file.
+    const char* name = strrchr(inPath, '/');
+    std::string identifier(name != 0 ? name + 1 : inPath, name != 0 ? inPath + pathLength - name - 3 : pathLength - 2);
+    for (size_t i = 0; i < identifier.size(); ++i)
+    {
+      identifier[i] = isalnum((unsigned char)identifier[i]) ? identifier[i] : '_';
+    }
+    fprintf(file, "// Playback image, see XE_MIDI_PlaybackImage.h\n#pragma once\n\n");
+    fprintf(file, "const byte %s[%zu] PROGMEM = {", identifier.c_str(), inImage.size());
+    for (size_t i = 0; i < inImage.size(); ++i)
+    {
+      fprintf(file, "%s0x%02x,", i % 16 == 0 ? "\n  " : " ", inImage[i]);
+    }
+    fprintf(file, "\n};\n");
+  }
+  else
+  {
+    fwrite(&inImage[0], 1, inImage.size(), file);
+  }
+  return fclose(file) == 0;
+}
+
+// -----------------------------------------------------------------------------
+
+/*! Output of both players, flat out, and their CPU time. */
+template<class Settings>
+static bool check(const midi::MappedFile& inFile, const std::vector<byte>& inImage,
+                  bool inBenchmark)
+{
+  typedef midi::MidiInterface<midi::MockSerial, Settings> Interface;
+  static midi::MockSerial serial;
+  static Interface interface(serial);
+  interface.begin(MIDI_CHANNEL_OMNI);
+
+  midi::SmfMemorySource source(inFile.getData(), inFile.getSize());
+  midi::SmfPlayer<Interface, midi::SmfMemorySource, 255, 64> smfPlayer(interface, source);
+  midi::SmfMemorySource imageSource(&inImage[0], inImage.size());
+  midi::PlaybackImagePlayer<midi::MockSerial, midi::SmfMemorySource, 64> imagePlayer(serial, imageSource);
+  smfPlayer.begin();
+  imagePlayer.begin();
+
+  double seconds[2] = { 1e30, 1e30 };
+  std::vector<byte> outputs[2];
+  const unsigned runs = inBenchmark ? 5 : 1;
+  for (unsigned run = 0; run < runs; ++run)
+  {
+    for (unsigned player = 0; player < 2; ++player)
+    {
+      serial.clearOutput();
+      serial.setCaptureOutput(run == 0);
+      smfPlayer.rewind();
+      imagePlayer.rewind();
+
+      const Clock::time_point start = Clock::now();
+      unsigned long now = 0;
+      if (player == 0)
+      {
+        smfPlayer.play(0);
+        while (!smfPlayer.isFinished()) smfPlayer.update(now += 900000000UL);
+      }
+      else
+      {
+        imagePlayer.play(0);
+        while (!imagePlayer.isFinished()) imagePlayer.update(now += 900000000UL);
+      }
+      const double time = std::chrono::duration<double>(Clock::now() - start).count();
+      seconds[player] = time < seconds[player] ? time : seconds[player];
+      if (run == 0)
+      {
+        outputs[player] = serial.getOutput();
+      }
+    }
+  }
+
+  const bool same = outputs[0] == outputs[1];
+  printf("image playback %s SmfPlayer (%zu bytes)\n", same ? "matches" : "DIFFERS FROM", outputs[0].size());
+  if (inBenchmark)
+  {
+    printf("CPU time: SmfPlayer %.2f ms (%.1f ns per byte sent), image %.2f ms (%.1f ns per byte sent)\n",
+           seconds[0] * 1e3, seconds[0] / outputs[0].size() * 1e9,
+           seconds[1] * 1e3, seconds[1] / outputs[1].size() * 1e9);
+  }
+  return same;
+}
+
+int main(int argc, char** argv)
+{
+  bool runningStatus = true;
+  bool benchmark = false;
+  if (argc < 3)
+  {
+    fprintf(stderr, "Usage: %s <input.mid> <output> [--no-running-status] [--benchmark]\n", argv[0]);
+    return 1;
+  }
+  for (int i = 3; i < argc; ++i)
+  {
+    runningStatus &= strcmp(argv[i], "--no-running-status") != 0;
+    benchmark     |= strcmp(argv[i], "--benchmark") == 0;
+  }
+
+  midi::MappedFile file;
+  if (!file.open(argv[1]))
+  {
+    fprintf(stderr, "Cannot open %s\n", argv[1]);
+    return 1;
+  }
+
+  std::vector<byte> image;
+  unsigned long events = 0;
+  const bool compiled = runningStatus ? compile<RunningStatusSettings>(file, image, events)
+                                      : compile<PlainSettings>(file, image, events);
+  if (!compiled)
+  {
+    fprintf(stderr, "%s: not a Standard MIDI File\n", argv[1]);
+    return 1;
+  }
+  if (!writeImage(image, argv[2]))
+  {
+    fprintf(stderr, "Cannot write %s\n", argv[2]);
+    return 1;
+  }
+
+  const unsigned long groups   = midi::PlaybackImage::readUInt32(&image[8]);
+  const unsigned long duration = midi::PlaybackImage::readUInt32(&image[12]);
+  printf("%s: %zu bytes, %lu events -> %s: %zu bytes, %lu groups, %.3f s%s\n",
+         argv[1], file.getSize(), events, argv[2], image.size(), groups, duration / 1e6,
+         runningStatus ? "" : ", no Running Status");
+
+  const bool same = runningStatus ? check<RunningStatusSettings>(file, image, benchmark)
+                                  : check<PlainSettings>(file, image, benchmark);
+  return same ? 0 : 1;
+}
@@ -0,0 +1,257 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+/*
+  Host tool: build the seek index of a Standard MIDI File (see
+  XE_MIDI_SmfSeekIndex.h), check it, and measure seeking.
+
+  Build from this directory:
+    c++ -O2 -I../../src -I../host SeekIndex.cpp ../../src/XE_MIDI.cpp -o SeekIndex
+
+  Usage:
+    ./SeekIndex <input.mid> <output index> [interval in beats, default 16]
+
+  The file is played once to log every message with its tick. Then the
+  player seeks to random positions. The chase state it sends there is
+  compared to the state rebuilt from the log: controllers, programs, pitch
+  bend, pressure and held notes must match.
+  The events played after the jump are compared to the log as well.
+  Last, the average seek time is measured for several intervals. The
+  largest interval is about a rescan from the start.
+*/
+
+#include <XE_MIDI_SmfPlayer.h>
+#include <MappedFile.h>
+#include <SmfFile.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+struct Event
+{
+  unsigned long tick;
+  byte status;
+  byte data1;
+  byte data2;
+
+  bool operator==(const Event& inOther) const
+  {
+    return tick == inOther.tick && status == inOther.status &&
+           data1 == inOther.data1 && data2 == inOther.data2;
+  }
+};
+
+/*! Interface of the player: follows the chase state, and logs channel
+  messages with their tick when asked to.
+*/
+struct Logger
+{
+  typedef midi::SmfPlayer<Logger, midi::SmfMemorySource, 255, 64> Player;
+
+  Logger() : player(0), log(false) {}
+
+  void send(midi::MidiType inType, midi::DataByte inData1, midi::DataByte inData2, midi::Channel inChannel)
+  {
+    state.send(inType, inData1, inData2, inChannel);
+    if (log)
+    {
+      const Event event = { player->getTick(), byte(inType | (inChannel - 1)), inData1, inData2 };
+      events.push_back(event);
+    }
+  }
+  void beginSysEx() {}
+  template<class Source>
+  void sendSysExData(unsigned, const Source&) {}
+  void endSysEx() {}
+  void sendTimeCodeQuarterFrame(midi::DataByte) {}
+  void sendSongPosition(unsigned) {}
+  void sendSongSelect(midi::DataByte) {}
+  void sendTuneRequest() {}
+  void sendRealTime(midi::MidiType) {}
+
+  Player* player;
+  bool log;
+  std::vector<Event> events;
+  midi::SmfChaseState state;
+};
+
+/*! Growing memory sink. */
+struct VectorSink
+{
+  unsigned write(unsigned long inOffset, const byte* inData, unsigned inSize)
+  {
+    if (data.size() < inOffset + inSize)
+    {
+      data.resize(inOffset + inSize);
+    }
+    std::copy(inData, inData + inSize, data.begin() + inOffset);
+    return inSize;
+  }
+
+  std::vector<byte> data;
+};
+
+/*! Messages restoring a chase state, held notes included or not. */
+static std::vector<unsigned long> getSnapshot(const midi::SmfChaseState& inState)
+{
+  VectorSink sink;
+  inState.write(sink, 0);
+  std::vector<unsigned long> messages;
+  for (size_t i = 2; i + 3 <= sink.data.size(); i += 3)
+  {
+    messages.push_back((unsigned long)sink.data[i] << 16 | sink.data[i + 1] << 8 | sink.data[i + 2]);
+  }
+  return messages;
+}
+
+static void play(Logger::Player& ioPlayer)
+{
+  unsigned long now = 0;
+  ioPlayer.play(now);
+  while (!ioPlayer.isFinished())
+  {
+    ioPlayer.update(now += 900000000UL);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  if (argc < 3)
+  {
+    fprintf(stderr, "Usage: %s <input.mid> <output index> [interval in beats, default 16]\n", argv[0]);
+    return 1;
+  }
+  const unsigned interval = argc > 3 ? unsigned(atoi(argv[3])) : unsigned(midi::SmfSeekIndex::DefaultInterval);
+
+  midi::MappedFile file;
+  if (!file.open(argv[1]))
+  {
+    fprintf(stderr, "Cannot open %s\n", argv[1]);
+    return 1;
+  }
+  midi::SmfMemorySource source(file.getData(), file.getSize());
+  Logger logger;
+  Logger::Player player(logger, source);
+  logger.player = &player;
+  if (!player.begin())
+  {
+    fprintf(stderr, "%s: not a Standard MIDI File\n", argv[1]);
+    return 1;
+  }
+
+  midi::SmfFileSink sink;
+  if (!sink.open(argv[2]) || !player.writeSeekIndex(sink, interval))
+  {
+    fprintf(stderr, "Cannot write the index to %s (SMPTE time files have no beats)\n", argv[2]);
+    return 1;
+  }
+  sink.close();
+
+  midi::MappedFile indexFile;
+  indexFile.open(argv[2]);
+  midi::SmfMemorySource index(indexFile.getData(), indexFile.getSize());
+
+  // Reference: all the messages, with their tick.
+  logger.log = true;
+  play(player);
+  logger.log = false;
+  const std::vector<Event> reference = logger.events;
+  const unsigned long lastBeat = reference.empty() ? 0 : reference.back().tick * 4 / player.getDivision();
+  printf("%s: %zu bytes, %zu channel messages, %lu beats -> %s: %zu bytes, %lu entries every %u beats\n",
+         argv[1], file.getSize(), reference.size(), lastBeat, argv[2], indexFile.getSize(),
+         midi::Smf::readUInt32(indexFile.getData() + 8), interval);
+
+  // Random positions, one in four on an index entry.
+  std::mt19937 random(7);
+  std::vector<unsigned> positions(200);
+  for (size_t i = 0; i < positions.size(); ++i)
+  {
+    positions[i] = unsigned(random() % (lastBeat + 1));
+    positions[i] -= i % 4 == 0 ? positions[i] % interval : 0;
+  }
+  std::sort(positions.begin(), positions.end());
+
+  midi::SmfChaseState expected;
+  size_t played = 0;
+  unsigned failures = 0;
+  for (size_t i = 0; i < positions.size(); ++i)
+  {
+    const unsigned long tick = (unsigned long)((uint64_t)positions[i] * player.getDivision() / 4);
+    while (played < reference.size() && reference[played].tick < tick)
+    {
+      const Event& event = reference[played++];
+      expected.send(midi::MidiType(event.status & 0xf0), event.data1, event.data2, midi::Channel((event.status & 0x0f) + 1));
+    }
+
+    logger.events.clear();
+    logger.state.reset(); // Programs are not reset by seek
+    player.rewind();
+    if (!player.seek(index, positions[i], 0))
+    {
+      fprintf(stderr, "seek to beat %u failed\n", positions[i]);
+      return 1;
+    }
+    const bool stateMatches = getSnapshot(logger.state) == getSnapshot(expected);
+
+    // The next events, from the position.
+    logger.log = true;
+    unsigned long now = 0;
+    player.play(now);
+    while (!player.isFinished() && logger.events.size() < 1000)
+    {
+      player.update(now += 1000);
+    }
+    logger.log = false;
+    logger.events.resize(std::min<size_t>(logger.events.size(), 1000));
+    const bool eventsMatch = logger.events.size() <= reference.size() - played &&
+                             std::equal(logger.events.begin(), logger.events.end(), reference.begin() + played);
+    if (!stateMatches || !eventsMatch)
+    {
+      printf("beat %u: %s%s\n", positions[i], stateMatches ? "" : "chase state differs ", eventsMatch ? "" : "events differ");
+      failures++;
+    }
+  }
+  printf("%zu seeks checked: %s\n", positions.size(), failures == 0 ? "all match" : "MISMATCHES");
+
+  // Seek time by interval.
+  std::shuffle(positions.begin(), positions.end(), random);
+  printf("interval (beats)   index size   seek time\n");
+  const unsigned intervals[] = { 4, 16, 64, 256, 1024, 65535 };
+  for (size_t i = 0; i < sizeof(intervals) / sizeof(intervals[0]); ++i)
+  {
+    VectorSink memory;
+    player.writeSeekIndex(memory, intervals[i]);
+    midi::SmfMemorySource memoryIndex(&memory.data[0], memory.data.size());
+
+    const Clock::time_point start = Clock::now();
+    for (size_t j = 0; j < positions.size(); ++j)
+    {
+      player.seek(memoryIndex, positions[j], 0);
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    printf("%16u %10zu B %9.1f us\n", intervals[i], memory.data.size(), seconds / positions.size() * 1e6);
+  }
+  return failures == 0 ? 0 : 1;
+}
@@ -23,6 +23,90 @@
 
 BEGIN_MIDI_NAMESPACE
 
+// SysEx data is packed in blocks of 8 bytes: a header holding the MSBs of the
+// 7 following data bytes (first data byte MSB in bit 6), then the 7 bodies.
+// On 64-bit hosts, a whole block is handled as one word, so large dumps are
+// processed without per-byte shifts or branches.
+#ifndef MIDI_SYSEX_WORD_KERNELS
+#if defined(__LP64__) || defined(_WIN64)
+#define MIDI_SYSEX_WORD_KERNELS 1
+#else
+#define MIDI_SYSEX_WORD_KERNELS 0
+#endif
+#endif
+
+#if MIDI_SYSEX_WORD_KERNELS
+
+static inline uint64_t loadSysExBlock(const byte* inData)
+{
+  return (uint64_t(inData[0])      ) | (uint64_t(inData[1]) <<  8) |
+         (uint64_t(inData[2]) << 16) | (uint64_t(inData[3]) << 24) |
+         (uint64_t(inData[4]) << 32) | (uint64_t(inData[5]) << 40) |
+         (uint64_t(inData[6]) << 48);
+}
+
+static inline void storeSysExBlock(byte* outData, uint64_t inWord)
+{
+  outData[0] = byte(inWord      );
+  outData[1] = byte(inWord >>  8);
+  outData[2] = byte(inWord >> 16);
+  outData[3] = byte(inWord >> 24);
+  outData[4] = byte(inWord >> 32);
+  outData[5] = byte(inWord >> 40);
+  outData[6] = byte(inWord >> 48);
+}
+
+static inline void encodeSysExWord(const byte* inData, byte* outSysEx)
+{
+  const uint64_t data = loadSysExBlock(inData);
+
+  // Gather the MSB of byte i (moved to bit 8i) into bit 62 - i: the partial
+  // products never overlap, so the multiplication cannot carry.
+  const uint64_t msbs = (data >> 7) & 0x0001010101010101ull;
+  outSysEx[0] = byte((msbs * 0x4020100804020100ull) >> 56) & 0x7f;
+  storeSysExBlock(outSysEx + 1, data & 0x007f7f7f7f7f7f7full);
+}
+
+static inline void decodeSysExWord(const byte* inSysEx, byte* outData)
+{
+  // Copy the header in each byte and keep bit 6 - i in byte i,
+  // then turn any non-null byte into 0x80.
+  const uint64_t header = uint64_t(inSysEx[0]) * 0x0001010101010101ull;
+  const uint64_t bits   = header & 0x0001020408102040ull;
+  const uint64_t msbs   = (bits + 0x007f7f7f7f7f7f7full) & 0x0080808080808080ull;
+  storeSysExBlock(outData, loadSysExBlock(inSysEx + 1) | msbs);
+}
+
+#endif
+
+static inline void encodeSysExBlock(const byte* inData, byte* outSysEx, unsigned inLength)
+{
+  byte msbs = 0;
+  byte mask = 0x40;
+  for (unsigned i = 0; i < inLength; ++i, mask >>= 1)
+  {
+    const byte data = inData[i];
+    if (data & 0x80)
+    {
+      msbs |= mask;
+    }
+    outSysEx[1 + i] = data & 0x7f;
+  }
+  outSysEx[0] = msbs;
+}
+
+static inline void decodeSysExBlock(const byte* inSysEx, byte* outData, unsigned inLength)
+{
+  const byte msbs = inSysEx[0];
+  byte mask = 0x40;
+  for (unsigned i = 0; i < inLength; ++i, mask >>= 1)
+  {
+    outData[i] = inSysEx[1 + i] | ((msbs & mask) ? 0x80 : 0);
+  }
+}
+
+// -----------------------------------------------------------------------------
+
 /*! \brief Encode System Exclusive messages.
   SysEx messages are encoded to guarantee transmission of data bytes higher than
   127 without breaking the MIDI protocol. Use this static method to convert the
@@ -36,28 +120,26 @@ BEGIN_MIDI_NAMESPACE
 */
 unsigned encodeSysEx(const byte* inData, byte* outSysEx, unsigned inLength)
 {
-  unsigned outLength  = 0;     // Num bytes in output array.
-  byte count          = 0;     // Num 7bytes in a block.
-  outSysEx[0]         = 0;
+  unsigned outLength = 0;     // Num bytes in output array.
 
-  for (unsigned i = 0; i < inLength; ++i)
+  for (; inLength >= 7; inLength -= 7)
   {
-    const byte data = inData[i];
-    const byte msb  = data >> 7;
-    const byte body = data & 0x7f;
-
-    outSysEx[0] |= (msb << (6 - count));
-    outSysEx[1 + count] = body;
+#if MIDI_SYSEX_WORD_KERNELS
+    encodeSysExWord(inData, outSysEx);
+#else
+    encodeSysExBlock(inData, outSysEx, 7);
+#endif
+    inData    += 7;
+    outSysEx  += 8;
+    outLength += 8;
+  }
 
-    if (count++ == 6)
-    {
-      outSysEx   += 8;
-      outLength  += 8;
-      outSysEx[0] = 0;
-      count       = 0;
-    }
+  if (inLength != 0)
+  {
+    encodeSysExBlock(inData, outSysEx, inLength);
+    outLength += inLength + 1;
   }
-  return outLength + count + (count != 0 ? 1 : 0);
+  return outLength;
 }
 
 /*! \brief Decode System Exclusive messages.
@@ -73,23 +155,24 @@ unsigned encodeSysEx(const byte* inData, byte* outSysEx, unsigned inLength)
 */
 unsigned decodeSysEx(const byte* inSysEx, byte* outData, unsigned inLength)
 {
-  unsigned count  = 0;
-  byte msbStorage = 0;
-  byte byteIndex  = 0;
+  unsigned count = 0;
 
-  for (unsigned i = 0; i < inLength; ++i)
+  for (; inLength >= 8; inLength -= 8)
   {
-    if ((i % 8) == 0)
-    {
-      msbStorage = inSysEx[i];
-      byteIndex  = 6;
-    }
-    else
-    {
-      const byte body = inSysEx[i];
-      const byte msb  = ((msbStorage >> byteIndex--) & 1) << 7;
-      outData[count++] = msb | body;
-    }
+#if MIDI_SYSEX_WORD_KERNELS
+    decodeSysExWord(inSysEx, outData);
+#else
+    decodeSysExBlock(inSysEx, outData, 7);
+#endif
+    inSysEx += 8;
+    outData += 7;
+    count   += 7;
+  }
+
+  if (inLength > 1)
+  {
+    decodeSysExBlock(inSysEx, outData, inLength - 1);
+    count += inLength - 1;
   }
   return count;
 }
@@ -22,6 +22,9 @@
 #include "XE_MIDI_Defs.h"
 #include "XE_MIDI_Settings.h"
 #include "XE_MIDI_Message.h"
+#include "XE_MIDI_SysEx.h"
+#include "XE_MIDI_UsbDefs.h"
+#include "XE_MIDI_ControlChange14.h"
 
 #define AVAILABLE_MIDI_CHANNELS 16
 
@@ -66,6 +69,9 @@ class MidiInterface
     inline void sendControlChange(DataByte inControlNumber,
                                   DataByte inControlValue,
                                   Channel inChannel);
+    inline void sendControlChange14(DataByte inControlNumber,
+                                    unsigned inControlValue,
+                                    Channel inChannel);
 
     inline void sendPitchBend(int inPitchValue,    Channel inChannel);
     inline void sendPitchBend(double inPitchValue, Channel inChannel);
@@ -84,6 +90,20 @@ class MidiInterface
                           const byte* inArray,
                           bool inArrayContainsBoundaries = false);
 
+    template<class Source>
+    inline void sendSysExEncoded(unsigned inLength,
+                                 const Source& inData);
+
+    inline void beginSysEx();
+    template<class Source>
+    inline void sendSysExData(unsigned inLength,
+                              const Source& inData);
+    template<class Source>
+    inline void sendSysExEncodedData(unsigned inLength,
+                                     const Source& inData);
+    inline void sendSysExChecksum();
+    inline void endSysEx();
+
     inline void sendTimeCodeQuarterFrame(DataByte inTypeNibble,
                                          DataByte inValuesNibble);
     inline void sendTimeCodeQuarterFrame(DataByte inData);
@@ -119,6 +139,13 @@ class MidiInterface
                                   Channel inChannel);
     inline void endNrpn(Channel inChannel);
 
+    unsigned sendRpnBatch(ParameterValue* ioParameters,
+                          unsigned inCount,
+                          Channel inChannel);
+    unsigned sendNrpnBatch(ParameterValue* ioParameters,
+                           unsigned inCount,
+                           Channel inChannel);
+
   public:
     void send(MidiType inType,
               DataByte inData1,
@@ -131,6 +158,9 @@ class MidiInterface
   public:
     inline bool read();
     inline bool read(Channel inChannel);
+    inline bool read(const UsbMidiEventPacket& inPacket);
+    inline bool read(const UsbMidiEventPacket& inPacket, Channel inChannel);
+    inline void flushControlChange14();
 
   public:
     inline MidiType getType() const;
@@ -139,8 +169,30 @@ class MidiInterface
     inline DataByte getData2() const;
     inline const byte* getSysExArray() const;
     inline unsigned getSysExArrayLength() const;
+    inline bool isSysExChecksumValid() const;
     inline bool check() const;
 
+  public:
+    typedef typename Settings::Statistics Statistics;
+    inline Statistics getStatistics() const;
+    inline void resetStatistics();
+    inline void sendStatistics();
+
+  public:
+    typedef typename Settings::Latency Latency;
+    inline const Latency& getLatency() const;
+    inline void resetLatency();
+
+  public:
+    typedef typename Settings::Tracer Tracer;
+    inline const Tracer& getTracer() const;
+    inline Tracer& getTracer();
+
+  public:
+    typedef typename Settings::Recorder Recorder;
+    inline const Recorder& getRecorder() const;
+    inline Recorder& getRecorder();
+
   public:
     inline Channel getInputChannel() const;
     inline void setInputChannel(Channel inChannel);
@@ -159,6 +211,7 @@ class MidiInterface
     inline void setHandleNoteOn(void (*fptr)(byte channel, byte note, byte velocity));
     inline void setHandleAfterTouchPoly(void (*fptr)(byte channel, byte note, byte pressure));
     inline void setHandleControlChange(void (*fptr)(byte channel, byte number, byte value));
+    inline void setHandleControlChange14(void (*fptr)(byte channel, byte number, unsigned value));
     inline void setHandleProgramChange(void (*fptr)(byte channel, byte number));
     inline void setHandleAfterTouchChannel(void (*fptr)(byte channel, byte pressure));
     inline void setHandlePitchBend(void (*fptr)(byte channel, int bend));
@@ -183,6 +236,7 @@ class MidiInterface
     void (*mNoteOnCallback)(byte channel, byte note, byte velocity);
     void (*mAfterTouchPolyCallback)(byte channel, byte note, byte velocity);
     void (*mControlChangeCallback)(byte channel, byte, byte);
+    void (*mControlChange14Callback)(byte channel, byte, unsigned);
     void (*mProgramChangeCallback)(byte channel, byte);
     void (*mAfterTouchChannelCallback)(byte channel, byte);
     void (*mPitchBendCallback)(byte channel, int);
@@ -214,9 +268,15 @@ class MidiInterface
 
   private:
     bool parse();
+    bool parse(const UsbMidiEventPacket& inPacket);
+    inline bool parseSysExPacket(const byte* inData, byte inSize);
+    inline void abortParse();
+    inline bool handleMessage(Channel inChannel);
     inline void handleNullVelocityNoteOnAsNoteOff();
+    inline void recordInput();
     inline bool inputFilter(Channel inChannel);
     inline void resetInput();
+    void parseControlChange14(bool inChannelMatch);
 
   private:
     SerialPort& mSerial;
@@ -230,14 +290,43 @@ class MidiInterface
     unsigned        mPendingMessageIndex;
     unsigned        mCurrentRpnNumber;
     unsigned        mCurrentNrpnNumber;
+    SysExEncoder    mSysExEncoder;
+    unsigned        mSysExPosition_TX;
+    bool            mSysExChecksumValid;
     bool            mThruActivated  : 1;
     Thru::Mode      mThruFilterMode : 7;
     MidiMessage     mMessage;
 
+  private:
+    typedef typename Settings::SysExChecksum SysExChecksum;
+    typedef SysExChecksumWriter<SerialPort, SysExChecksum> SysExWriter;
+
+    SysExChecksum   mSysExChecksum_RX;
+    SysExChecksum   mSysExChecksum_TX;
+
+  private:
+    Statistics      mStatistics;
+    Latency         mLatency;
+    Tracer          mTracer;
+    Recorder        mRecorder;
+
+  private:
+    typedef ControlChange14State<Settings::Use14BitControlChange> ControlChange14;
+
+    ControlChange14 mControlChange14;
+
 
   private:
     inline StatusByte getStatus(MidiType inType,
                                 Channel inChannel) const;
+    unsigned sendParameterBatch(ParameterValue* ioParameters,
+                                unsigned inCount,
+                                Channel inChannel,
+                                DataByte inNumberMsbController,
+                                DataByte inNumberLsbController,
+                                unsigned& ioCurrentNumber,
+                                unsigned& ioOtherNumber);
+    inline unsigned getControlChangeBytes(unsigned inCount) const;
 };
 
 // -----------------------------------------------------------------------------
@@ -32,6 +32,8 @@ inline MidiInterface<SerialPort, Settings>::MidiInterface(SerialPort& inSerial)
   , mPendingMessageIndex(0)
   , mCurrentRpnNumber(0xffff)
   , mCurrentNrpnNumber(0xffff)
+  , mSysExPosition_TX(0)
+  , mSysExChecksumValid(false)
   , mThruActivated(true)
   , mThruFilterMode(Thru::Full)
 {
@@ -39,6 +41,7 @@ inline MidiInterface<SerialPort, Settings>::MidiInterface(SerialPort& inSerial)
   mNoteOnCallback                 = 0;
   mAfterTouchPolyCallback         = 0;
   mControlChangeCallback          = 0;
+  mControlChange14Callback        = 0;
   mProgramChangeCallback          = 0;
   mAfterTouchChannelCallback      = 0;
   mPitchBendCallback              = 0;
@@ -92,6 +95,8 @@ void MidiInterface<SerialPort, Settings>::begin(Channel inChannel)
   mCurrentRpnNumber  = 0xffff;
   mCurrentNrpnNumber = 0xffff;
 
+  mControlChange14.reset();
+
   mMessage.valid   = false;
   mMessage.type    = InvalidType;
   mMessage.channel = 0;
@@ -142,6 +147,13 @@ void MidiInterface<SerialPort, Settings>::send(MidiType inType,
     inData2 &= 0x7f;
 
     const StatusByte status = getStatus(inType, inChannel);
+    unsigned size = 2;
+    mTracer.begin(TraceEvent::Send, inType);
+
+    if (inType == ControlChange)
+    {
+      mControlChange14.onControlChangeSent(inChannel, inData1);
+    }
 
     if (Settings::UseRunningStatus)
     {
@@ -151,6 +163,11 @@ void MidiInterface<SerialPort, Settings>::send(MidiType inType,
         mRunningStatus_TX = status;
         mSerial.write(mRunningStatus_TX);
       }
+      else
+      {
+        mStatistics.onRunningStatusSent();
+        size--;
+      }
     }
     else
     {
@@ -163,7 +180,11 @@ void MidiInterface<SerialPort, Settings>::send(MidiType inType,
     if (inType != ProgramChange && inType != AfterTouchChannel)
     {
       mSerial.write(inData2);
+      size++;
     }
+    mStatistics.onMessageSent(inType, size);
+    mRecorder.record(CaptureDirection::Output, status, inData1, inData2);
+    mTracer.end(TraceEvent::Send, inType);
   }
   else if (inType >= Clock && inType <= SystemReset)
   {
@@ -234,6 +255,41 @@ void MidiInterface<SerialPort, Settings>::sendControlChange(DataByte inControlNu
   send(ControlChange, inControlNumber, inControlValue, inChannel);
 }
 
+/*! \brief Send a high resolution (14-bit) Control Change message
+  \param inControlNumber The MSB controller number (0 to 31), the LSB is sent
+  on inControlNumber + 32.
+  \param inControlValue  The 14-bit value for the specified controller (0 to 16383).
+  \param inChannel       The channel on which the message will be sent (1 to 16).
+
+  When Settings::Use14BitControlChange is enabled, the MSB is only sent when it
+  differs from the last one sent for this controller on this channel (any
+  other Control Change sent on this controller, or Reset All Controllers,
+  makes it be sent again).
+  @see MidiControlChangeNumber
+*/
+template<class SerialPort, class Settings>
+void MidiInterface<SerialPort, Settings>::sendControlChange14(DataByte inControlNumber,
+    unsigned inControlValue,
+    Channel inChannel)
+{
+  if (inChannel >= MIDI_CHANNEL_OFF || inChannel == MIDI_CHANNEL_OMNI)
+  {
+    return; // Don't send anything
+  }
+
+  const byte number = inControlNumber & 0x1f;
+  const byte valMsb = 0x7f & (inControlValue >> 7);
+  const byte valLsb = 0x7f & inControlValue;
+
+  const unsigned index = ((inChannel - 1) << 5) | number;
+  if (!mControlChange14.isMsbSent(index, valMsb))
+  {
+    sendControlChange(number, valMsb, inChannel);
+    mControlChange14.setMsbSent(index, valMsb);
+  }
+  sendControlChange(number + 32, valLsb, inChannel);
+}
+
 /*! \brief Send a Polyphonic AfterTouch message (applies to a specified note)
   \param inNoteNumber  The note to apply AfterTouch to (0 to 127).
   \param inPressure    The amount of AfterTouch to apply (0 to 127).
@@ -319,6 +375,7 @@ void MidiInterface<SerialPort, Settings>::sendSysEx(unsigned inLength,
     bool inArrayContainsBoundaries)
 {
   const bool writeBeginEndBytes = !inArrayContainsBoundaries;
+  mTracer.begin(TraceEvent::Send, SystemExclusive);
 
   if (writeBeginEndBytes)
   {
@@ -335,6 +392,127 @@ void MidiInterface<SerialPort, Settings>::sendSysEx(unsigned inLength,
     mSerial.write(0xf7);
   }
 
+  mStatistics.onMessageSent(SystemExclusive, writeBeginEndBytes ? inLength + 2 : inLength);
+  mRecorder.recordSysEx(CaptureDirection::Output, inArray, inLength);
+  mTracer.end(TraceEvent::Send, SystemExclusive);
+
+  if (Settings::UseRunningStatus)
+  {
+    mRunningStatus_TX = InvalidType;
+  }
+}
+
+/*! \brief Encode and send 8-bit data as a System Exclusive frame.
+  \param inLength  The number of data bytes to send (before encoding).
+  \param inData    The data to send: a byte pointer, or any object returning
+  bytes with the [] operator (eg: ProgmemSource to read from flash on AVR).
+
+  Data is packed as with encodeSysEx, but on the fly, without an intermediate
+  buffer. The 0xf0 & 0xf7 bytes are sent around it.
+  Use beginSysEx & co to add a header or a checksum.
+  @see encodeSysEx
+*/
+template<class SerialPort, class Settings>
+template<class Source>
+inline void MidiInterface<SerialPort, Settings>::sendSysExEncoded(unsigned inLength,
+    const Source& inData)
+{
+  beginSysEx();
+  sendSysExEncodedData(inLength, inData);
+  endSysEx();
+}
+
+/*! \brief Start streaming a System Exclusive frame (sends 0xf0).
+
+  Follow with sendSysExData (for the header: manufacturer ID, device ID...)
+  and/or sendSysExEncodedData calls, then terminate with endSysEx.
+  Real Time messages can be sent between these calls.
+  The checksum (see Settings::SysExChecksum) is computed along the way,
+  send it with sendSysExChecksum before endSysEx.
+*/
+template<class SerialPort, class Settings>
+inline void MidiInterface<SerialPort, Settings>::beginSysEx()
+{
+  mSysExEncoder.reset();
+  mSysExChecksum_TX.reset();
+  mSysExPosition_TX = 0;
+  mTracer.begin(TraceEvent::Send, SystemExclusive);
+
+  SysExWriter writer(mSerial, mSysExChecksum_TX, mSysExPosition_TX, Settings::SysExChecksumOffset);
+  writer.write(0xf0);
+}
+
+/*! \brief Send data bytes (0 to 127) as they are in the current SysEx frame.
+  \param inLength  The number of bytes to send.
+  \param inData    The bytes to send: a byte pointer, or any object returning
+  bytes with the [] operator.
+  @see beginSysEx
+*/
+template<class SerialPort, class Settings>
+template<class Source>
+inline void MidiInterface<SerialPort, Settings>::sendSysExData(unsigned inLength,
+    const Source& inData)
+{
+  SysExWriter writer(mSerial, mSysExChecksum_TX, mSysExPosition_TX, Settings::SysExChecksumOffset);
+  mSysExEncoder.flush(writer);
+  for (unsigned i = 0; i < inLength; ++i)
+  {
+    writer.write(byte(inData[i]) & 0x7f);
+  }
+}
+
+/*! \brief Encode and send 8-bit data in the current SysEx frame.
+  \param inLength  The number of data bytes to send (before encoding).
+  \param inData    The data to send: a byte pointer, or any object returning
+  bytes with the [] operator.
+
+  Consecutive calls form a single encoded stream, so data can be fed in chunks
+  of any size (eg: read from a file).
+  @see beginSysEx @see encodeSysEx
+*/
+template<class SerialPort, class Settings>
+template<class Source>
+inline void MidiInterface<SerialPort, Settings>::sendSysExEncodedData(unsigned inLength,
+    const Source& inData)
+{
+  SysExWriter writer(mSerial, mSysExChecksum_TX, mSysExPosition_TX, Settings::SysExChecksumOffset);
+  for (unsigned i = 0; i < inLength; ++i)
+  {
+    mSysExEncoder.write(inData[i], writer);
+  }
+}
+
+/*! \brief Send the checksum of the current SysEx frame.
+
+  Covers the bytes sent since beginSysEx, from Settings::SysExChecksumOffset.
+  Call it right before endSysEx. Nothing is sent with NoChecksum.
+  @see beginSysEx
+*/
+template<class SerialPort, class Settings>
+inline void MidiInterface<SerialPort, Settings>::sendSysExChecksum()
+{
+  SysExWriter writer(mSerial, mSysExChecksum_TX, mSysExPosition_TX, Settings::SysExChecksumOffset);
+  mSysExEncoder.flush(writer);
+  if (SysExChecksum::Size != 0)
+  {
+    mSerial.write(mSysExChecksum_TX.get());
+    mSysExPosition_TX++;
+  }
+}
+
+/*! \brief Terminate a streamed SysEx frame (sends pending data and 0xf7).
+  @see beginSysEx
+*/
+template<class SerialPort, class Settings>
+inline void MidiInterface<SerialPort, Settings>::endSysEx()
+{
+  SysExWriter writer(mSerial, mSysExChecksum_TX, mSysExPosition_TX, Settings::SysExChecksumOffset);
+  mSysExEncoder.flush(writer);
+  mSerial.write(0xf7);
+  mStatistics.onMessageSent(SystemExclusive, mSysExPosition_TX + 1);
+  mRecorder.recordSysEx(CaptureDirection::Output, 0, mSysExPosition_TX - 1);
+  mTracer.end(TraceEvent::Send, SystemExclusive);
+
   if (Settings::UseRunningStatus)
   {
     mRunningStatus_TX = InvalidType;
@@ -349,7 +527,11 @@ void MidiInterface<SerialPort, Settings>::sendSysEx(unsigned inLength,
 template<class SerialPort, class Settings>
 void MidiInterface<SerialPort, Settings>::sendTuneRequest()
 {
+  mTracer.begin(TraceEvent::Send, TuneRequest);
   mSerial.write(TuneRequest);
+  mStatistics.onMessageSent(TuneRequest, 1);
+  mRecorder.record(CaptureDirection::Output, TuneRequest, 0, 0);
+  mTracer.end(TraceEvent::Send, TuneRequest);
 
   if (Settings::UseRunningStatus)
   {
@@ -380,8 +562,12 @@ void MidiInterface<SerialPort, Settings>::sendTimeCodeQuarterFrame(DataByte inTy
 template<class SerialPort, class Settings>
 void MidiInterface<SerialPort, Settings>::sendTimeCodeQuarterFrame(DataByte inData)
 {
+  mTracer.begin(TraceEvent::Send, TimeCodeQuarterFrame);
   mSerial.write((byte)TimeCodeQuarterFrame);
   mSerial.write(inData);
+  mStatistics.onMessageSent(TimeCodeQuarterFrame, 2);
+  mRecorder.record(CaptureDirection::Output, TimeCodeQuarterFrame, inData, 0);
+  mTracer.end(TraceEvent::Send, TimeCodeQuarterFrame);
 
   if (Settings::UseRunningStatus)
   {
@@ -395,9 +581,13 @@ void MidiInterface<SerialPort, Settings>::sendTimeCodeQuarterFrame(DataByte inDa
 template<class SerialPort, class Settings>
 void MidiInterface<SerialPort, Settings>::sendSongPosition(unsigned inBeats)
 {
+  mTracer.begin(TraceEvent::Send, SongPosition);
   mSerial.write((byte)SongPosition);
   mSerial.write(inBeats & 0x7f);
   mSerial.write((inBeats >> 7) & 0x7f);
+  mStatistics.onMessageSent(SongPosition, 3);
+  mRecorder.record(CaptureDirection::Output, SongPosition, inBeats & 0x7f, (inBeats >> 7) & 0x7f);
+  mTracer.end(TraceEvent::Send, SongPosition);
 
   if (Settings::UseRunningStatus)
   {
@@ -409,8 +599,12 @@ void MidiInterface<SerialPort, Settings>::sendSongPosition(unsigned inBeats)
 template<class SerialPort, class Settings>
 void MidiInterface<SerialPort, Settings>::sendSongSelect(DataByte inSongNumber)
 {
+  mTracer.begin(TraceEvent::Send, SongSelect);
   mSerial.write((byte)SongSelect);
   mSerial.write(inSongNumber & 0x7f);
+  mStatistics.onMessageSent(SongSelect, 2);
+  mRecorder.record(CaptureDirection::Output, SongSelect, inSongNumber, 0);
+  mTracer.end(TraceEvent::Send, SongSelect);
 
   if (Settings::UseRunningStatus)
   {
@@ -438,7 +632,11 @@ void MidiInterface<SerialPort, Settings>::sendRealTime(MidiType inType)
     case Continue:
     case ActiveSensing:
     case SystemReset:
+      mTracer.begin(TraceEvent::Send, inType);
       mSerial.write((byte)inType);
+      mStatistics.onMessageSent(inType, 1);
+      mRecorder.record(CaptureDirection::Output, inType, 0, 0);
+      mTracer.end(TraceEvent::Send, inType);
       break;
     default:
       // Invalid Real Time marker
@@ -460,7 +658,8 @@ inline void MidiInterface<SerialPort, Settings>::beginRpn(unsigned inNumber,
     const byte numLsb = 0x7f & inNumber;
     sendControlChange(RPNLSB, numLsb, inChannel);
     sendControlChange(RPNMSB, numMsb, inChannel);
-    mCurrentRpnNumber = inNumber;
+    mCurrentRpnNumber  = inNumber;
+    mCurrentNrpnNumber = 0xffff; // Deselected by the RPN
   }
 }
 
@@ -541,6 +740,7 @@ inline void MidiInterface<SerialPort, Settings>::beginNrpn(unsigned inNumber,
     sendControlChange(NRPNLSB, numLsb, inChannel);
     sendControlChange(NRPNMSB, numMsb, inChannel);
     mCurrentNrpnNumber = inNumber;
+    mCurrentRpnNumber  = 0xffff; // Deselected by the NRPN
   }
 }
 
@@ -604,6 +804,55 @@ inline void MidiInterface<SerialPort, Settings>::endNrpn(Channel inChannel)
   mCurrentNrpnNumber = 0xffff;
 }
 
+/*! \brief Send a batch of RPN values using as few messages as possible.
+  \param ioParameters The parameters & values to send. The array is sorted by
+  parameter number in place. When a parameter appears more than once,
+  the last value wins.
+  \param inCount The number of parameters in the array.
+  \param inChannel The channel on which the messages will be sent (1 to 16).
+  \return The number of bytes saved compared to calling beginRpn and
+  sendRpnValue for each parameter in the original order.
+  @see sendNrpnBatch for details on encodings.
+*/
+template<class SerialPort, class Settings>
+unsigned MidiInterface<SerialPort, Settings>::sendRpnBatch(ParameterValue* ioParameters,
+    unsigned inCount,
+    Channel inChannel)
+{
+  return sendParameterBatch(ioParameters, inCount, inChannel,
+                            RPNMSB, RPNLSB, mCurrentRpnNumber, mCurrentNrpnNumber);
+}
+
+/*! \brief Send a batch of NRPN values using as few messages as possible.
+  \param ioParameters The parameters & values to send. The array is sorted by
+  parameter number in place. When a parameter appears more than once,
+  the last value wins.
+  \param inCount The number of parameters in the array.
+  \param inChannel The channel on which the messages will be sent (1 to 16).
+  \return The number of bytes saved compared to calling beginNrpn and
+  sendNrpnValue for each parameter in the original order.
+
+  Sorting groups parameters sharing the same number MSB, so only the number
+  LSB has to be sent to select the next one. For each value, the cheapest
+  encoding is picked:
+  - Nothing, if the receiver already holds the value,
+  - Data Entry MSB only, if the value LSB is zero (receiving an MSB clears the LSB),
+  - Data Entry LSB only, if the current value is known and has the same MSB,
+  - Data Increment / Decrement, if the current value is known and one step
+    away (RP-018 receivers step by 1, whatever the data byte),
+  - Data Entry MSB & LSB otherwise.
+  Parameter numbers and values are 14-bit, upper bits are ignored.
+  The NRPN is left selected, call endNrpn to deselect it.
+*/
+template<class SerialPort, class Settings>
+unsigned MidiInterface<SerialPort, Settings>::sendNrpnBatch(ParameterValue* ioParameters,
+    unsigned inCount,
+    Channel inChannel)
+{
+  return sendParameterBatch(ioParameters, inCount, inChannel,
+                            NRPNMSB, NRPNLSB, mCurrentNrpnNumber, mCurrentRpnNumber);
+}
+
 /*! @} */ // End of doc group MIDI Output
 
 // -----------------------------------------------------------------------------
@@ -615,6 +864,125 @@ StatusByte MidiInterface<SerialPort, Settings>::getStatus(MidiType inType,
   return ((byte)inType | ((inChannel - 1) & 0x0f));
 }
 
+// Private method: see sendNrpnBatch for documentation
+template<class SerialPort, class Settings>
+unsigned MidiInterface<SerialPort, Settings>::sendParameterBatch(ParameterValue* ioParameters,
+    unsigned inCount,
+    Channel inChannel,
+    DataByte inNumberMsbController,
+    DataByte inNumberLsbController,
+    unsigned& ioCurrentNumber,
+    unsigned& ioOtherNumber)
+{
+  // Naive cost: select (when changed) and send both value bytes, in order.
+  unsigned naiveCount = 0;
+  unsigned selected   = ioCurrentNumber;
+  for (unsigned i = 0; i < inCount; ++i)
+  {
+    if ((ioParameters[i].number & 0x3fff) != selected)
+    {
+      naiveCount += 2;
+      selected = ioParameters[i].number & 0x3fff;
+    }
+    naiveCount += 2;
+  }
+
+  // Stable insertion sort by number, the currently selected one first:
+  // batches are small, and this needs neither heap nor recursion.
+  for (unsigned i = 1; i < inCount; ++i)
+  {
+    const ParameterValue parameter = ioParameters[i];
+    const unsigned number = parameter.number & 0x3fff;
+    const unsigned key    = number == ioCurrentNumber ? 0 : number + 1;
+    unsigned j = i;
+    while (j > 0)
+    {
+      const unsigned previous = ioParameters[j - 1].number & 0x3fff;
+      if ((previous == ioCurrentNumber ? 0 : previous + 1) <= key)
+        break;
+      ioParameters[j] = ioParameters[j - 1];
+      --j;
+    }
+    ioParameters[j] = parameter;
+  }
+
+  unsigned count = 0;
+  for (unsigned i = 0; i < inCount; ++i)
+  {
+    const ParameterValue& parameter = ioParameters[i];
+    const unsigned number = parameter.number & 0x3fff;
+
+    if (i + 1 < inCount && (ioParameters[i + 1].number & 0x3fff) == number)
+    {
+      continue; // Overridden by a later value.
+    }
+
+    const unsigned value   = parameter.value  & 0x3fff;
+    const unsigned current = parameter.current & 0x3fff;
+    const bool known       = parameter.current != ParameterValue::Unknown;
+
+    if (known && current == value)
+    {
+      continue; // Already there, no need to select it either.
+    }
+
+    if (number != ioCurrentNumber)
+    {
+      if (ioCurrentNumber == 0xffff || (number >> 7) != (ioCurrentNumber >> 7))
+      {
+        sendControlChange(inNumberMsbController, 0x7f & (number >> 7), inChannel);
+        count++;
+      }
+      sendControlChange(inNumberLsbController, 0x7f & number, inChannel);
+      count++;
+      ioCurrentNumber = number;
+      ioOtherNumber   = 0xffff; // RPN & NRPN deselect each other
+    }
+
+    const byte valMsb = 0x7f & (value >> 7);
+    const byte valLsb = 0x7f & value;
+
+    if (valLsb == 0)
+    {
+      sendControlChange(DataEntryMSB, valMsb, inChannel);
+    }
+    else if (known && (current >> 7) == valMsb)
+    {
+      sendControlChange(DataEntryLSB, valLsb, inChannel);
+    }
+    else if (known && value == current + 1)
+    {
+      sendControlChange(DataIncrement, 1, inChannel);
+    }
+    else if (known && value + 1 == current)
+    {
+      sendControlChange(DataDecrement, 1, inChannel);
+    }
+    else
+    {
+      sendControlChange(DataEntryMSB, valMsb, inChannel);
+      sendControlChange(DataEntryLSB, valLsb, inChannel);
+      count++;
+    }
+    count++;
+  }
+
+  const unsigned naiveBytes = getControlChangeBytes(naiveCount);
+  const unsigned bytes      = getControlChangeBytes(count);
+  return naiveBytes > bytes ? naiveBytes - bytes : 0;
+}
+
+// Private method: wire size of a run of Control Change messages.
+template<class SerialPort, class Settings>
+inline unsigned MidiInterface<SerialPort, Settings>::getControlChangeBytes(unsigned inCount) const
+{
+  if (inCount == 0)
+    return 0;
+
+  // With Running Status, only the first message carries a status byte.
+  return Settings::UseRunningStatus ? 2 * inCount + 1 : 3 * inCount;
+}
+
 // -----------------------------------------------------------------------------
 //                                  Input
 // -----------------------------------------------------------------------------
@@ -648,12 +1016,82 @@ inline bool MidiInterface<SerialPort, Settings>::read(Channel inChannel)
   if (!parse())
     return false;
 
+  return handleMessage(inChannel);
+}
+
+/*! \brief Read a USB-MIDI event packet using the main input channel.
+
+  Packets are decoded as a whole, instead of going through the byte parser:
+  use this with UsbTransport::readPacket, rather than read() without argument.
+  \return True if a valid message has been stored in the structure, false if
+  not (SysEx start & continue packets return false until the end of the frame).
+  @see read()
+*/
+template<class SerialPort, class Settings>
+inline bool MidiInterface<SerialPort, Settings>::read(const UsbMidiEventPacket& inPacket)
+{
+  return read(inPacket, mInputChannel);
+}
+
+/*! \brief Read a USB-MIDI event packet on a specified channel.
+*/
+template<class SerialPort, class Settings>
+inline bool MidiInterface<SerialPort, Settings>::read(const UsbMidiEventPacket& inPacket,
+    Channel inChannel)
+{
+  if (inChannel >= MIDI_CHANNEL_OFF)
+    return false; // MIDI Input disabled.
+
+  if (!parse(inPacket))
+    return false;
+
+  return handleMessage(inChannel);
+}
+
+/*! \brief Report a 14-bit Control Change MSB still waiting for its LSB.
+
+  With Settings::ControlChange14LsbTimeout, an MSB sent alone is only
+  reported when enough other messages follow it. Call this when the input is
+  idle (eg: nothing received for a few milliseconds), so that the last MSB of
+  a burst gets reported too, with a null LSB.
+  Does nothing unless Settings::Use14BitControlChange is enabled.
+*/
+template<class SerialPort, class Settings>
+inline void MidiInterface<SerialPort, Settings>::flushControlChange14()
+{
+  const unsigned index = mControlChange14.getPending();
+  if (index == ControlChange14::sNoPending)
+    return;
+
+  mControlChange14.clearPending();
+  if (mControlChange14Callback != 0)
+    mControlChange14Callback((index >> 5) + 1, index & 0x1f,
+                             unsigned(mControlChange14.getMsb(index)) << 7);
+}
+
+// Private method: process a message once parsed
+template<class SerialPort, class Settings>
+inline bool MidiInterface<SerialPort, Settings>::handleMessage(Channel inChannel)
+{
+  mLatency.onMessageComplete();
+  mTracer.end(TraceEvent::Parse, mMessage.type);
+  mStatistics.onMessageReceived(mMessage.type);
+  recordInput();
   handleNullVelocityNoteOnAsNoteOff();
   const bool channelMatch = inputFilter(inChannel);
 
+  if (Settings::Use14BitControlChange)
+  {
+    parseControlChange14(channelMatch);
+  }
+
   if (channelMatch)
   {
+    mLatency.onCallbackBegin();
+    mTracer.begin(TraceEvent::Callback, mMessage.type);
     launchCallback();
+    mTracer.end(TraceEvent::Callback, mMessage.type);
+    mLatency.onCallbackEnd();
   }
 
   thruFilter(inChannel);
@@ -681,6 +1119,7 @@ bool MidiInterface<SerialPort, Settings>::parse()
   // When the message is done, store it.
 
   const byte extracted = mSerial.read();
+  mStatistics.onByteReceived();
 
   // Ignore Undefined
   if (extracted == 0xf9 || extracted == 0xfd)
@@ -699,6 +1138,8 @@ bool MidiInterface<SerialPort, Settings>::parse()
   {
     // Start a new pending message
     mPendingMessage[0] = extracted;
+    mLatency.onMessageStart();
+    mTracer.begin(TraceEvent::Parse, 0);
 
     // Check for running status first
     if (isChannelMessage(getTypeFromStatusByte(mRunningStatus_RX)))
@@ -712,6 +1153,7 @@ bool MidiInterface<SerialPort, Settings>::parse()
         mPendingMessage[0]   = mRunningStatus_RX;
         mPendingMessage[1]   = extracted;
         mPendingMessageIndex = 1;
+        mStatistics.onRunningStatusReceived();
       }
       // Else: well, we received another status byte,
       // so the running status does not apply here.
@@ -767,11 +1209,14 @@ bool MidiInterface<SerialPort, Settings>::parse()
         mPendingMessageExpectedLenght = MidiMessage::sSysExMaxSize;
         mRunningStatus_RX = InvalidType;
         mMessage.sysexArray[0] = SystemExclusive;
+        mSysExChecksum_RX.reset();
         break;
 
       case InvalidType:
       default:
         // This is obviously wrong. Let's get the hell out'a here.
+        mStatistics.onParseError();
+        abortParse();
         resetInput();
         return false;
         break;
@@ -830,6 +1275,8 @@ bool MidiInterface<SerialPort, Settings>::parse()
           // interleaved into. Oh, and without killing the running status..
           // This is done by leaving the pending message as is,
           // it will be completed on next calls.
+          mLatency.onRealTimeStart();
+          mTracer.begin(TraceEvent::Parse, 0); // Nested in the pending one
 
           mMessage.type    = (MidiType)extracted;
           mMessage.data1   = 0;
@@ -842,6 +1289,13 @@ bool MidiInterface<SerialPort, Settings>::parse()
         case 0xf7:
           if (mMessage.sysexArray[0] == SystemExclusive)
           {
+            // The checksum is the last data byte, not covered by itself.
+            if (SysExChecksum::Size != 0)
+            {
+              mSysExChecksumValid = mPendingMessageIndex > Settings::SysExChecksumOffset &&
+                mSysExChecksum_RX.get() == mMessage.sysexArray[mPendingMessageIndex - 1];
+            }
+
             // Store the last byte (EOX)
             mMessage.sysexArray[mPendingMessageIndex++] = 0xf7;
             mMessage.type = SystemExclusive;
@@ -858,6 +1312,8 @@ bool MidiInterface<SerialPort, Settings>::parse()
           else
           {
             // Well well well.. error.
+            mStatistics.onParseError();
+            abortParse();
             resetInput();
             return false;
           }
@@ -869,7 +1325,13 @@ bool MidiInterface<SerialPort, Settings>::parse()
 
     // Add extracted data byte to pending message
     if (mPendingMessage[0] == SystemExclusive)
+    {
       mMessage.sysexArray[mPendingMessageIndex] = extracted;
+
+      // Checksum lags one byte behind, until we know which one is the last.
+      if (SysExChecksum::Size != 0 && mPendingMessageIndex > Settings::SysExChecksumOffset)
+        mSysExChecksum_RX.update(mMessage.sysexArray[mPendingMessageIndex - 1]);
+    }
     else
       mPendingMessage[mPendingMessageIndex] = extracted;
 
@@ -881,6 +1343,8 @@ bool MidiInterface<SerialPort, Settings>::parse()
       // the buffer. If this happens, try increasing MidiMessage::sSysExMaxSize.
       if (mPendingMessage[0] == SystemExclusive)
       {
+        mStatistics.onSysExOverflow();
+        abortParse();
         resetInput();
         return false;
       }
@@ -943,6 +1407,143 @@ bool MidiInterface<SerialPort, Settings>::parse()
   }
 }
 
+// Private method: USB-MIDI event packet parser
+template<class SerialPort, class Settings>
+bool MidiInterface<SerialPort, Settings>::parse(const UsbMidiEventPacket& inPacket)
+{
+  // The Code Index Number gives the packet type and size,
+  // every packet holds a complete message or a SysEx chunk.
+  const byte codeIndexNumber = inPacket.getCodeIndexNumber();
+  const byte* data = inPacket.getMidiData();
+  const bool sysEx = codeIndexNumber == CodeIndexNumbers::sysExStart ||
+                     codeIndexNumber == CodeIndexNumbers::sysExEnds2Bytes ||
+                     codeIndexNumber == CodeIndexNumbers::sysExEnds3Bytes ||
+                     (codeIndexNumber == CodeIndexNumbers::sysExEnds1Byte && data[0] == 0xf7);
+
+  if (mPendingMessageIndex != 0 && !sysEx && codeIndexNumber != CodeIndexNumbers::singleByte)
+  {
+    // Only Real Time can be interleaved: the SysEx frame is dropped.
+    mStatistics.onParseError();
+    abortParse();
+    resetInput();
+  }
+
+  if (mPendingMessageIndex == 0)
+  {
+    mLatency.onMessageStart(); // Not within a SysEx frame
+    mTracer.begin(TraceEvent::Parse, 0);
+  }
+  else if (!sysEx)
+  {
+    mLatency.onRealTimeStart(); // Interleaved in a SysEx frame
+    mTracer.begin(TraceEvent::Parse, 0);
+  }
+
+  switch (codeIndexNumber)
+  {
+    case CodeIndexNumbers::sysExStart:
+      return parseSysExPacket(data, 3);
+
+    case CodeIndexNumbers::sysExEnds1Byte:
+      if (data[0] != 0xf7)
+        break; // Single byte System Common (Tune Request)
+      return parseSysExPacket(data, 1);
+
+    case CodeIndexNumbers::sysExEnds2Bytes:
+      return parseSysExPacket(data, 2);
+
+    case CodeIndexNumbers::sysExEnds3Bytes:
+      return parseSysExPacket(data, 3);
+
+    case CodeIndexNumbers::misc:
+    case CodeIndexNumbers::cableEvent:
+      abortParse();
+      return false; // Reserved for future extensions.
+
+    default:
+      break;
+  }
+
+  const MidiType type = getTypeFromStatusByte(data[0]);
+  if (type == InvalidType || type == SystemExclusive)
+  {
+    abortParse();
+    return false;
+  }
+
+  const byte size = CodeIndexNumbers::getSize(codeIndexNumber);
+
+  mMessage.type    = type;
+  mMessage.channel = isChannelMessage(type) ? getChannelFromStatusByte(data[0]) : 0;
+  mMessage.data1   = size > 1 ? data[1] & 0x7f : 0;
+  mMessage.data2   = size > 2 ? data[2] & 0x7f : 0;
+  mMessage.valid   = true;
+  return true;
+}
+
+// Private method: append SysEx packet data, true when the frame is complete.
+template<class SerialPort, class Settings>
+inline bool MidiInterface<SerialPort, Settings>::parseSysExPacket(const byte* inData,
+    byte inSize)
+{
+  for (byte i = 0; i < inSize; ++i)
+  {
+    const byte extracted = inData[i];
+
+    if (extracted == 0xf0)
+    {
+      mPendingMessage[0] = SystemExclusive;
+      mPendingMessageIndex = 1;
+      mMessage.sysexArray[0] = SystemExclusive;
+      mSysExChecksum_RX.reset();
+    }
+    else if (mPendingMessage[0] != SystemExclusive || mPendingMessageIndex == 0)
+    {
+      mStatistics.onParseError();
+      abortParse();
+      return false; // Continuation of a frame we never started (or dropped).
+    }
+    else if (extracted == 0xf7)
+    {
+      if (SysExChecksum::Size != 0)
+      {
+        mSysExChecksumValid = mPendingMessageIndex > Settings::SysExChecksumOffset &&
+          mSysExChecksum_RX.get() == mMessage.sysexArray[mPendingMessageIndex - 1];
+      }
+
+      mMessage.sysexArray[mPendingMessageIndex++] = 0xf7;
+      mMessage.type    = SystemExclusive;
+      mMessage.data1   = mPendingMessageIndex & 0xff; // LSB
+      mMessage.data2   = mPendingMessageIndex >> 8;   // MSB
+      mMessage.channel = 0;
+      mMessage.valid   = true;
+
+      mPendingMessage[0] = 0;
+      resetInput();
+      return true;
+    }
+    else if (mPendingMessageIndex >= MidiMessage::sSysExMaxSize - 1)
+    {
+      // Overflow: drop the frame, try increasing Settings::SysExMaxSize.
+      mStatistics.onSysExOverflow();
+      abortParse();
+      mPendingMessage[0] = 0;
+      resetInput();
+      return false;
+    }
+    else
+    {
+      mMessage.sysexArray[mPendingMessageIndex] = extracted;
+
+      if (SysExChecksum::Size != 0 && mPendingMessageIndex > Settings::SysExChecksumOffset)
+        mSysExChecksum_RX.update(mMessage.sysexArray[mPendingMessageIndex - 1]);
+
+      mPendingMessageIndex++;
+    }
+  }
+  return false;
+}
+
 // Private method, see midi_Settings.h for documentation
 template<class SerialPort, class Settings>
 inline void MidiInterface<SerialPort, Settings>::handleNullVelocityNoteOnAsNoteOff()
@@ -954,6 +1555,31 @@ inline void MidiInterface<SerialPort, Settings>::handleNullVelocityNoteOnAsNoteO
   }
 }
 
+// Private method: the message being parsed is dropped
+template<class SerialPort, class Settings>
+inline void MidiInterface<SerialPort, Settings>::abortParse()
+{
+  mLatency.onMessageAbort();
+  mTracer.end(TraceEvent::Parse, InvalidType);
+}
+
+// Private method: pass the received message to the recorder, as it was read
+template<class SerialPort, class Settings>
+inline void MidiInterface<SerialPort, Settings>::recordInput()
+{
+  if (mMessage.type == SystemExclusive)
+  {
+    mRecorder.recordSysEx(CaptureDirection::Input, mMessage.sysexArray, mMessage.getSysExSize());
+  }
+  else
+  {
+    const byte status = mMessage.type < SystemExclusive
+                        ? getStatus(mMessage.type, mMessage.channel)
+                        : byte(mMessage.type);
+    mRecorder.record(CaptureDirection::Input, status, mMessage.data1, mMessage.data2);
+  }
+}
+
 // Private method: check if the received message is on the listened channel
 template<class SerialPort, class Settings>
 inline bool MidiInterface<SerialPort, Settings>::inputFilter(Channel inChannel)
@@ -983,6 +1609,60 @@ inline bool MidiInterface<SerialPort, Settings>::inputFilter(Channel inChannel)
   }
 }
 
+// Private method: pair 14-bit Control Change MSB & LSB,
+// see XE_MIDI_Settings.h for documentation.
+// Every message counts for the LSB timeout, filtered out or not.
+template<class SerialPort, class Settings>
+void MidiInterface<SerialPort, Settings>::parseControlChange14(bool inChannelMatch)
+{
+  if (mMessage.type >= Clock)
+  {
+    // Real Time messages can be interleaved between MSB & LSB.
+    return;
+  }
+
+  if (inChannelMatch && mMessage.type == ControlChange && mMessage.data1 < 64)
+  {
+    const byte number     = mMessage.data1 & 0x1f;
+    const unsigned index  = ((mMessage.channel - 1) << 5) | number;
+
+    if (mMessage.data1 < 32)
+    {
+      // MSB: report the previous one if its LSB never came.
+      flushControlChange14();
+      mControlChange14.setMsb(index, mMessage.data2);
+
+      if (Settings::ControlChange14LsbTimeout == 0)
+      {
+        if (mControlChange14Callback != 0)
+          mControlChange14Callback(mMessage.channel, number, unsigned(mMessage.data2) << 7);
+      }
+      else
+      {
+        mControlChange14.setPending(index, Settings::ControlChange14LsbTimeout);
+      }
+    }
+    else
+    {
+      // LSB: completes the pending MSB, or refines the last one received.
+      if (mControlChange14.getPending() == index)
+        mControlChange14.clearPending();
+      else
+        flushControlChange14();
+
+      if (mControlChange14Callback != 0)
+        mControlChange14Callback(mMessage.channel, number,
+                                 unsigned(mControlChange14.getMsb(index)) << 7 | mMessage.data2);
+    }
+    return;
+  }
+
+  if (mControlChange14.countdown())
+  {
+    flushControlChange14();
+  }
+}
+
 // Private method: reset input attributes
 template<class SerialPort, class Settings>
 inline void MidiInterface<SerialPort, Settings>::resetInput()
@@ -1050,6 +1730,17 @@ inline unsigned MidiInterface<SerialPort, Settings>::getSysExArrayLength() const
   return mMessage.getSysExSize();
 }
 
+/*! \brief Check the checksum of the last System Exclusive frame received.
+
+  \return True if the last data byte matches the checksum of the bytes
+  before it (see Settings::SysExChecksum), always true without checksum policy.
+*/
+template<class SerialPort, class Settings>
+inline bool MidiInterface<SerialPort, Settings>::isSysExChecksumValid() const
+{
+  return SysExChecksum::Size == 0 || mSysExChecksumValid;
+}
+
 /*! \brief Check if a valid message is stored in the structure. */
 template<class SerialPort, class Settings>
 inline bool MidiInterface<SerialPort, Settings>::check() const
@@ -1059,6 +1750,91 @@ inline bool MidiInterface<SerialPort, Settings>::check() const
 
 // -----------------------------------------------------------------------------
 
+/*! \brief Get a snapshot of the statistics (see Settings::Statistics).
+*/
+template<class SerialPort, class Settings>
+inline typename MidiInterface<SerialPort, Settings>::Statistics
+MidiInterface<SerialPort, Settings>::getStatistics() const
+{
+  return mStatistics;
+}
+
+/*! \brief Clear all the statistics counters.
+*/
+template<class SerialPort, class Settings>
+inline void MidiInterface<SerialPort, Settings>::resetStatistics()
+{
+  mStatistics.reset();
+}
+
+/*! \brief Send the statistics as a SysEx frame on the output,
+  see MidiStatistics::writeSysEx for the format.
+  For a text report, use getStatistics().writeText(Serial).
+*/
+template<class SerialPort, class Settings>
+inline void MidiInterface<SerialPort, Settings>::sendStatistics()
+{
+  mTracer.begin(TraceEvent::Send, SystemExclusive);
+  mStatistics.writeSysEx(mSerial);
+  mTracer.end(TraceEvent::Send, SystemExclusive);
+
+  if (Settings::UseRunningStatus)
+  {
+    mRunningStatus_TX = InvalidType;
+  }
+}
+
+/*! \brief Get the latency histograms (see Settings::Latency).
+*/
+template<class SerialPort, class Settings>
+inline const typename MidiInterface<SerialPort, Settings>::Latency&
+MidiInterface<SerialPort, Settings>::getLatency() const
+{
+  return mLatency;
+}
+
+/*! \brief Clear the latency histograms.
+*/
+template<class SerialPort, class Settings>
+inline void MidiInterface<SerialPort, Settings>::resetLatency()
+{
+  mLatency.reset();
+}
+
+/*! \brief Get the trace events recorder (see Settings::Tracer).
+*/
+template<class SerialPort, class Settings>
+inline const typename MidiInterface<SerialPort, Settings>::Tracer&
+MidiInterface<SerialPort, Settings>::getTracer() const
+{
+  return mTracer;
+}
+
+template<class SerialPort, class Settings>
+inline typename MidiInterface<SerialPort, Settings>::Tracer&
+MidiInterface<SerialPort, Settings>::getTracer()
+{
+  return mTracer;
+}
+
+/*! \brief Get the messages recorder (see Settings::Recorder).
+*/
+template<class SerialPort, class Settings>
+inline const typename MidiInterface<SerialPort, Settings>::Recorder&
+MidiInterface<SerialPort, Settings>::getRecorder() const
+{
+  return mRecorder;
+}
+
+template<class SerialPort, class Settings>
+inline typename MidiInterface<SerialPort, Settings>::Recorder&
+MidiInterface<SerialPort, Settings>::getRecorder()
+{
+  return mRecorder;
+}
+
+// -----------------------------------------------------------------------------
+
 template<class SerialPort, class Settings>
 inline Channel MidiInterface<SerialPort, Settings>::getInputChannel() const
 {
@@ -1141,6 +1917,9 @@ template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settin
 template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleControlChange(void (*fptr)(byte channel, byte number, byte value))     {
   mControlChangeCallback        = fptr;
 }
+template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleControlChange14(void (*fptr)(byte channel, byte number, unsigned value)) {
+  mControlChange14Callback      = fptr;
+}
 template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleProgramChange(void (*fptr)(byte channel, byte number))                 {
   mProgramChangeCallback        = fptr;
 }
@@ -1324,6 +2103,9 @@ void MidiInterface<SerialPort, Settings>::thruFilter(Channel inChannel)
   if (!mThruActivated || (mThruFilterMode == Thru::Off))
     return;
 
+  bool forwarded = false;
+  mTracer.begin(TraceEvent::Thru, mMessage.type);
+
   // First, check if the received message is Channel
   if (mMessage.type >= NoteOff && mMessage.type <= PitchBend)
   {
@@ -1338,6 +2120,7 @@ void MidiInterface<SerialPort, Settings>::thruFilter(Channel inChannel)
              mMessage.data1,
              mMessage.data2,
              mMessage.channel);
+        forwarded = true;
         break;
 
       case Thru::SameChannel:
@@ -1347,6 +2130,7 @@ void MidiInterface<SerialPort, Settings>::thruFilter(Channel inChannel)
                mMessage.data1,
                mMessage.data2,
                mMessage.channel);
+          forwarded = true;
         }
         break;
 
@@ -1357,6 +2141,7 @@ void MidiInterface<SerialPort, Settings>::thruFilter(Channel inChannel)
                mMessage.data1,
                mMessage.data2,
                mMessage.channel);
+          forwarded = true;
         }
         break;
 
@@ -1376,31 +2161,47 @@ void MidiInterface<SerialPort, Settings>::thruFilter(Channel inChannel)
       case Continue:
       case ActiveSensing:
       case SystemReset:
-      case TuneRequest:
         sendRealTime(mMessage.type);
+        forwarded = true;
+        break;
+
+      case TuneRequest:
+        sendTuneRequest();
+        forwarded = true;
         break;
 
       case SystemExclusive:
         // Send SysEx (0xf0 and 0xf7 are included in the buffer)
         sendSysEx(getSysExArrayLength(), getSysExArray(), true);
+        forwarded = true;
         break;
 
       case SongSelect:
         sendSongSelect(mMessage.data1);
+        forwarded = true;
         break;
 
       case SongPosition:
         sendSongPosition(mMessage.data1 | ((unsigned)mMessage.data2 << 7));
+        forwarded = true;
         break;
 
       case TimeCodeQuarterFrame:
         sendTimeCodeQuarterFrame(mMessage.data1, mMessage.data2);
+        forwarded = true;
         break;
 
       default:
         break; // LCOV_EXCL_LINE - Unreacheable code, but prevents unhandled case warning.
     }
   }
+
+  if (forwarded)
+  {
+    mStatistics.onThru();
+    mLatency.onThruSent();
+  }
+  mTracer.end(TraceEvent::Thru, mMessage.type);
 }
 
 END_MIDI_NAMESPACE
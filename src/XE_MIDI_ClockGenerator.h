@@ -0,0 +1,94 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#pragma once
+
+#include "XE_MIDI_Defs.h"
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief MIDI clock generator: 24 Clock messages per quarter note, Start,
+  Stop, Continue and Song Position Pointer, sent to one or several
+  interfaces in the same update call.
+
+  Ticks are scheduled from absolute times: each tick is due one period after
+  the time the previous one was due, not after it was sent. The period is
+  kept as a whole number of microseconds plus an exact fraction (eg:
+  20833 + 1/3 us at 120 BPM), so the clock does not drift, whatever the
+  tempo, and the load of loop() only delays ticks, never the ones after.
+  Ticks missed by a late update are sent together, to keep the position.
+
+  Interface is a MidiInterface, or any class with sendRealTime and
+  sendSongPosition. To drive interfaces of different types, wrap them in a
+  common type.
+
+  \code{.cpp}
+  midi::ClockGenerator<MidiInterfaceType> clock(MIDI);
+
+  void setup() { clock.addOutput(MIDI2); clock.setBpm(12000); clock.start(micros()); }
+  void loop()  { clock.update(micros()); }
+  \endcode
+*/
+template<class Interface, unsigned MaxOutputs = 4>
+class ClockGenerator
+{
+  public:
+    inline explicit ClockGenerator(Interface& ioMidi);
+
+  public:
+    inline bool addOutput(Interface& ioMidi);
+    inline void setBpm(unsigned long inHundredthsOfBpm);
+    inline void setTempo(unsigned long inMicrosPerQuarter);
+
+  public:
+    inline void start(unsigned long inNowMicros);
+    inline void stop();
+    inline void resume(unsigned long inNowMicros);
+    inline void setSongPosition(unsigned inBeats);
+    inline unsigned update(unsigned long inNowMicros);
+
+  public:
+    inline bool isRunning() const;
+    inline unsigned getSongPosition() const;
+    inline unsigned long getTickCount() const;
+    inline unsigned long getNextTickTime() const;
+
+  private:
+    inline void setPeriod(unsigned long inNumerator, unsigned long inDenominator);
+    inline void sendRealTime(MidiType inType);
+
+  private:
+    typedef char MaxOutputsCheck[(MaxOutputs >= 1 && MaxOutputs <= 255) ? 1 : -1];
+
+    Interface*      mOutputs[MaxOutputs];
+    byte            mOutputCount;
+    bool            mRunning;
+    unsigned long   mPeriod;        ///< Whole microseconds of the tick period,
+    unsigned long   mRemainder;     ///< plus mRemainder / mDenominator.
+    unsigned long   mDenominator;
+    unsigned long   mFraction;      ///< Fraction of the next tick time, over mDenominator.
+    unsigned long   mNextTime;      ///< When the next tick is due.
+    unsigned long   mPosition;      ///< Ticks since the start of the song.
+    unsigned long   mTickCount;     ///< Ticks sent since the last start.
+};
+
+END_MIDI_NAMESPACE
+
+#include "XE_MIDI_ClockGenerator.hpp"
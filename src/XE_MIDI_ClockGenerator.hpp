@@ -0,0 +1,230 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#pragma once
+
+BEGIN_MIDI_NAMESPACE
+
+template<class Interface, unsigned MaxOutputs>
+inline ClockGenerator<Interface, MaxOutputs>::ClockGenerator(Interface& ioMidi)
+  : mOutputCount(1)
+  , mRunning(false)
+  , mPeriod(0)
+  , mRemainder(0)
+  , mDenominator(1)
+  , mFraction(0)
+  , mNextTime(0)
+  , mPosition(0)
+  , mTickCount(0)
+{
+  mOutputs[0] = &ioMidi;
+  setBpm(12000);
+}
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Send the clock to another interface too.
+  \return false if MaxOutputs interfaces are already driven.
+*/
+template<class Interface, unsigned MaxOutputs>
+inline bool ClockGenerator<Interface, MaxOutputs>::addOutput(Interface& ioMidi)
+{
+  if (mOutputCount == MaxOutputs)
+  {
+    return false;
+  }
+  mOutputs[mOutputCount++] = &ioMidi;
+  return true;
+}
+
+/*! \brief Set the tempo in hundredths of BPM (eg: 12050 for 120.5 BPM).
+  While running, the next tick is due one new period after the last one.
+*/
+template<class Interface, unsigned MaxOutputs>
+inline void ClockGenerator<Interface, MaxOutputs>::setBpm(unsigned long inHundredthsOfBpm)
+{
+  // 60 seconds * 100 / 24 ticks per quarter note.
+  setPeriod(250000000UL, inHundredthsOfBpm);
+}
+
+/*! \brief Set the tempo in microseconds per quarter note, as in Standard
+  MIDI Files (see SmfPlayer::getTempo).
+*/
+template<class Interface, unsigned MaxOutputs>
+inline void ClockGenerator<Interface, MaxOutputs>::setTempo(unsigned long inMicrosPerQuarter)
+{
+  setPeriod(inMicrosPerQuarter, 24);
+}
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Send Start, and the first tick now, from the start of the song.
+  \param inNowMicros  Current time in microseconds (eg: micros()).
+*/
+template<class Interface, unsigned MaxOutputs>
+inline void ClockGenerator<Interface, MaxOutputs>::start(unsigned long inNowMicros)
+{
+  sendRealTime(Start);
+  mPosition  = 0;
+  mTickCount = 0;
+  mNextTime  = inNowMicros;
+  mFraction  = 0;
+  mRunning   = true;
+}
+
+/*! \brief Send Stop, the position is kept for resume. */
+template<class Interface, unsigned MaxOutputs>
+inline void ClockGenerator<Interface, MaxOutputs>::stop()
+{
+  if (!mRunning)
+  {
+    return;
+  }
+  sendRealTime(Stop);
+  mRunning = false;
+}
+
+/*! \brief Send Continue, and the next tick now, from the position where
+  the clock stopped, or the one set with setSongPosition.
+*/
+template<class Interface, unsigned MaxOutputs>
+inline void ClockGenerator<Interface, MaxOutputs>::resume(unsigned long inNowMicros)
+{
+  if (mRunning)
+  {
+    return;
+  }
+  sendRealTime(Continue);
+  mTickCount = 0;
+  mNextTime  = inNowMicros;
+  mFraction  = 0;
+  mRunning   = true;
+}
+
+/*! \brief Send a Song Position Pointer, for the next resume.
+  Only while stopped, as required by the MIDI specification.
+  \param inBeats  Position in MIDI beats (sixteenth notes, 6 ticks).
+*/
+template<class Interface, unsigned MaxOutputs>
+inline void ClockGenerator<Interface, MaxOutputs>::setSongPosition(unsigned inBeats)
+{
+  if (mRunning)
+  {
+    return;
+  }
+  inBeats &= 0x3fff;
+  for (byte i = 0; i < mOutputCount; ++i)
+  {
+    mOutputs[i]->sendSongPosition(inBeats);
+  }
+  mPosition = (unsigned long)inBeats * 6;
+}
+
+/*! \brief Send the ticks that are due, to all outputs.
+  Call it as often as possible, the timing accuracy depends on it.
+  \param inNowMicros  Current time in microseconds (eg: micros()).
+  \return The number of ticks sent (to each output).
+*/
+template<class Interface, unsigned MaxOutputs>
+inline unsigned ClockGenerator<Interface, MaxOutputs>::update(unsigned long inNowMicros)
+{
+  unsigned count = 0;
+  while (mRunning && long(inNowMicros - mNextTime) >= 0)
+  {
+    sendRealTime(Clock);
+    mPosition++;
+    mTickCount++;
+    count++;
+
+    mNextTime += mPeriod;
+    mFraction += mRemainder;
+    if (mFraction >= mDenominator)
+    {
+      mFraction -= mDenominator;
+      mNextTime++;
+    }
+  }
+  return count;
+}
+
+// -----------------------------------------------------------------------------
+
+template<class Interface, unsigned MaxOutputs>
+inline bool ClockGenerator<Interface, MaxOutputs>::isRunning() const
+{
+  return mRunning;
+}
+
+/*! \brief Position in MIDI beats (sixteenth notes), rounded down. */
+template<class Interface, unsigned MaxOutputs>
+inline unsigned ClockGenerator<Interface, MaxOutputs>::getSongPosition() const
+{
+  return unsigned(mPosition / 6);
+}
+
+/*! \brief Ticks sent since the last start or resume. */
+template<class Interface, unsigned MaxOutputs>
+inline unsigned long ClockGenerator<Interface, MaxOutputs>::getTickCount() const
+{
+  return mTickCount;
+}
+
+/*! \brief Time at which the next tick is due (eg: to sleep until then).
+  Only meaningful while running.
+*/
+template<class Interface, unsigned MaxOutputs>
+inline unsigned long ClockGenerator<Interface, MaxOutputs>::getNextTickTime() const
+{
+  return mNextTime;
+}
+
+// -----------------------------------------------------------------------------
+
+template<class Interface, unsigned MaxOutputs>
+inline void ClockGenerator<Interface, MaxOutputs>::setPeriod(unsigned long inNumerator,
+    unsigned long inDenominator)
+{
+  if (inDenominator == 0 || inNumerator / inDenominator == 0)
+  {
+    return;
+  }
+
+  if (mRunning && mTickCount > 0)
+  {
+    // Move the next tick to one new period after the last one.
+    mNextTime -= mPeriod;
+    mNextTime += inNumerator / inDenominator;
+  }
+  mPeriod      = inNumerator / inDenominator;
+  mRemainder   = inNumerator % inDenominator;
+  mDenominator = inDenominator;
+  mFraction    = 0;
+}
+
+template<class Interface, unsigned MaxOutputs>
+inline void ClockGenerator<Interface, MaxOutputs>::sendRealTime(MidiType inType)
+{
+  for (byte i = 0; i < mOutputCount; ++i)
+  {
+    mOutputs[i]->sendRealTime(inType);
+  }
+}
+
+END_MIDI_NAMESPACE
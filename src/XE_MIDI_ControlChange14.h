@@ -0,0 +1,120 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#pragma once
+
+#include "XE_MIDI_Defs.h"
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief State of the 14-bit Control Change pairing (see
+  Settings::Use14BitControlChange): last MSB received and sent for each
+  controller (0 to 31) on each channel, and the MSB waiting for its LSB.
+  Controllers are indexed by (channel - 1) * 32 + number.
+  When disabled, the state is empty and all calls do nothing.
+*/
+template<bool Enabled>
+class ControlChange14State
+{
+  public:
+    static const unsigned sNoPending = 0xffff;
+    static const unsigned sSize      = 16 * 32;
+
+    inline ControlChange14State()
+    {
+      reset();
+    }
+
+    inline void reset()
+    {
+      memset(mMsb_RX, 0,    sSize);
+      memset(mMsb_TX, 0xff, sSize); // Unknown: the first MSB is always sent.
+      mPending   = sNoPending;
+      mCountdown = 0;
+    }
+
+  public: // Input
+    inline byte getMsb(unsigned inIndex) const              { return mMsb_RX[inIndex]; }
+    inline void setMsb(unsigned inIndex, byte inMsb)        { mMsb_RX[inIndex] = inMsb; }
+
+    inline unsigned getPending() const                      { return mPending; }
+    inline void setPending(unsigned inIndex, unsigned inCountdown)
+    {
+      mPending   = inIndex;
+      mCountdown = inCountdown;
+    }
+    inline void clearPending()                              { mPending = sNoPending; }
+
+    /*! Counts a message received while an MSB is pending, returns true when
+      its LSB is overdue.
+    */
+    inline bool countdown()
+    {
+      return mPending != sNoPending && --mCountdown == 0;
+    }
+
+  public: // Output
+    inline bool isMsbSent(unsigned inIndex, byte inMsb) const { return mMsb_TX[inIndex] == inMsb; }
+    inline void setMsbSent(unsigned inIndex, byte inMsb)    { mMsb_TX[inIndex] = inMsb; }
+
+    /*! Any Control Change sent outside of sendControlChange14 (eg: by
+      sendControlChange, send or the Thru) makes the receiver's MSB unknown.
+    */
+    inline void onControlChangeSent(Channel inChannel, DataByte inNumber)
+    {
+      const unsigned channel = unsigned(inChannel - 1) << 5;
+      if (inNumber < 32)
+      {
+        mMsb_TX[channel | inNumber] = 0xff;
+      }
+      else if (inNumber == ResetAllControllers)
+      {
+        memset(mMsb_TX + channel, 0xff, 32);
+      }
+    }
+
+  private:
+    byte        mMsb_RX[sSize];
+    byte        mMsb_TX[sSize];
+    unsigned    mPending;
+    unsigned    mCountdown;
+};
+
+template<>
+class ControlChange14State<false>
+{
+  public:
+    static const unsigned sNoPending = 0xffff;
+
+    inline void reset() {}
+
+    inline byte getMsb(unsigned) const                      { return 0; }
+    inline void setMsb(unsigned, byte)                      {}
+    inline unsigned getPending() const                      { return sNoPending; }
+    inline void setPending(unsigned, unsigned)              {}
+    inline void clearPending()                              {}
+    inline bool countdown()                                 { return false; }
+
+    inline bool isMsbSent(unsigned, byte) const             { return false; }
+    inline void setMsbSent(unsigned, byte)                  {}
+    inline void onControlChangeSent(Channel, DataByte)      {}
+};
+
+END_MIDI_NAMESPACE
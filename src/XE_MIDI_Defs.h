@@ -25,6 +25,7 @@
 #include <Arduino.h>
 #else
 #include <inttypes.h>
+#include <string.h>
 typedef uint8_t byte;
 #endif
 
@@ -196,6 +197,24 @@ struct RPN
   };
 };
 
+/*! \brief A parameter number and its value, for RPN & NRPN batches.
+  Set current to the value the receiving device holds for this parameter when
+  it is known, so the batch can use shorter encodings (Data Increment /
+  Decrement, MSB or LSB only). Otherwise set it to ParameterValue::Unknown.
+  @see MidiInterface::sendNrpnBatch
+*/
+struct ParameterValue
+{
+  enum
+  {
+    Unknown = 0xffff,
+  };
+
+  unsigned number;  ///< 14-bit parameter number.
+  unsigned value;   ///< 14-bit value to send.
+  unsigned current; ///< 14-bit value known on the receiver, or Unknown.
+};
+
 // -----------------------------------------------------------------------------
 
 /*! \brief Create an instance of the library attached to a serial port.
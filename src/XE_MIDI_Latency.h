@@ -0,0 +1,269 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#pragma once
+
+#include "XE_MIDI_Defs.h"
+
+#if !ARDUINO
+#include <chrono>
+#endif
+
+BEGIN_MIDI_NAMESPACE
+
+// -----------------------------------------------------------------------------
+// Clocks for LatencyHistograms: now() returns a time in microseconds,
+// wrapping around is fine.
+
+#if ARDUINO
+
+/*! \brief Arduino micros() clock. */
+struct MicrosClock
+{
+  static inline unsigned long now()
+  {
+    return micros();
+  }
+};
+
+#else
+
+/*! \brief std::chrono::steady_clock, for host builds. */
+struct SteadyClock
+{
+  static inline unsigned long now()
+  {
+    typedef std::chrono::steady_clock Clock;
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+      Clock::now().time_since_epoch()).count();
+  }
+};
+
+#endif
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Histogram of durations, with log2 buckets: bucket 0 counts 0 to
+  1us, bucket n counts 2^n to 2^(n+1)-1 us, the last one everything above.
+*/
+class LatencyHistogram
+{
+  public:
+    static const byte sBucketCount = 24;
+
+    inline LatencyHistogram()
+    {
+      reset();
+    }
+
+    inline void reset()
+    {
+      memset(mBuckets, 0, sizeof(mBuckets));
+      mCount = 0;
+      mMax   = 0;
+    }
+
+    inline void add(unsigned long inMicros)
+    {
+      byte bucket = 0;
+      for (unsigned long value = inMicros >> 1; value != 0 && bucket < sBucketCount - 1; value >>= 1)
+      {
+        bucket++;
+      }
+      mBuckets[bucket]++;
+      mCount++;
+      mMax = inMicros > mMax ? inMicros : mMax;
+    }
+
+    inline unsigned long getCount() const { return mCount; }
+    inline unsigned long getMax() const { return mMax; }
+    inline unsigned long getBucket(byte inIndex) const { return mBuckets[inIndex]; }
+
+    /*! \brief Upper bound of the bucket holding the given percentile (eg: 50,
+      99), in microseconds. Capped to the maximum seen, 0 when empty.
+    */
+    inline unsigned long getPercentile(byte inPercent) const
+    {
+      // Rank of the sample, rounded up (nearest-rank method).
+      const unsigned long rank = (mCount * inPercent + 99) / 100;
+      unsigned long cumulated = 0;
+      for (byte i = 0; i < sBucketCount; ++i)
+      {
+        cumulated += mBuckets[i];
+        if (cumulated >= rank && cumulated != 0)
+        {
+          const unsigned long upper = (2UL << i) - 1;
+          return upper < mMax ? upper : mMax;
+        }
+      }
+      return mMax;
+    }
+
+  private:
+    unsigned long mBuckets[sBucketCount];
+    unsigned long mCount;
+    unsigned long mMax;
+};
+
+// -----------------------------------------------------------------------------
+// Latency policies, see DefaultSettings::Latency.
+
+/*! \brief Stages measured by LatencyHistograms. */
+struct LatencyStage
+{
+  enum Stage
+  {
+    Parse = 0,  ///< First byte of the message read -> message complete.
+    Dispatch,   ///< Message complete -> callback called.
+    Callback,   ///< Time spent in the callback.
+    Thru,       ///< First byte of the message read -> forwarded by the soft thru.
+    Count,
+  };
+};
+
+/*! \brief No latency measurement (default): costs nothing. */
+struct NoLatency
+{
+  inline void reset() {}
+
+  inline void onMessageStart() {}
+  inline void onRealTimeStart() {}
+  inline void onMessageAbort() {}
+  inline void onMessageComplete() {}
+  inline void onCallbackBegin() {}
+  inline void onCallbackEnd() {}
+  inline void onThruSent() {}
+};
+
+/*! \brief Latency histograms for each LatencyStage, timed with Clock
+  (MicrosClock on Arduino, SteadyClock on host).
+
+  Enable them with a custom Settings:
+  \code
+  struct MySettings : public midi::DefaultSettings
+  {
+    typedef midi::LatencyHistograms<midi::MicrosClock> Latency;
+  };
+  \endcode
+  then read eg: MIDI.getLatency().getHistogram(midi::LatencyStage::Thru)
+  .getPercentile(99). Uses about 400 bytes of RAM.
+  With Use1ByteParsing, the Parse stage includes the time spent in the loop
+  between read() calls, as it should. Real Time messages interleaved in
+  another message are timed from their own byte.
+*/
+template<class Clock>
+class LatencyHistograms
+{
+  public:
+    inline LatencyHistograms()
+      : mMessageStart(0)
+      , mRealTimeStart(0)
+      , mCompletedStart(0)
+      , mMessageComplete(0)
+      , mCallbackBegin(0)
+      , mPending(false)
+      , mRealTime(false)
+    {
+    }
+
+    inline void reset()
+    {
+      for (byte i = 0; i < LatencyStage::Count; ++i)
+      {
+        mHistograms[i].reset();
+      }
+    }
+
+    inline const LatencyHistogram& getHistogram(LatencyStage::Stage inStage) const
+    {
+      return mHistograms[inStage];
+    }
+
+  public: // Hooks, called by MidiInterface
+    inline void onMessageStart()
+    {
+      mMessageStart = Clock::now();
+      mPending      = true;
+    }
+    /*! Real Time byte in the middle of a pending message: its own start, the
+      one of the pending message is kept.
+    */
+    inline void onRealTimeStart()
+    {
+      mRealTimeStart = Clock::now();
+      mRealTime      = true;
+    }
+    /*! The message started last was dropped (invalid, overflow). */
+    inline void onMessageAbort()
+    {
+      if (mRealTime)
+      {
+        mRealTime = false;
+      }
+      else
+      {
+        mPending = false;
+      }
+    }
+    inline void onMessageComplete()
+    {
+      mMessageComplete = Clock::now();
+      if (mRealTime)
+      {
+        mCompletedStart = mRealTimeStart;
+        mRealTime       = false;
+      }
+      else if (mPending)
+      {
+        mCompletedStart = mMessageStart;
+        mPending        = false;
+      }
+      else
+      {
+        mCompletedStart = mMessageComplete; // Start not seen
+      }
+      mHistograms[LatencyStage::Parse].add(mMessageComplete - mCompletedStart);
+    }
+    inline void onCallbackBegin()
+    {
+      mCallbackBegin = Clock::now();
+      mHistograms[LatencyStage::Dispatch].add(mCallbackBegin - mMessageComplete);
+    }
+    inline void onCallbackEnd()
+    {
+      mHistograms[LatencyStage::Callback].add(Clock::now() - mCallbackBegin);
+    }
+    inline void onThruSent()
+    {
+      mHistograms[LatencyStage::Thru].add(Clock::now() - mCompletedStart);
+    }
+
+  private:
+    LatencyHistogram mHistograms[LatencyStage::Count];
+    unsigned long mMessageStart;    ///< Of the pending message.
+    unsigned long mRealTimeStart;   ///< Of an interleaved Real Time message.
+    unsigned long mCompletedStart;  ///< Of the message being handled.
+    unsigned long mMessageComplete;
+    unsigned long mCallbackBegin;
+    bool mPending;
+    bool mRealTime;
+};
+
+END_MIDI_NAMESPACE
@@ -0,0 +1,133 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#pragma once
+
+#include "XE_MIDI_Defs.h"
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief Playback image format: MIDI bytes ready to be sent, grouped by
+  time, made from a Standard MIDI File by extras/tools/ImageCompiler.cpp.
+
+  Tracks are merged, the tempo map is applied, Running Status too (unless
+  disabled when compiling), so playing an image is only a matter of writing
+  byte spans at the right time.
+
+  Little endian layout:
+  - header (16 bytes): "MIMG", version, flags, 2 reserved bytes, number of
+    groups (4 bytes), duration in microseconds (4 bytes),
+  - groups: delta time from the previous group in microseconds (4 bytes),
+    length (2 bytes), then the MIDI bytes,
+  - an end group, of length 0: its delta time leads to the end of the song
+    (eg: to loop on whole bars).
+*/
+struct PlaybackImage
+{
+  enum
+  {
+    Version         = 1,
+    HeaderSize      = 16,
+    GroupHeaderSize = 6,
+    MaxGroupLength  = 0xffff,
+  };
+
+  enum Flags
+  {
+    RunningStatus   = 0x01,     ///< Running Status applied to the bytes.
+  };
+
+  static inline unsigned readUInt16(const byte* inData)
+  {
+    return unsigned(inData[0]) | unsigned(inData[1]) << 8;
+  }
+
+  static inline unsigned long readUInt32(const byte* inData)
+  {
+    return (unsigned long)inData[0]       | (unsigned long)inData[1] << 8 |
+           (unsigned long)inData[2] << 16 | (unsigned long)inData[3] << 24;
+  }
+};
+
+/*! \brief Plays a playback image to a serial port.
+
+  The image is read from a Source (see XE_MIDI_Smf.h: SmfMemorySource for
+  RAM and memory mapped flash, SmfProgmemSource for AVR program memory), by
+  chunks of BufferSize bytes written straight to the port, with
+  write(const byte*, size_t) as on Arduino serial ports.
+
+  The bytes go to the port directly, not through a MidiInterface: when the
+  image uses Running Status, don't send other messages to the same port
+  (or compile it with --no-running-status).
+
+  \code{.cpp}
+  midi::SmfMemorySource source(image, sizeof(image));
+  midi::PlaybackImagePlayer<HardwareSerial, midi::SmfMemorySource> player(Serial1, source);
+
+  void setup() { Serial1.begin(31250); player.begin(); player.play(micros()); }
+  void loop()  { player.update(micros()); }
+  \endcode
+*/
+template<class SerialPort, class Source, unsigned BufferSize = 16>
+class PlaybackImagePlayer
+{
+  public:
+    inline PlaybackImagePlayer(SerialPort& ioSerial, Source& ioSource);
+
+  public:
+    inline bool begin();
+    inline void rewind();
+    inline void play(unsigned long inNowMicros);
+    inline void pause(unsigned long inNowMicros);
+    inline unsigned update(unsigned long inNowMicros);
+    inline void setLoop(bool inLoop);
+
+  public:
+    inline bool isPlaying() const;
+    inline bool isFinished() const;
+    inline byte getFlags() const;
+    inline unsigned long getGroupCount() const;
+    inline unsigned long getDuration() const;
+
+  private:
+    inline bool readGroupHeader();
+    inline void sendGroup();
+
+  private:
+    typedef char BufferSizeCheck[(BufferSize >= 1 && BufferSize <= 255) ? 1 : -1];
+
+    SerialPort&     mSerial;
+    Source&         mSource;
+    unsigned long   mOffset;        ///< Offset of the next group's bytes.
+    unsigned long   mNextTime;      ///< When it is due (clock of update), while playing.
+    unsigned long   mPausedTime;    ///< Time until then, while paused.
+    unsigned long   mGroupCount;
+    unsigned long   mDuration;
+    unsigned        mLength;        ///< Length of the next group, 0 for the end.
+    byte            mFlags;
+    bool            mValid;
+    bool            mPlaying;
+    bool            mFinished;
+    bool            mLoop;
+};
+
+END_MIDI_NAMESPACE
+
+#include "XE_MIDI_PlaybackImage.hpp"
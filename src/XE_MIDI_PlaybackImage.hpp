@@ -0,0 +1,221 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#pragma once
+
+BEGIN_MIDI_NAMESPACE
+
+template<class SerialPort, class Source, unsigned BufferSize>
+inline PlaybackImagePlayer<SerialPort, Source, BufferSize>::PlaybackImagePlayer(SerialPort& ioSerial,
+    Source& ioSource)
+  : mSerial(ioSerial)
+  , mSource(ioSource)
+  , mOffset(0)
+  , mNextTime(0)
+  , mPausedTime(0)
+  , mGroupCount(0)
+  , mDuration(0)
+  , mLength(0)
+  , mFlags(0)
+  , mValid(false)
+  , mPlaying(false)
+  , mFinished(true)
+  , mLoop(false)
+{
+}
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Check the image header and rewind.
+  \return false if the source does not hold a playback image.
+*/
+template<class SerialPort, class Source, unsigned BufferSize>
+inline bool PlaybackImagePlayer<SerialPort, Source, BufferSize>::begin()
+{
+  byte header[PlaybackImage::HeaderSize];
+  mValid = mSource.read(0, header, PlaybackImage::HeaderSize) == PlaybackImage::HeaderSize &&
+           memcmp(header, "MIMG", 4) == 0 && header[4] == PlaybackImage::Version;
+  if (mValid)
+  {
+    mFlags      = header[5];
+    mGroupCount = PlaybackImage::readUInt32(header + 8);
+    mDuration   = PlaybackImage::readUInt32(header + 12);
+  }
+  rewind();
+  return mValid;
+}
+
+/*! \brief Go back to the start of the image, and pause. */
+template<class SerialPort, class Source, unsigned BufferSize>
+inline void PlaybackImagePlayer<SerialPort, Source, BufferSize>::rewind()
+{
+  mPlaying    = false;
+  mOffset     = PlaybackImage::HeaderSize;
+  mPausedTime = 0;
+  mFinished   = !mValid || !readGroupHeader();
+}
+
+/*! \brief Start or resume playing.
+  \param inNowMicros  Current time in microseconds (eg: micros()).
+*/
+template<class SerialPort, class Source, unsigned BufferSize>
+inline void PlaybackImagePlayer<SerialPort, Source, BufferSize>::play(unsigned long inNowMicros)
+{
+  if (mPlaying || mFinished)
+  {
+    return;
+  }
+  mNextTime = inNowMicros + mPausedTime;
+  mPlaying  = true;
+}
+
+/*! \brief Pause, play resumes from the same position. */
+template<class SerialPort, class Source, unsigned BufferSize>
+inline void PlaybackImagePlayer<SerialPort, Source, BufferSize>::pause(unsigned long inNowMicros)
+{
+  if (!mPlaying)
+  {
+    return;
+  }
+  const long remaining = long(mNextTime - inNowMicros);
+  mPausedTime = remaining > 0 ? (unsigned long)remaining : 0;
+  mPlaying    = false;
+}
+
+/*! \brief Send the groups that are due.
+  \param inNowMicros  Current time in microseconds (eg: micros()).
+  \return The number of groups sent.
+*/
+template<class SerialPort, class Source, unsigned BufferSize>
+inline unsigned PlaybackImagePlayer<SerialPort, Source, BufferSize>::update(unsigned long inNowMicros)
+{
+  unsigned count = 0;
+  while (mPlaying && long(inNowMicros - mNextTime) >= 0)
+  {
+    if (mLength == 0)
+    {
+      // End of the song: the first group is scheduled from its end time,
+      // so the loop is seamless. One pass at most per call.
+      mOffset = PlaybackImage::HeaderSize;
+      if (!mLoop || mGroupCount == 0 || !readGroupHeader())
+      {
+        mPlaying  = false;
+        mFinished = true;
+      }
+      break;
+    }
+
+    sendGroup();
+    count++;
+    if (!readGroupHeader())
+    {
+      mPlaying  = false;
+      mFinished = true;
+    }
+  }
+  return count;
+}
+
+/*! \brief Start again from the beginning at the end of the image. */
+template<class SerialPort, class Source, unsigned BufferSize>
+inline void PlaybackImagePlayer<SerialPort, Source, BufferSize>::setLoop(bool inLoop)
+{
+  mLoop = inLoop;
+}
+
+// -----------------------------------------------------------------------------
+
+template<class SerialPort, class Source, unsigned BufferSize>
+inline bool PlaybackImagePlayer<SerialPort, Source, BufferSize>::isPlaying() const
+{
+  return mPlaying;
+}
+
+template<class SerialPort, class Source, unsigned BufferSize>
+inline bool PlaybackImagePlayer<SerialPort, Source, BufferSize>::isFinished() const
+{
+  return mFinished;
+}
+
+/*! \brief Image flags, see PlaybackImage::Flags. */
+template<class SerialPort, class Source, unsigned BufferSize>
+inline byte PlaybackImagePlayer<SerialPort, Source, BufferSize>::getFlags() const
+{
+  return mFlags;
+}
+
+template<class SerialPort, class Source, unsigned BufferSize>
+inline unsigned long PlaybackImagePlayer<SerialPort, Source, BufferSize>::getGroupCount() const
+{
+  return mGroupCount;
+}
+
+/*! \brief Duration of the song, in microseconds. */
+template<class SerialPort, class Source, unsigned BufferSize>
+inline unsigned long PlaybackImagePlayer<SerialPort, Source, BufferSize>::getDuration() const
+{
+  return mDuration;
+}
+
+// -----------------------------------------------------------------------------
+
+// Read the header of the group at mOffset, and schedule it.
+template<class SerialPort, class Source, unsigned BufferSize>
+inline bool PlaybackImagePlayer<SerialPort, Source, BufferSize>::readGroupHeader()
+{
+  byte header[PlaybackImage::GroupHeaderSize];
+  if (mSource.read(mOffset, header, PlaybackImage::GroupHeaderSize) != PlaybackImage::GroupHeaderSize)
+  {
+    return false;
+  }
+  mOffset  += PlaybackImage::GroupHeaderSize;
+  mLength   = PlaybackImage::readUInt16(header + 4);
+  if (mPlaying)
+  {
+    mNextTime += PlaybackImage::readUInt32(header);
+  }
+  else
+  {
+    mPausedTime += PlaybackImage::readUInt32(header);
+  }
+  return true;
+}
+
+template<class SerialPort, class Source, unsigned BufferSize>
+inline void PlaybackImagePlayer<SerialPort, Source, BufferSize>::sendGroup()
+{
+  byte buffer[BufferSize];
+  unsigned left = mLength;
+  while (left > 0)
+  {
+    const unsigned size  = left < BufferSize ? left : BufferSize;
+    const unsigned count = mSource.read(mOffset, buffer, size);
+    mSerial.write(buffer, count);
+    mOffset += size;
+    left    -= size;
+    if (count != size)
+    {
+      break;
+    }
+  }
+  mOffset += left;
+}
+
+END_MIDI_NAMESPACE
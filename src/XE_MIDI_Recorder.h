@@ -0,0 +1,497 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#pragma once
+
+#include "XE_MIDI_Defs.h"
+#include "XE_MIDI_Latency.h"
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief Sides of a MidiInterface a recorder can capture. */
+struct CaptureDirection
+{
+  enum Direction
+  {
+    Input = 0,  ///< Messages read by the interface.
+    Output,     ///< Messages sent, soft thru included.
+  };
+};
+
+/*! \brief Capture log format, shared by CaptureRecorder and CaptureReader.
+
+  The log is a sequence of blocks, each decodable on its own:
+  - 4 bytes: time of the first event, in microseconds (little endian),
+  - 1 byte: size of the block, header included,
+  - events.
+
+  Each event starts with a delta time, (microseconds since the previous
+  event of the block << 1) | direction, as little endian groups of 7 bits
+  (bit 7 set on all groups but the last), followed by the message:
+  - Channel messages use Running Status, per direction, within the block,
+  - System Common and Real Time messages are stored as they are,
+  - SysEx is stored as 0xf0, its length (without 0xf0 / 0xf7, 7-bit groups),
+    the number of bytes kept (1 byte) and these bytes: frames that don't fit
+    in a block are truncated.
+*/
+struct CaptureFormat
+{
+  static const unsigned sHeaderSize = 5;
+
+  /*! Number of data bytes following a status byte. */
+  static inline byte getDataSize(byte inStatus)
+  {
+    if (inStatus < 0xf0)
+    {
+      const byte type = inStatus & 0xf0;
+      return (type == ProgramChange || type == AfterTouchChannel) ? 1 : 2;
+    }
+    switch (inStatus)
+    {
+      case TimeCodeQuarterFrame:
+      case SongSelect:
+        return 1;
+      case SongPosition:
+        return 2;
+      default:
+        return 0;
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+// Recorder policies, see DefaultSettings::Recorder.
+
+/*! \brief No recording (default): costs nothing. */
+struct NoRecorder
+{
+  inline void record(CaptureDirection::Direction, byte, byte, byte) {}
+  inline void recordSysEx(CaptureDirection::Direction, const byte*, unsigned) {}
+};
+
+/*! \brief Sink for the blocks completed by a CaptureRecorder: none, the
+  recorder only keeps the last ones in RAM.
+  See extras/host/CaptureFile.h to write them to a file on host.
+*/
+struct NoCaptureSink
+{
+  inline void write(const byte*, unsigned) {}
+};
+
+/*! \brief Records timestamped messages in a compact binary log (see
+  CaptureFormat), kept in a ring of BlockCount blocks of BlockSize bytes.
+
+  Enable it with a custom Settings:
+  \code
+  struct MySettings : public midi::DefaultSettings
+  {
+    typedef midi::CaptureRecorder<midi::MicrosClock, 64, 8> Recorder;
+  };
+  \endcode
+  Both directions are recorded by default, see setDirections.
+  A Note On with Running Status takes 3 bytes when less than 64us apart from
+  the previous event, 4 bytes under 8ms. When the ring is full, the oldest
+  block is overwritten, unless the Sink saves it first.
+  Read the blocks (eg: to dump them as SysEx or to a file) with getBlock,
+  decode them with CaptureReader or extras/tools/Capture.cpp.
+*/
+template<class Clock, unsigned BlockSize = 64, unsigned BlockCount = 8, class Sink = NoCaptureSink>
+class CaptureRecorder
+{
+  public:
+    inline CaptureRecorder()
+      : mDirections(0x03)
+    {
+      clear();
+    }
+
+    /*! Forget all recorded events. */
+    inline void clear()
+    {
+      mCurrent        = 0;
+      mSealed         = 0;
+      mOverwriteCount = 0;
+      startBlock();
+    }
+
+    inline void setDirections(bool inInput, bool inOutput)
+    {
+      mDirections = (inInput ? 0x01 : 0) | (inOutput ? 0x02 : 0);
+    }
+
+    inline void record(CaptureDirection::Direction inDirection,
+                       byte inStatus, byte inData1, byte inData2)
+    {
+      if ((mDirections & (1 << inDirection)) == 0)
+      {
+        return;
+      }
+      if (mUsed + sMaxEventSize > BlockSize)
+      {
+        nextBlock();
+      }
+      writeDelta(inDirection);
+
+      if (inStatus < SystemExclusive)
+      {
+        if (mRunningStatus[inDirection] != inStatus)
+        {
+          mRunningStatus[inDirection] = inStatus;
+          put(inStatus);
+        }
+      }
+      else
+      {
+        if (inStatus < midi::Clock)
+        {
+          mRunningStatus[inDirection] = 0; // System Common cancels it
+        }
+        put(inStatus);
+      }
+
+      const byte size = CaptureFormat::getDataSize(inStatus);
+      if (size > 0) put(inData1 & 0x7f);
+      if (size > 1) put(inData2 & 0x7f);
+      mBlocks[mCurrent][4] = byte(mUsed);
+    }
+
+    /*! Record a SysEx frame, with or without its 0xf0 / 0xf7 boundaries.
+      inData can be null, to record the length only.
+    */
+    inline void recordSysEx(CaptureDirection::Direction inDirection,
+                            const byte* inData, unsigned inLength)
+    {
+      if ((mDirections & (1 << inDirection)) == 0)
+      {
+        return;
+      }
+      if (inData != 0 && inLength > 0 && inData[0] == 0xf0)
+      {
+        inData++;
+        inLength--;
+      }
+      if (inData != 0 && inLength > 0 && inData[inLength - 1] == 0xf7)
+      {
+        inLength--;
+      }
+      if (mUsed + sSysExOverhead + inLength > BlockSize && mUsed > CaptureFormat::sHeaderSize)
+      {
+        nextBlock();
+      }
+
+      const unsigned room = BlockSize - mUsed - sSysExOverhead;
+      const unsigned kept = inData == 0 ? 0 : (inLength < room ? inLength : room);
+
+      writeDelta(inDirection);
+      mRunningStatus[inDirection] = 0;
+      put(SystemExclusive);
+      for (unsigned long value = inLength; ; value >>= 7)
+      {
+        if (value < 0x80)
+        {
+          put(byte(value));
+          break;
+        }
+        put(byte(value | 0x80));
+      }
+      put(byte(kept));
+      if (kept > 0)
+      {
+        memcpy(mBlocks[mCurrent] + mUsed, inData, kept);
+        mUsed += kept;
+      }
+      mBlocks[mCurrent][4] = byte(mUsed);
+    }
+
+    /*! Close the current block, passing it to the Sink. */
+    inline void flush()
+    {
+      if (mUsed > CaptureFormat::sHeaderSize)
+      {
+        nextBlock();
+      }
+    }
+
+    /*! Number of blocks holding events, the last one being the current
+      (still open) block.
+    */
+    inline unsigned getBlockCount() const
+    {
+      return mSealed + (mUsed > CaptureFormat::sHeaderSize ? 1 : 0);
+    }
+
+    /*! Get a block, 0 being the oldest one. Its size is in byte 4. */
+    inline const byte* getBlock(unsigned inIndex) const
+    {
+      return mBlocks[(mCurrent + BlockCount - mSealed + inIndex) % BlockCount];
+    }
+
+    /*! Number of blocks overwritten since the last clear, as the ring was full. */
+    inline unsigned long getOverwriteCount() const
+    {
+      return mOverwriteCount;
+    }
+
+    inline Sink& getSink()
+    {
+      return mSink;
+    }
+
+  private:
+    // Delta (5 bytes at most) + status + 2 data bytes.
+    static const unsigned sMaxEventSize = 8;
+
+    // Delta (5 bytes at most) + 0xf0 + length (5 bytes at most for 32 bits)
+    // + kept count.
+    static const unsigned sSysExOverhead = 12;
+
+    // Longer deltas start a new block, to fit in 5 bytes on any platform.
+    static const unsigned long sMaxDelta = 0x7fffffffUL;
+
+    // Compile-time check: the size is stored on a byte, and a SysEx header
+    // must fit in an empty block.
+    typedef char BlockSizeMustBeFrom32To255[(BlockSize >= 32 && BlockSize <= 255) ? 1 : -1];
+
+    inline void put(byte inByte)
+    {
+      mBlocks[mCurrent][mUsed++] = inByte;
+    }
+
+    inline void writeDelta(CaptureDirection::Direction inDirection)
+    {
+      const unsigned long now = Clock::now();
+      if (mUsed > CaptureFormat::sHeaderSize && now - mLastTime > sMaxDelta)
+      {
+        nextBlock();
+      }
+      if (mUsed == CaptureFormat::sHeaderSize)
+      {
+        byte* header = mBlocks[mCurrent];
+        header[0] = byte(now);
+        header[1] = byte(now >> 8);
+        header[2] = byte(now >> 16);
+        header[3] = byte(now >> 24);
+        mLastTime = now;
+      }
+
+      unsigned long value = ((now - mLastTime) << 1) | inDirection;
+      mLastTime = now;
+      while (value >= 0x80)
+      {
+        put(byte(value | 0x80));
+        value >>= 7;
+      }
+      put(byte(value));
+    }
+
+    inline void nextBlock()
+    {
+      mSink.write(mBlocks[mCurrent], mUsed);
+      mCurrent = (mCurrent + 1) % BlockCount;
+      if (mSealed < BlockCount - 1)
+      {
+        mSealed++;
+      }
+      else
+      {
+        mOverwriteCount++;
+      }
+      startBlock();
+    }
+
+    inline void startBlock()
+    {
+      mUsed = CaptureFormat::sHeaderSize;
+      mBlocks[mCurrent][4] = byte(mUsed);
+      mRunningStatus[CaptureDirection::Input]  = 0;
+      mRunningStatus[CaptureDirection::Output] = 0;
+    }
+
+  private:
+    byte mBlocks[BlockCount][BlockSize];
+    unsigned mCurrent;          ///< Block being written.
+    unsigned mSealed;           ///< Complete blocks before it.
+    unsigned mUsed;             ///< Bytes used in the current block.
+    unsigned long mLastTime;
+    unsigned long mOverwriteCount;
+    byte mRunningStatus[2];
+    byte mDirections;
+    Sink mSink;
+};
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Decodes the events of a capture block (see CaptureFormat).
+
+  \code
+  midi::CaptureReader reader(recorder.getBlock(0));
+  midi::CaptureReader::Event event;
+  while (reader.read(event)) { ... }
+  \endcode
+*/
+class CaptureReader
+{
+  public:
+    struct Event
+    {
+      unsigned long mTime;        ///< Microseconds, 32 bits, wrapping around.
+      byte mDirection;            ///< CaptureDirection::Direction
+      byte mStatus;
+      byte mData1;
+      byte mData2;
+      unsigned mSysExLength;      ///< Length of the frame, without 0xf0 / 0xf7.
+      unsigned mSysExKept;        ///< Bytes of the frame kept in the log.
+      const byte* mSysExData;
+    };
+
+  public:
+    /*! \param inBlock  A block, its size being in byte 4.
+      \param inAvailable  Bytes readable from inBlock, to check the size against
+      (eg: when reading a file).
+    */
+    inline explicit CaptureReader(const byte* inBlock, unsigned inAvailable = 255)
+      : mBlock(inBlock)
+      , mPosition(CaptureFormat::sHeaderSize)
+      , mSize(inBlock[4])
+    {
+      if (mSize > inAvailable || mSize < CaptureFormat::sHeaderSize)
+      {
+        mSize = 0; // Invalid: nothing to read.
+      }
+      mTime = (unsigned long)inBlock[0]       | (unsigned long)inBlock[1] << 8 |
+              (unsigned long)inBlock[2] << 16 | (unsigned long)inBlock[3] << 24;
+      mRunningStatus[CaptureDirection::Input]  = 0;
+      mRunningStatus[CaptureDirection::Output] = 0;
+    }
+
+    /*! Size of the block, 0 if invalid. */
+    inline unsigned getSize() const
+    {
+      return mSize;
+    }
+
+    /*! Read the next event, returns false at the end of the block, or if
+      it is malformed.
+    */
+    inline bool read(Event& outEvent)
+    {
+      unsigned long value = 0;
+      if (!readNumber(value))
+      {
+        return false;
+      }
+      mTime = (mTime + (value >> 1)) & 0xffffffffUL;
+      const byte direction = byte(value & 1);
+
+      byte status = 0;
+      if (!readByte(status))
+      {
+        return false;
+      }
+      if (status < 0x80)
+      {
+        mPosition--; // Running Status: this is a data byte.
+        status = mRunningStatus[direction];
+        if (status == 0)
+        {
+          return false;
+        }
+      }
+      else if (status < SystemExclusive)
+      {
+        mRunningStatus[direction] = status;
+      }
+      else if (status < Clock)
+      {
+        mRunningStatus[direction] = 0;
+      }
+
+      outEvent.mTime        = mTime;
+      outEvent.mDirection   = direction;
+      outEvent.mStatus      = status;
+      outEvent.mData1       = 0;
+      outEvent.mData2       = 0;
+      outEvent.mSysExLength = 0;
+      outEvent.mSysExKept   = 0;
+      outEvent.mSysExData   = 0;
+
+      if (status == SystemExclusive)
+      {
+        unsigned long length = 0;
+        byte kept = 0;
+        if (!readNumber(length) || !readByte(kept) || mPosition + kept > mSize)
+        {
+          return false;
+        }
+        outEvent.mSysExLength = unsigned(length);
+        outEvent.mSysExKept   = kept;
+        outEvent.mSysExData   = mBlock + mPosition;
+        mPosition += kept;
+        return true;
+      }
+
+      const byte size = CaptureFormat::getDataSize(status);
+      if ((size > 0 && !readByte(outEvent.mData1)) ||
+          (size > 1 && !readByte(outEvent.mData2)))
+      {
+        return false;
+      }
+      return true;
+    }
+
+  private:
+    inline bool readByte(byte& outByte)
+    {
+      if (mPosition >= mSize)
+      {
+        return false;
+      }
+      outByte = mBlock[mPosition++];
+      return true;
+    }
+
+    inline bool readNumber(unsigned long& outValue)
+    {
+      outValue = 0;
+      for (byte shift = 0; shift < 35; shift += 7)
+      {
+        byte value = 0;
+        if (!readByte(value))
+        {
+          return false;
+        }
+        outValue |= (unsigned long)(value & 0x7f) << shift;
+        if (value < 0x80)
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+
+  private:
+    const byte* mBlock;
+    unsigned mPosition;
+    unsigned mSize;
+    unsigned long mTime;
+    byte mRunningStatus[2];
+};
+
+END_MIDI_NAMESPACE
@@ -51,4 +51,4 @@ class RingBuffer
 
 END_MIDI_NAMESPACE
 
-#include "midi_RingBuffer.hpp"
+#include "XE_MIDI_RingBuffer.hpp"
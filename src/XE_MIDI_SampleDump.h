@@ -0,0 +1,223 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include "XE_MIDI_Defs.h"
+#include "XE_MIDI_SysEx.h"
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief MIDI Sample Dump Standard (SDS) definitions.
+  SDS messages are Universal Non-Real Time SysEx: F0 7E <device> <sub-ID> ...
+*/
+struct SampleDump
+{
+  enum SubId
+  {
+    Header      = 0x01,
+    Packet      = 0x02,
+    Request     = 0x03,
+    Wait        = 0x7c,
+    Cancel      = 0x7d,
+    Nak         = 0x7e,
+    Ack         = 0x7f,
+  };
+
+  enum
+  {
+    NonRealTime     = 0x7e,
+    AllDevices      = 0x7f,
+    PacketDataSize  = 120,  ///< Data bytes in a packet.
+    PacketSize      = 127,  ///< Full packet, 0xf0 & 0xf7 included.
+    HeaderSize      = 21,   ///< Full header, 0xf0 & 0xf7 included.
+  };
+
+  /*! Number of 7-bit bytes used to transmit one sample word. */
+  static inline unsigned getBytesPerWord(byte inFormat)
+  {
+    return (inFormat + 6) / 7;
+  }
+
+  /*! Number of sample words in a data packet. */
+  static inline unsigned getWordsPerPacket(byte inFormat)
+  {
+    return PacketDataSize / getBytesPerWord(inFormat);
+  }
+};
+
+/*! \brief Description of a sample, sent before its data. */
+struct SampleDumpHeader
+{
+  unsigned      sampleNumber;   ///< 14-bit sample number.
+  byte          format;         ///< Significant bits per word, 8 to 28.
+  unsigned long period;         ///< Sample period in nanoseconds (1e9 / sample rate).
+  unsigned long length;         ///< Length in words.
+  unsigned long loopStart;      ///< Sustain loop start word.
+  unsigned long loopEnd;        ///< Sustain loop end word.
+  byte          loopType;       ///< 0: forward, 1: alternating, 0x7f: off.
+};
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Sample Dump Standard sender with windowed ACK pipelining.
+
+  Instead of waiting for the ACK of each packet (stop & wait), up to
+  WindowSize packets are kept in flight, so the link keeps busy while the
+  receiver processes and acknowledges. A NAK triggers the retransmission of
+  that packet right away, without waiting for a timeout. Packets are encoded
+  on the fly from the sample words given by the reader, no buffer is needed.
+
+  Receivers that do not answer the header within 2 seconds get the data in
+  open loop (one packet every 20ms), as specified by SDS. Late ACKs and NAKs
+  are then ignored (WAIT and CANCEL still apply). Use a WindowSize of 1
+  for receivers that only accept the next expected packet.
+
+  Feed received SysEx frames with handleSysEx, and call update from the loop:
+  \code{.cpp}
+  void handleSysEx(byte* array, unsigned size) { sender.handleSysEx(array, size, millis()); }
+  void loop() { MIDI.read(); sender.update(millis()); }
+  \endcode
+*/
+template<class Interface, unsigned WindowSize = 8>
+class SampleDumpSender
+{
+  public:
+    /*! Returns the sample word at the given index, unsigned (0 is the most
+      negative value), using the header's format significant bits.
+    */
+    typedef unsigned long (*Reader)(unsigned long inWordIndex);
+
+    enum Status
+    {
+      Idle,
+      WaitingHeaderAck,
+      Sending,
+      Done,
+      Cancelled,
+    };
+
+  public:
+    inline SampleDumpSender(Interface& ioMidi, Reader inReader, byte inDeviceId = 0);
+
+  public:
+    inline void begin(const SampleDumpHeader& inHeader, unsigned long inNowMs);
+    inline void update(unsigned long inNowMs);
+    inline bool handleSysEx(const byte* inData, unsigned inSize, unsigned long inNowMs);
+    inline void cancel();
+
+  public:
+    inline Status getStatus() const;
+    inline unsigned long getPacketCount() const;
+    inline unsigned long getSentPacketCount() const;
+    inline unsigned long getRetransmitCount() const;
+    inline void setRetryTimeout(unsigned long inTimeoutMs);
+
+  private:
+    inline void sendHeader(unsigned long inNowMs);
+    inline void sendPacket(unsigned long inPacket, unsigned long inNowMs);
+    inline void sendHandshake(byte inSubId, byte inPacket);
+    inline unsigned long getPacketOffset(byte inPacket) const;
+
+  private:
+    typedef char WindowSizeCheck[(WindowSize >= 1 && WindowSize <= 32) ? 1 : -1];
+
+    Interface&          mMidi;
+    Reader              mReader;
+    byte                mDeviceId;
+    SampleDumpHeader    mHeader;
+    Status              mStatus;
+    bool                mHandshake;
+    bool                mPaused;
+    unsigned long       mPacketCount;
+    unsigned long       mBase;          ///< Oldest packet not acknowledged.
+    unsigned long       mNext;          ///< Next packet never sent.
+    unsigned long       mAcked;         ///< Bit i: packet mBase + i acknowledged.
+    unsigned long       mPendingRetransmit; ///< Bit i: packet mBase + i to resend.
+    unsigned long       mLastProgressMs;
+    unsigned long       mLastSendMs;
+    unsigned long       mRetryTimeoutMs;
+    unsigned long       mSentPackets;
+    unsigned long       mRetransmits;
+    byte                mRetries;
+};
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Sample Dump Standard receiver, counterpart of SampleDumpSender.
+
+  Packets are checked and acknowledged as they arrive. Any packet within
+  WindowSize of the oldest missing one is accepted, even out of order (eg:
+  while a NAKed packet is being retransmitted), and its words are handed to
+  the writer with their absolute index, so no packet buffering is needed.
+  Packets skipped in the sequence are NAKed as soon as a later one arrives.
+*/
+template<class Interface, unsigned WindowSize = 8>
+class SampleDumpReceiver
+{
+  public:
+    /*! Stores a received sample word (see SampleDumpSender::Reader). */
+    typedef void (*Writer)(unsigned long inWordIndex, unsigned long inWord);
+
+    enum Status
+    {
+      Idle,
+      Receiving,
+      Done,
+      Cancelled,
+    };
+
+  public:
+    inline SampleDumpReceiver(Interface& ioMidi, Writer inWriter, byte inDeviceId = 0);
+
+  public:
+    inline void request(unsigned inSampleNumber);
+    inline bool handleSysEx(const byte* inData, unsigned inSize);
+    inline void cancel();
+
+  public:
+    inline Status getStatus() const;
+    inline const SampleDumpHeader& getHeader() const;
+    inline unsigned long getReceivedPacketCount() const;
+    inline unsigned long getNakCount() const;
+
+  private:
+    inline void parseHeader(const byte* inData);
+    inline void parsePacket(const byte* inData);
+    inline void sendHandshake(byte inSubId, byte inPacket);
+
+  private:
+    typedef char WindowSizeCheck[(WindowSize >= 1 && WindowSize <= 32) ? 1 : -1];
+
+    Interface&          mMidi;
+    Writer              mWriter;
+    byte                mDeviceId;
+    SampleDumpHeader    mHeader;
+    Status              mStatus;
+    unsigned long       mPacketCount;
+    unsigned long       mNext;          ///< Oldest packet not received.
+    unsigned long       mReceived;      ///< Bit i: packet mNext + i received.
+    unsigned long       mNaked;         ///< Bit i: packet mNext + i missing, NAK sent.
+    unsigned long       mReceivedPackets;
+    unsigned long       mNaks;
+};
+
+END_MIDI_NAMESPACE
+
+#include "XE_MIDI_SampleDump.hpp"
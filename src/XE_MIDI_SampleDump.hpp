@@ -0,0 +1,615 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+BEGIN_MIDI_NAMESPACE
+
+template<class Interface, unsigned WindowSize>
+inline SampleDumpSender<Interface, WindowSize>::SampleDumpSender(Interface& ioMidi,
+    Reader inReader,
+    byte inDeviceId)
+  : mMidi(ioMidi)
+  , mReader(inReader)
+  , mDeviceId(inDeviceId)
+  , mStatus(Idle)
+  , mHandshake(false)
+  , mPaused(false)
+  , mPacketCount(0)
+  , mBase(0)
+  , mNext(0)
+  , mAcked(0)
+  , mPendingRetransmit(0)
+  , mLastProgressMs(0)
+  , mLastSendMs(0)
+  , mRetryTimeoutMs(250)
+  , mSentPackets(0)
+  , mRetransmits(0)
+  , mRetries(0)
+{
+  memset(&mHeader, 0, sizeof(SampleDumpHeader));
+}
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Send the dump header and start the transfer.
+  \param inHeader The sample description.
+  \param inNowMs  Current time in milliseconds (eg: millis()).
+*/
+template<class Interface, unsigned WindowSize>
+inline void SampleDumpSender<Interface, WindowSize>::begin(const SampleDumpHeader& inHeader,
+    unsigned long inNowMs)
+{
+  const unsigned long wordsPerPacket = SampleDump::getWordsPerPacket(inHeader.format);
+
+  mHeader             = inHeader;
+  mPacketCount        = (inHeader.length + wordsPerPacket - 1) / wordsPerPacket;
+  mBase               = 0;
+  mNext               = 0;
+  mAcked              = 0;
+  mPendingRetransmit  = 0;
+  mSentPackets        = 0;
+  mRetransmits        = 0;
+  mRetries            = 0;
+  mHandshake          = false;
+  mPaused             = false;
+  mStatus             = WaitingHeaderAck;
+
+  sendHeader(inNowMs);
+}
+
+/*! \brief Send packets as the window and handshake allow.
+  Call it as often as possible (sends at most one packet per call).
+  \param inNowMs  Current time in milliseconds (eg: millis()).
+*/
+template<class Interface, unsigned WindowSize>
+inline void SampleDumpSender<Interface, WindowSize>::update(unsigned long inNowMs)
+{
+  if (mStatus == WaitingHeaderAck)
+  {
+    if (inNowMs - mLastSendMs < 2000)
+      return;
+
+    // No answer: the receiver does not handshake.
+    mStatus = Sending;
+    mLastSendMs = inNowMs - 20;
+  }
+
+  if (mStatus != Sending || mPaused)
+    return;
+
+  if (!mHandshake)
+  {
+    // Open loop: give the receiver 20ms to answer each packet.
+    if (mNext >= mPacketCount)
+    {
+      mStatus = Done;
+    }
+    else if (inNowMs - mLastSendMs >= 20)
+    {
+      sendPacket(mNext++, inNowMs);
+    }
+    return;
+  }
+
+  if (mBase < mNext && inNowMs - mLastProgressMs >= mRetryTimeoutMs)
+  {
+    // Oldest packet (or its ACK) got lost, send it again.
+    if (++mRetries > 10)
+    {
+      cancel();
+      return;
+    }
+    mPendingRetransmit |= 1;
+    mLastProgressMs = inNowMs;
+  }
+
+  if (mPendingRetransmit != 0)
+  {
+    unsigned long offset = 0;
+    while (!(mPendingRetransmit & (1ul << offset)))
+    {
+      offset++;
+    }
+    mPendingRetransmit &= ~(1ul << offset);
+    mRetransmits++;
+    sendPacket(mBase + offset, inNowMs);
+  }
+  else if (mNext < mPacketCount && mNext < mBase + WindowSize)
+  {
+    sendPacket(mNext++, inNowMs);
+  }
+}
+
+/*! \brief Handle a SysEx frame received from the other end.
+  \param inData   The frame, 0xf0 & 0xf7 included (as given to the SysEx callback).
+  \param inSize   The size of the frame.
+  \param inNowMs  Current time in milliseconds (eg: millis()).
+  \return True if the frame was a handshake for this transfer.
+*/
+template<class Interface, unsigned WindowSize>
+inline bool SampleDumpSender<Interface, WindowSize>::handleSysEx(const byte* inData,
+    unsigned inSize,
+    unsigned long inNowMs)
+{
+  if (inSize < 6 ||
+      inData[1] != SampleDump::NonRealTime ||
+      (inData[2] != mDeviceId && inData[2] != SampleDump::AllDevices))
+  {
+    return false;
+  }
+
+  const byte subId  = inData[3];
+  const byte packet = inData[4] & 0x7f;
+
+  if (subId < SampleDump::Wait ||
+      mStatus == Idle || mStatus == Done || mStatus == Cancelled)
+  {
+    return false;
+  }
+
+  mPaused = false;
+
+  if (mStatus == Sending && !mHandshake && (subId == SampleDump::Ack || subId == SampleDump::Nak))
+  {
+    // Late answer, after the fallback to open loop: the packets sent since
+    // are not tracked, keep going open loop.
+    return true;
+  }
+
+  switch (subId)
+  {
+    case SampleDump::Ack:
+      mHandshake = true;
+      if (mStatus == WaitingHeaderAck)
+      {
+        mStatus = Sending;
+        mLastProgressMs = inNowMs;
+      }
+      else
+      {
+        const unsigned long offset = getPacketOffset(packet);
+        if (offset < WindowSize && mBase + offset < mNext)
+        {
+          mAcked |= 1ul << offset;
+          mPendingRetransmit &= ~(1ul << offset);
+
+          while (mAcked & 1)
+          {
+            mAcked >>= 1;
+            mPendingRetransmit >>= 1;
+            mBase++;
+            mRetries = 0;
+            mLastProgressMs = inNowMs;
+          }
+          if (mBase >= mPacketCount)
+          {
+            mStatus = Done;
+          }
+        }
+      }
+      break;
+
+    case SampleDump::Nak:
+      mHandshake = true;
+      if (mStatus == WaitingHeaderAck)
+      {
+        sendHeader(inNowMs);
+      }
+      else
+      {
+        const unsigned long offset = getPacketOffset(packet);
+        if (offset < WindowSize && mBase + offset < mNext)
+        {
+          mPendingRetransmit |= 1ul << offset;
+        }
+      }
+      break;
+
+    case SampleDump::Wait:
+      // Hold on until the next message.
+      mPaused = true;
+      break;
+
+    case SampleDump::Cancel:
+      mStatus = Cancelled;
+      break;
+
+    default:
+      break;
+  }
+  return true;
+}
+
+/*! \brief Abort the transfer, and tell the receiver. */
+template<class Interface, unsigned WindowSize>
+inline void SampleDumpSender<Interface, WindowSize>::cancel()
+{
+  sendHandshake(SampleDump::Cancel, mBase & 0x7f);
+  mStatus = Cancelled;
+}
+
+// -----------------------------------------------------------------------------
+
+template<class Interface, unsigned WindowSize>
+inline typename SampleDumpSender<Interface, WindowSize>::Status SampleDumpSender<Interface, WindowSize>::getStatus() const
+{
+  return mStatus;
+}
+
+/*! \brief Number of data packets in the transfer. */
+template<class Interface, unsigned WindowSize>
+inline unsigned long SampleDumpSender<Interface, WindowSize>::getPacketCount() const
+{
+  return mPacketCount;
+}
+
+/*! \brief Number of data packets sent so far, retransmissions included. */
+template<class Interface, unsigned WindowSize>
+inline unsigned long SampleDumpSender<Interface, WindowSize>::getSentPacketCount() const
+{
+  return mSentPackets;
+}
+
+/*! \brief Number of data packets sent again after a NAK or a timeout. */
+template<class Interface, unsigned WindowSize>
+inline unsigned long SampleDumpSender<Interface, WindowSize>::getRetransmitCount() const
+{
+  return mRetransmits;
+}
+
+/*! \brief Time without acknowledgement after which the oldest packet is sent
+  again (default 250ms). It must cover the time needed to send a full window.
+*/
+template<class Interface, unsigned WindowSize>
+inline void SampleDumpSender<Interface, WindowSize>::setRetryTimeout(unsigned long inTimeoutMs)
+{
+  mRetryTimeoutMs = inTimeoutMs;
+}
+
+// -----------------------------------------------------------------------------
+
+template<class Interface, unsigned WindowSize>
+inline void SampleDumpSender<Interface, WindowSize>::sendHeader(unsigned long inNowMs)
+{
+  const byte header[SampleDump::HeaderSize - 2] = {
+    SampleDump::NonRealTime,
+    mDeviceId,
+    SampleDump::Header,
+    byte(mHeader.sampleNumber & 0x7f),
+    byte((mHeader.sampleNumber >> 7) & 0x7f),
+    mHeader.format,
+    byte(mHeader.period & 0x7f),
+    byte((mHeader.period >> 7) & 0x7f),
+    byte((mHeader.period >> 14) & 0x7f),
+    byte(mHeader.length & 0x7f),
+    byte((mHeader.length >> 7) & 0x7f),
+    byte((mHeader.length >> 14) & 0x7f),
+    byte(mHeader.loopStart & 0x7f),
+    byte((mHeader.loopStart >> 7) & 0x7f),
+    byte((mHeader.loopStart >> 14) & 0x7f),
+    byte(mHeader.loopEnd & 0x7f),
+    byte((mHeader.loopEnd >> 7) & 0x7f),
+    byte((mHeader.loopEnd >> 14) & 0x7f),
+    byte(mHeader.loopType & 0x7f),
+  };
+  mMidi.sendSysEx(sizeof(header), header);
+  mLastSendMs = inNowMs;
+}
+
+// Packets are encoded straight to the output, word by word.
+template<class Interface, unsigned WindowSize>
+inline void SampleDumpSender<Interface, WindowSize>::sendPacket(unsigned long inPacket,
+    unsigned long inNowMs)
+{
+  const unsigned bytesPerWord     = SampleDump::getBytesPerWord(mHeader.format);
+  const unsigned wordsPerPacket   = SampleDump::getWordsPerPacket(mHeader.format);
+  const unsigned justify          = 7 * bytesPerWord - mHeader.format;
+
+  XorChecksum checksum;
+  const byte head[4] = { SampleDump::NonRealTime, mDeviceId, SampleDump::Packet, byte(inPacket & 0x7f) };
+  for (byte i = 0; i < 4; ++i)
+  {
+    checksum.update(head[i]);
+  }
+
+  mMidi.beginSysEx();
+  mMidi.sendSysExData(4, head);
+
+  unsigned long index = inPacket * wordsPerPacket;
+  for (unsigned w = 0; w < wordsPerPacket; ++w, ++index)
+  {
+    const unsigned long word = index < mHeader.length ? mReader(index) << justify : 0;
+    for (unsigned b = bytesPerWord; b-- > 0; )
+    {
+      const byte data = (word >> (7 * b)) & 0x7f;
+      checksum.update(data);
+      mMidi.sendSysExData(1, &data);
+    }
+  }
+
+  const byte sum = checksum.get();
+  mMidi.sendSysExData(1, &sum);
+  mMidi.endSysEx();
+
+  mSentPackets++;
+  mLastSendMs = inNowMs;
+  if (inPacket == mBase)
+  {
+    mLastProgressMs = inNowMs;
+  }
+}
+
+template<class Interface, unsigned WindowSize>
+inline void SampleDumpSender<Interface, WindowSize>::sendHandshake(byte inSubId, byte inPacket)
+{
+  const byte message[4] = { SampleDump::NonRealTime, mDeviceId, inSubId, inPacket };
+  mMidi.sendSysEx(sizeof(message), message);
+}
+
+// Packet numbers wrap at 128: they are only unambiguous within the window,
+// answers for packets outside of it are ignored.
+template<class Interface, unsigned WindowSize>
+inline unsigned long SampleDumpSender<Interface, WindowSize>::getPacketOffset(byte inPacket) const
+{
+  return (inPacket - mBase) & 0x7f;
+}
+
+// -----------------------------------------------------------------------------
+// Receiver
+// -----------------------------------------------------------------------------
+
+template<class Interface, unsigned WindowSize>
+inline SampleDumpReceiver<Interface, WindowSize>::SampleDumpReceiver(Interface& ioMidi,
+    Writer inWriter,
+    byte inDeviceId)
+  : mMidi(ioMidi)
+  , mWriter(inWriter)
+  , mDeviceId(inDeviceId)
+  , mStatus(Idle)
+  , mPacketCount(0)
+  , mNext(0)
+  , mReceived(0)
+  , mNaked(0)
+  , mReceivedPackets(0)
+  , mNaks(0)
+{
+  memset(&mHeader, 0, sizeof(SampleDumpHeader));
+}
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Ask the other end to send a sample (Dump Request). */
+template<class Interface, unsigned WindowSize>
+inline void SampleDumpReceiver<Interface, WindowSize>::request(unsigned inSampleNumber)
+{
+  const byte message[5] = {
+    SampleDump::NonRealTime,
+    mDeviceId,
+    SampleDump::Request,
+    byte(inSampleNumber & 0x7f),
+    byte((inSampleNumber >> 7) & 0x7f),
+  };
+  mMidi.sendSysEx(sizeof(message), message);
+}
+
+/*! \brief Handle a SysEx frame received from the sender.
+  \param inData   The frame, 0xf0 & 0xf7 included (as given to the SysEx callback).
+  \param inSize   The size of the frame.
+  \return True if the frame was a header or packet for this receiver.
+*/
+template<class Interface, unsigned WindowSize>
+inline bool SampleDumpReceiver<Interface, WindowSize>::handleSysEx(const byte* inData,
+    unsigned inSize)
+{
+  if (inSize < 6 ||
+      inData[1] != SampleDump::NonRealTime ||
+      (inData[2] != mDeviceId && inData[2] != SampleDump::AllDevices))
+  {
+    return false;
+  }
+
+  switch (inData[3])
+  {
+    case SampleDump::Header:
+      if (inSize != SampleDump::HeaderSize)
+        return false;
+      parseHeader(inData);
+      return true;
+
+    case SampleDump::Packet:
+      if (inSize != SampleDump::PacketSize || mStatus != Receiving)
+        return false;
+      parsePacket(inData);
+      return true;
+
+    case SampleDump::Cancel:
+      if (mStatus == Receiving)
+        mStatus = Cancelled;
+      return true;
+
+    default:
+      break;
+  }
+  return false;
+}
+
+/*! \brief Abort the transfer, and tell the sender. */
+template<class Interface, unsigned WindowSize>
+inline void SampleDumpReceiver<Interface, WindowSize>::cancel()
+{
+  sendHandshake(SampleDump::Cancel, mNext & 0x7f);
+  mStatus = Cancelled;
+}
+
+// -----------------------------------------------------------------------------
+
+template<class Interface, unsigned WindowSize>
+inline typename SampleDumpReceiver<Interface, WindowSize>::Status SampleDumpReceiver<Interface, WindowSize>::getStatus() const
+{
+  return mStatus;
+}
+
+template<class Interface, unsigned WindowSize>
+inline const SampleDumpHeader& SampleDumpReceiver<Interface, WindowSize>::getHeader() const
+{
+  return mHeader;
+}
+
+/*! \brief Number of valid data packets received, duplicates excluded. */
+template<class Interface, unsigned WindowSize>
+inline unsigned long SampleDumpReceiver<Interface, WindowSize>::getReceivedPacketCount() const
+{
+  return mReceivedPackets;
+}
+
+/*! \brief Number of NAKs sent: packets with a checksum error, or missing
+  from the sequence.
+*/
+template<class Interface, unsigned WindowSize>
+inline unsigned long SampleDumpReceiver<Interface, WindowSize>::getNakCount() const
+{
+  return mNaks;
+}
+
+// -----------------------------------------------------------------------------
+
+template<class Interface, unsigned WindowSize>
+inline void SampleDumpReceiver<Interface, WindowSize>::parseHeader(const byte* inData)
+{
+  mHeader.sampleNumber  = unsigned(inData[4]) | unsigned(inData[5]) << 7;
+  mHeader.format        = inData[6];
+  mHeader.period        = inData[7]  | (unsigned long)inData[8]  << 7 | (unsigned long)inData[9]  << 14;
+  mHeader.length        = inData[10] | (unsigned long)inData[11] << 7 | (unsigned long)inData[12] << 14;
+  mHeader.loopStart     = inData[13] | (unsigned long)inData[14] << 7 | (unsigned long)inData[15] << 14;
+  mHeader.loopEnd       = inData[16] | (unsigned long)inData[17] << 7 | (unsigned long)inData[18] << 14;
+  mHeader.loopType      = inData[19];
+
+  if (mHeader.format < 8 || mHeader.format > 28)
+  {
+    sendHandshake(SampleDump::Cancel, 0);
+    mStatus = Cancelled;
+    return;
+  }
+
+  const unsigned long wordsPerPacket = SampleDump::getWordsPerPacket(mHeader.format);
+  mPacketCount      = (mHeader.length + wordsPerPacket - 1) / wordsPerPacket;
+  mNext             = 0;
+  mReceived         = 0;
+  mNaked            = 0;
+  mReceivedPackets  = 0;
+  mNaks             = 0;
+  mStatus           = mPacketCount != 0 ? Receiving : Done;
+
+  sendHandshake(SampleDump::Ack, 0);
+}
+
+template<class Interface, unsigned WindowSize>
+inline void SampleDumpReceiver<Interface, WindowSize>::parsePacket(const byte* inData)
+{
+  const byte packet = inData[4];
+
+  XorChecksum checksum;
+  for (unsigned i = 1; i < SampleDump::PacketSize - 2; ++i)
+  {
+    checksum.update(inData[i]);
+  }
+  const unsigned long offset = (packet - mNext) & 0x7f;
+  if (checksum.get() != inData[SampleDump::PacketSize - 2])
+  {
+    if (offset < WindowSize)
+    {
+      mNaked |= 1ul << offset;
+    }
+    mNaks++;
+    sendHandshake(SampleDump::Nak, packet);
+    return;
+  }
+
+  if (offset >= 0x40)
+  {
+    // Behind the window: already received (its ACK got lost), acknowledge
+    // again.
+    sendHandshake(SampleDump::Ack, packet);
+    return;
+  }
+
+  // Packets skipped before this one got lost: ask for them right away,
+  // rather than waiting for the sender to time out. Once each.
+  for (unsigned long i = 0; i < offset && i < WindowSize && mNext + i < mPacketCount; ++i)
+  {
+    const unsigned long bit = 1ul << i;
+    if (!((mReceived | mNaked) & bit))
+    {
+      mNaked |= bit;
+      mNaks++;
+      sendHandshake(SampleDump::Nak, byte((mNext + i) & 0x7f));
+    }
+  }
+
+  if (offset >= WindowSize || mNext + offset >= mPacketCount)
+  {
+    return; // Ahead of the window: dropped, the sender will send it again.
+  }
+
+  if (!(mReceived & (1ul << offset)))
+  {
+    const unsigned bytesPerWord     = SampleDump::getBytesPerWord(mHeader.format);
+    const unsigned wordsPerPacket   = SampleDump::getWordsPerPacket(mHeader.format);
+    const unsigned justify          = 7 * bytesPerWord - mHeader.format;
+
+    const byte* data = inData + 5;
+    unsigned long index = (mNext + offset) * wordsPerPacket;
+    for (unsigned w = 0; w < wordsPerPacket && index < mHeader.length; ++w, ++index)
+    {
+      unsigned long word = 0;
+      for (unsigned b = 0; b < bytesPerWord; ++b)
+      {
+        word = (word << 7) | *data++;
+      }
+      mWriter(index, word >> justify);
+    }
+
+    mReceivedPackets++;
+    mReceived |= 1ul << offset;
+    while (mReceived & 1)
+    {
+      mReceived >>= 1;
+      mNaked    >>= 1;
+      mNext++;
+    }
+  }
+  // Else: already received (its ACK got lost), acknowledge again.
+
+  sendHandshake(SampleDump::Ack, packet);
+
+  if (mNext >= mPacketCount)
+  {
+    mStatus = Done;
+  }
+}
+
+template<class Interface, unsigned WindowSize>
+inline void SampleDumpReceiver<Interface, WindowSize>::sendHandshake(byte inSubId, byte inPacket)
+{
+  const byte message[4] = { SampleDump::NonRealTime, mDeviceId, inSubId, inPacket };
+  mMidi.sendSysEx(sizeof(message), message);
+}
+
+END_MIDI_NAMESPACE
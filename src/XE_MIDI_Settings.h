@@ -20,6 +20,11 @@
 #pragma once
 
 #include "XE_MIDI_Defs.h"
+#include "XE_MIDI_SysEx.h"
+#include "XE_MIDI_Statistics.h"
+#include "XE_MIDI_Latency.h"
+#include "XE_MIDI_Trace.h"
+#include "XE_MIDI_Recorder.h"
 
 BEGIN_MIDI_NAMESPACE
 
@@ -68,6 +73,65 @@ struct DefaultSettings
     to receive SysEx, or adjust accordingly.
   */
   static const unsigned SysExMaxSize = 128;
+
+  /*! Decode paired Control Change messages (MSB on CC 0 to 31, LSB on CC 32
+    to 63) into 14-bit values, reported with setHandleControlChange14, and let
+    sendControlChange14 skip sending an unchanged MSB.\n
+    Costs 1kB of RAM to remember the last MSB received and sent for each
+    controller on each channel.
+  */
+  static const bool Use14BitControlChange = false;
+
+  /*! Number of messages (Real Time excluded) within which a 14-bit Control
+    Change LSB must follow its MSB. When it does not, the MSB is reported alone
+    with a null LSB. As nothing may follow the last MSB of a burst, call
+    MIDI.flushControlChange14() when the input is idle to report it.\n
+    Set to 0 to report the MSB as soon as it is received (with a null LSB), then
+    the full value again when the LSB arrives.
+  */
+  static const unsigned ControlChange14LsbTimeout = 1;
+
+  /*! Checksum policy for SysEx frames: computed while receiving (check it with
+    isSysExChecksumValid) and while streaming frames out (send it with
+    sendSysExChecksum), without another pass over the data.\n
+    See XE_MIDI_SysEx.h for available policies: RolandChecksum, XorChecksum,
+    Crc7Checksum. The received checksum is expected as the last byte before 0xf7.
+  */
+  typedef NoChecksum SysExChecksum;
+
+  /*! Position of the first SysEx byte covered by the checksum, 0xf0 being at
+    position 0. Eg: 5 for Roland DT1 (F0 41 dev model 12 [address data] sum F7).
+  */
+  static const unsigned SysExChecksumOffset = 1;
+
+  /*! Statistics policy: counters of bytes, messages per type, parse errors,
+    SysEx overflows and Running Status hits, read with
+    MidiInterface::getStatistics.\n
+    Use MidiStatistics to enable them, the default NoStatistics costs nothing.
+  */
+  typedef NoStatistics Statistics;
+
+  /*! Latency policy: histograms of the time from the first byte of a message
+    to its completion, to its callback and to the soft thru output, read with
+    MidiInterface::getLatency.\n
+    Use LatencyHistograms<MicrosClock> (LatencyHistograms<SteadyClock> on host)
+    to enable them, the default NoLatency costs nothing.
+  */
+  typedef NoLatency Latency;
+
+  /*! Tracer policy: records begin / end events for parsing, callback
+    dispatch, soft thru and sending, read with MidiInterface::getTracer.\n
+    Use TraceRing<MicrosClock> (TraceRing<SteadyClock> on host) to enable it,
+    the default NoTracer costs nothing.
+  */
+  typedef NoTracer Tracer;
+
+  /*! Recorder policy: timestamped log of the messages received and / or
+    sent, in a compact binary format, read with MidiInterface::getRecorder.\n
+    Use CaptureRecorder<MicrosClock> (CaptureRecorder<SteadyClock> on host)
+    to enable it, the default NoRecorder costs nothing.
+  */
+  typedef NoRecorder Recorder;
 };
 
 END_MIDI_NAMESPACE
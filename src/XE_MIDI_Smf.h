@@ -0,0 +1,197 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#pragma once
+
+#include "XE_MIDI_Defs.h"
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief Standard MIDI File (SMF) definitions. */
+struct Smf
+{
+  enum MetaType
+  {
+    SequenceNumber  = 0x00,
+    Text            = 0x01,
+    TrackName       = 0x03,
+    EndOfTrack      = 0x2f,
+    Tempo           = 0x51,
+    SmpteOffset     = 0x54,
+    TimeSignature   = 0x58,
+    KeySignature    = 0x59,
+  };
+
+  enum
+  {
+    Meta            = 0xff,     ///< Status of meta events (FF <type> <length> <data>).
+    Escape          = 0xf7,     ///< SysEx continuation, or escaped bytes.
+    HeaderSize      = 14,       ///< MThd chunk, its 8-byte chunk header included.
+    ChunkHeaderSize = 8,        ///< Chunk ID and length.
+    DefaultTempo    = 500000,   ///< Microseconds per quarter note (120 BPM).
+  };
+
+  static inline unsigned readUInt16(const byte* inData)
+  {
+    return unsigned(inData[0]) << 8 | inData[1];
+  }
+
+  static inline unsigned long readUInt32(const byte* inData)
+  {
+    return (unsigned long)inData[0] << 24 | (unsigned long)inData[1] << 16 |
+           (unsigned long)inData[2] << 8  | (unsigned long)inData[3];
+  }
+
+  static inline bool isChunk(const byte* inData, const char* inId)
+  {
+    return memcmp(inData, inId, 4) == 0;
+  }
+
+  /*! Number of data bytes following a status byte (SysEx excluded). */
+  static inline byte getDataSize(byte inStatus)
+  {
+    if (inStatus >= 0xf0)
+    {
+      return inStatus == SongPosition ? 2
+           : (inStatus == TimeCodeQuarterFrame || inStatus == SongSelect) ? 1 : 0;
+    }
+    const byte type = inStatus & 0xf0;
+    return (type == ProgramChange || type == AfterTouchChannel) ? 1 : 2;
+  }
+};
+
+// -----------------------------------------------------------------------------
+// Sources for SmfPlayer & co: random access readers,
+//   unsigned read(unsigned long inOffset, byte* outData, unsigned inSize);
+// returning the number of bytes read. Eg, for an SD card file:
+//   unsigned read(unsigned long inOffset, byte* outData, unsigned inSize)
+//   { mFile.seek(inOffset); return mFile.read(outData, inSize); }
+
+/*! \brief Source reading a file from memory: RAM, memory mapped flash, or a
+  memory mapped file on host (see extras/host/MappedFile.h).
+*/
+class SmfMemorySource
+{
+  public:
+    inline SmfMemorySource(const byte* inData, unsigned long inSize)
+      : mData(inData)
+      , mSize(inSize)
+    {
+    }
+
+    inline unsigned read(unsigned long inOffset, byte* outData, unsigned inSize) const
+    {
+      if (inOffset >= mSize)
+      {
+        return 0;
+      }
+      if (inSize > mSize - inOffset)
+      {
+        inSize = unsigned(mSize - inOffset);
+      }
+      memcpy(outData, mData + inOffset, inSize);
+      return inSize;
+    }
+
+  private:
+    const byte* mData;
+    unsigned long mSize;
+};
+
+#if defined(__AVR__)
+
+/*! \brief Source reading a file from program memory (PROGMEM) on AVR. */
+class SmfProgmemSource
+{
+  public:
+    inline SmfProgmemSource(const byte* inData, unsigned long inSize)
+      : mData(inData)
+      , mSize(inSize)
+    {
+    }
+
+    inline unsigned read(unsigned long inOffset, byte* outData, unsigned inSize) const
+    {
+      if (inOffset >= mSize)
+      {
+        return 0;
+      }
+      if (inSize > mSize - inOffset)
+      {
+        inSize = unsigned(mSize - inOffset);
+      }
+      memcpy_P(outData, mData + inOffset, inSize);
+      return inSize;
+    }
+
+  private:
+    const byte* mData;
+    unsigned long mSize;
+};
+
+#endif
+
+// -----------------------------------------------------------------------------
+// Sinks for SmfWriter: random access writers,
+//   unsigned write(unsigned long inOffset, const byte* inData, unsigned inSize);
+// returning the number of bytes written. Writes are sequential, except for
+// the track length, written back at the end. Eg, for an SD card file:
+//   unsigned write(unsigned long inOffset, const byte* inData, unsigned inSize)
+//   { mFile.seek(inOffset); return mFile.write(inData, inSize); }
+
+/*! \brief Sink writing a file to a memory buffer. */
+class SmfMemorySink
+{
+  public:
+    inline SmfMemorySink(byte* outData, unsigned long inCapacity)
+      : mData(outData)
+      , mCapacity(inCapacity)
+      , mSize(0)
+    {
+    }
+
+    inline unsigned write(unsigned long inOffset, const byte* inData, unsigned inSize)
+    {
+      if (inOffset >= mCapacity)
+      {
+        return 0;
+      }
+      if (inSize > mCapacity - inOffset)
+      {
+        inSize = unsigned(mCapacity - inOffset);
+      }
+      memcpy(mData + inOffset, inData, inSize);
+      mSize = inOffset + inSize > mSize ? inOffset + inSize : mSize;
+      return inSize;
+    }
+
+    /*! Size of the file written. */
+    inline unsigned long getSize() const
+    {
+      return mSize;
+    }
+
+  private:
+    byte* mData;
+    unsigned long mCapacity;
+    unsigned long mSize;
+};
+
+END_MIDI_NAMESPACE
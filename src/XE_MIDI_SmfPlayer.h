@@ -0,0 +1,151 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#pragma once
+
+#include "XE_MIDI_Defs.h"
+#include "XE_MIDI_Smf.h"
+#include "XE_MIDI_SmfSeekIndex.h"
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief Streaming Standard MIDI File player.
+
+  Plays type 0 and 1 files (the first track of type 2 files) without loading
+  them: each track is read through a window of WindowSize bytes, refilled
+  from the Source (see XE_MIDI_Smf.h) as it is consumed. Tracks are merged
+  in time order with a min-heap of their next event, and the tempo map is
+  followed as tempo events are met, so the RAM used is about
+  (WindowSize + 16) bytes per track, whatever the file size.
+
+  Channel messages, SysEx (divided SysEx included) and the System Common and
+  Real Time messages of escape events are sent to the interface. Meta events
+  other than tempo changes and end of track are skipped.
+
+  With a seek index (see XE_MIDI_SmfSeekIndex.h), seek jumps to a Song
+  Position Pointer position without scanning the file, and restores the
+  controllers, programs and held notes there. To follow a sequencer:
+  \code{.cpp}
+  void handleSongPosition(unsigned beats) { player.seek(index, beats, micros()); }
+  void handleContinue()                   { player.play(micros()); }
+  void handleStop()                       { player.pause(micros()); }
+  \endcode
+
+  \code{.cpp}
+  midi::SmfMemorySource source(data, size);
+  midi::SmfPlayer<MidiInterfaceType, midi::SmfMemorySource> player(MIDI, source);
+
+  void setup() { player.begin(); player.play(micros()); }
+  void loop()  { player.update(micros()); }
+  \endcode
+*/
+template<class Interface, class Source, unsigned MaxTracks = 16, unsigned WindowSize = 16>
+class SmfPlayer
+{
+  public:
+    inline SmfPlayer(Interface& ioMidi, Source& ioSource);
+
+  public:
+    inline bool begin();
+    inline void rewind();
+    inline void play(unsigned long inNowMicros);
+    inline void pause(unsigned long inNowMicros);
+    inline unsigned update(unsigned long inNowMicros);
+    template<class IndexSource>
+    inline bool seek(IndexSource& ioIndex, unsigned inBeats, unsigned long inNowMicros);
+    template<class Sink>
+    inline bool writeSeekIndex(Sink& ioSink, unsigned inInterval = SmfSeekIndex::DefaultInterval);
+
+  public:
+    inline bool isPlaying() const;
+    inline bool isFinished() const;
+    inline unsigned getFormat() const;
+    inline unsigned getTrackCount() const;
+    inline unsigned getDivision() const;
+    inline unsigned long getTempo() const;
+    inline unsigned long getTick() const;
+    inline unsigned long getNextEventTime() const;
+    inline unsigned long getEventCount() const;
+
+  private:
+    struct Track
+    {
+      unsigned long mBegin;     ///< Source offset of the first event.
+      unsigned long mEnd;       ///< Source offset of the end of the chunk.
+      unsigned long mOffset;    ///< Source offset of the byte after the window.
+      unsigned long mTick;      ///< Time of the next event.
+      byte mWindow[WindowSize];
+      byte mPosition;           ///< Read position in the window.
+      byte mLength;             ///< Bytes in the window.
+      byte mRunningStatus;
+      bool mInSysEx;            ///< Inside a divided SysEx, until its 0xf7.
+    };
+
+  private:
+    inline bool refill(Track& ioTrack);
+    inline bool readByte(Track& ioTrack, byte& outByte);
+    inline bool readNumber(Track& ioTrack, unsigned long& outValue);
+    inline void skip(Track& ioTrack, unsigned long inLength);
+    inline bool readDelta(Track& ioTrack);
+    template<class Target> inline void playNext(Target& ioTarget);
+    template<class Target> inline void forward(unsigned long inTick, Target& ioTarget);
+    template<class Target> inline bool dispatch(Track& ioTrack, Target& ioTarget);
+    template<class Target> inline void sendSysExData(Track& ioTrack, unsigned long inLength, Target& ioTarget);
+    template<class Target> inline void sendEscaped(Track& ioTrack, unsigned long inLength, Target& ioTarget);
+    template<class Target> inline void closeSysEx(Target& ioTarget);
+    inline void skipSysExData(Track& ioTrack, unsigned long inLength);
+    template<class IndexSource> inline bool sendSnapshot(IndexSource& ioIndex, unsigned long inOffset);
+    inline void setTempo(unsigned long inTick, unsigned long inTempo);
+    inline unsigned long getDueTick(unsigned long inNowMicros);
+    inline unsigned long getBeatTick(unsigned long inBeats) const;
+
+  private:
+    inline bool isBefore(byte inTrackA, byte inTrackB) const;
+    inline void siftUp(byte inIndex);
+    inline void siftDown(byte inIndex);
+
+  private:
+    typedef char MaxTracksCheck[(MaxTracks >= 1 && MaxTracks <= 255) ? 1 : -1];
+    typedef char WindowSizeCheck[(WindowSize >= 4 && WindowSize <= 255) ? 1 : -1];
+
+    static const byte sNoTrack = 0xff;
+
+    Interface&      mMidi;
+    Source&         mSource;
+    Track           mTracks[MaxTracks];
+    byte            mHeap[MaxTracks];   ///< Tracks with events left, by next event.
+    byte            mHeapSize;
+    byte            mTrackCount;
+    byte            mFormat;
+    unsigned        mDivision;          ///< As in the header.
+    bool            mPlaying;
+    byte            mSysExTrack;        ///< Track of the SysEx frame open on the output, or sNoTrack.
+    unsigned long   mDivisor;           ///< Ticks per quarter note (or per second with SMPTE).
+    unsigned long   mTempo;             ///< Microseconds per quarter note (or per second).
+    unsigned long   mAnchorTick;        ///< Tick of the last tempo change.
+    unsigned long   mAnchorTime;        ///< Its time (clock of update), while playing.
+    unsigned long   mPausedTime;        ///< Time from the anchor, while paused.
+    unsigned long   mTick;
+    unsigned long   mEventCount;
+};
+
+END_MIDI_NAMESPACE
+
+#include "XE_MIDI_SmfPlayer.hpp"
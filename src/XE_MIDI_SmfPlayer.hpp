@@ -0,0 +1,928 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#pragma once
+
+BEGIN_MIDI_NAMESPACE
+
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+inline SmfPlayer<Interface, Source, MaxTracks, WindowSize>::SmfPlayer(Interface& ioMidi,
+    Source& ioSource)
+  : mMidi(ioMidi)
+  , mSource(ioSource)
+  , mHeapSize(0)
+  , mTrackCount(0)
+  , mFormat(0)
+  , mDivision(0)
+  , mPlaying(false)
+  , mSysExTrack(sNoTrack)
+  , mDivisor(1)
+  , mTempo(Smf::DefaultTempo)
+  , mAnchorTick(0)
+  , mAnchorTime(0)
+  , mPausedTime(0)
+  , mTick(0)
+  , mEventCount(0)
+{
+}
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Read the file header, locate the tracks and rewind.
+  \return false if the file is not a valid SMF, or has no track.
+  Tracks after the first MaxTracks ones are ignored.
+*/
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+inline bool SmfPlayer<Interface, Source, MaxTracks, WindowSize>::begin()
+{
+  mTrackCount = 0;
+  mHeapSize   = 0;
+
+  byte header[Smf::HeaderSize];
+  if (mSource.read(0, header, Smf::HeaderSize) != Smf::HeaderSize ||
+      !Smf::isChunk(header, "MThd") || Smf::readUInt32(header + 4) < 6)
+  {
+    return false;
+  }
+
+  mFormat   = byte(Smf::readUInt16(header + 8));
+  mDivision = Smf::readUInt16(header + 12);
+  if ((mDivision & 0x7fff) == 0)
+  {
+    return false;
+  }
+
+  const unsigned count = Smf::readUInt16(header + 10);
+  unsigned long offset = Smf::ChunkHeaderSize + Smf::readUInt32(header + 4);
+  while (mTrackCount < MaxTracks && mTrackCount < count)
+  {
+    byte chunk[Smf::ChunkHeaderSize];
+    if (mSource.read(offset, chunk, Smf::ChunkHeaderSize) != Smf::ChunkHeaderSize)
+    {
+      break;
+    }
+    const unsigned long length = Smf::readUInt32(chunk + 4);
+    if (Smf::isChunk(chunk, "MTrk"))
+    {
+      Track& track = mTracks[mTrackCount++];
+      track.mBegin = offset + Smf::ChunkHeaderSize;
+      track.mEnd   = track.mBegin + length;
+    }
+    offset += Smf::ChunkHeaderSize + length;
+  }
+
+  if (mFormat == 2 && mTrackCount > 1)
+  {
+    mTrackCount = 1; // Independent patterns: play the first one.
+  }
+
+  rewind();
+  return mTrackCount > 0;
+}
+
+/*! \brief Go back to the start of the file, and pause.
+  A SysEx frame left open is terminated, held notes are not released.
+*/
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+inline void SmfPlayer<Interface, Source, MaxTracks, WindowSize>::rewind()
+{
+  closeSysEx(mMidi);
+
+  if (mDivision & 0x8000)
+  {
+    // SMPTE: frames per second (negative) and ticks per frame, 29 being
+    // 30 frames drop-frame (29.97 fps).
+    const byte framesPerSecond = byte(256 - (mDivision >> 8));
+    mDivisor = (unsigned long)(framesPerSecond == 29 ? 30 : framesPerSecond) * (mDivision & 0xff);
+    mTempo   = framesPerSecond == 29 ? 1001000UL : 1000000UL;
+  }
+  else
+  {
+    mDivisor = mDivision;
+    mTempo   = Smf::DefaultTempo;
+  }
+
+  mPlaying    = false;
+  mAnchorTick = 0;
+  mAnchorTime = 0;
+  mPausedTime = 0;
+  mTick       = 0;
+  mEventCount = 0;
+  mHeapSize   = 0;
+
+  for (byte i = 0; i < mTrackCount; ++i)
+  {
+    Track& track         = mTracks[i];
+    track.mOffset        = track.mBegin;
+    track.mTick          = 0;
+    track.mPosition      = 0;
+    track.mLength        = 0;
+    track.mRunningStatus = 0;
+    track.mInSysEx       = false;
+
+    if (readDelta(track))
+    {
+      mHeap[mHeapSize] = i;
+      siftUp(mHeapSize++);
+    }
+  }
+}
+
+/*! \brief Start or resume playing.
+  \param inNowMicros  Current time in microseconds (eg: micros()).
+*/
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+inline void SmfPlayer<Interface, Source, MaxTracks, WindowSize>::play(unsigned long inNowMicros)
+{
+  if (mPlaying || mHeapSize == 0)
+  {
+    return;
+  }
+  mAnchorTime = inNowMicros - mPausedTime;
+  mPlaying   = true;
+}
+
+/*! \brief Pause, play resumes from the same position.
+  Held notes are not released.
+*/
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+inline void SmfPlayer<Interface, Source, MaxTracks, WindowSize>::pause(unsigned long inNowMicros)
+{
+  if (!mPlaying)
+  {
+    return;
+  }
+  mPausedTime = inNowMicros - mAnchorTime;
+  mPlaying    = false;
+}
+
+/*! \brief Send the events that are due.
+  Call it as often as possible, the timing accuracy depends on it.
+  \param inNowMicros  Current time in microseconds (eg: micros()).
+  \return The number of events processed.
+*/
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+inline unsigned SmfPlayer<Interface, Source, MaxTracks, WindowSize>::update(unsigned long inNowMicros)
+{
+  if (!mPlaying)
+  {
+    return 0;
+  }
+
+  // Compare ticks rather than times: a single division per call, and per
+  // tempo change.
+  unsigned long dueTick = getDueTick(inNowMicros);
+  unsigned count = 0;
+
+  while (mHeapSize > 0 && mTracks[mHeap[0]].mTick <= dueTick)
+  {
+    const unsigned long tempo = mTempo;
+    playNext(mMidi);
+    count++;
+
+    if (mTempo != tempo)
+    {
+      dueTick = getDueTick(inNowMicros);
+    }
+  }
+
+  mEventCount += count;
+  if (mHeapSize == 0)
+  {
+    mPlaying = false;
+  }
+  return count;
+}
+
+/*! \brief Jump to a Song Position Pointer position, using a seek index made
+  from the same file (see writeSeekIndex).
+
+  Notes are released and controllers reset (All Notes Off and Reset All
+  Controllers on the channels of the file), then the chase snapshot of the
+  closest index entry before the position is sent, then the events up to
+  the position, and last the notes started since that entry and still
+  held at the position (16 at most, see SmfChaseFilter).\n
+  Play continues from the position, the playing state is kept.
+  \param inBeats     Position in MIDI beats (sixteenth notes), as in Song
+                     Position Pointer messages.
+  \param inNowMicros Current time in microseconds (eg: micros()).
+  \return false if the index does not match the file (the position is kept).
+*/
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+template<class IndexSource>
+inline bool SmfPlayer<Interface, Source, MaxTracks, WindowSize>::seek(IndexSource& ioIndex,
+    unsigned inBeats, unsigned long inNowMicros)
+{
+  byte header[SmfSeekIndex::HeaderSize];
+  if (mTrackCount == 0 || (mDivision & 0x8000) ||
+      ioIndex.read(0, header, SmfSeekIndex::HeaderSize) != SmfSeekIndex::HeaderSize ||
+      !Smf::isChunk(header, "MSIX") || header[4] != SmfSeekIndex::Version ||
+      header[5] != mTrackCount)
+  {
+    return false;
+  }
+
+  const unsigned interval        = Smf::readUInt16(header + 6);
+  const unsigned long entryCount = Smf::readUInt32(header + 8);
+  const unsigned channelMask     = Smf::readUInt16(header + 12);
+  if (interval == 0 || entryCount == 0)
+  {
+    return false;
+  }
+
+  // Entries are evenly spaced: the one to start from is found directly.
+  unsigned long entry = inBeats / interval;
+  entry = entry < entryCount ? entry : entryCount - 1;
+  unsigned long offset = SmfSeekIndex::HeaderSize + entry * SmfSeekIndex::getEntrySize(mTrackCount);
+
+  byte data[SmfSeekIndex::EntrySize];
+  if (ioIndex.read(offset, data, SmfSeekIndex::EntrySize) != SmfSeekIndex::EntrySize)
+  {
+    return false;
+  }
+  offset += SmfSeekIndex::EntrySize;
+
+  closeSysEx(mMidi);
+  for (byte channel = 0; channel < 16; ++channel)
+  {
+    if (channelMask & (1u << channel))
+    {
+      mMidi.send(ControlChange, AllNotesOff, 0, Channel(channel + 1));
+      mMidi.send(ControlChange, ResetAllControllers, 0, Channel(channel + 1));
+    }
+  }
+
+  mHeapSize = 0;
+  for (byte i = 0; i < mTrackCount; ++i)
+  {
+    byte state[SmfSeekIndex::TrackStateSize];
+    if (ioIndex.read(offset, state, SmfSeekIndex::TrackStateSize) != SmfSeekIndex::TrackStateSize)
+    {
+      rewind();
+      return false;
+    }
+    offset += SmfSeekIndex::TrackStateSize;
+
+    Track& track         = mTracks[i];
+    track.mOffset        = Smf::readUInt32(state);
+    track.mTick          = Smf::readUInt32(state + 4);
+    track.mRunningStatus = state[8];
+    track.mInSysEx       = false;
+    track.mPosition      = 0;
+    track.mLength        = 0;
+    if (track.mOffset != 0)
+    {
+      mHeap[mHeapSize] = i;
+      siftUp(mHeapSize++);
+    }
+  }
+
+  mTempo      = Smf::readUInt32(data + 4);
+  mAnchorTick = Smf::readUInt32(data);
+  sendSnapshot(ioIndex, Smf::readUInt32(data + 8));
+
+  SmfChaseFilter<Interface> filter(mMidi);
+  const unsigned long tick = getBeatTick(inBeats);
+  forward(tick, filter);
+  filter.flush();
+
+  mTick       = tick;
+  mAnchorTick = tick;
+  mAnchorTime = inNowMicros;
+  mPausedTime = 0;
+  return true;
+}
+
+/*! \brief Write the seek index of the file (see XE_MIDI_SmfSeekIndex.h).
+
+  The file is read twice, nothing is sent. The player is rewound.
+  Uses about 4kB of stack: build the index on the host
+  (extras/tools/SeekIndex.cpp), or on boards with enough RAM.
+  \param inInterval  Beats (sixteenth notes) between entries.
+  \return false if the sink is full, or the file uses SMPTE time (no beats).
+*/
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+template<class Sink>
+inline bool SmfPlayer<Interface, Source, MaxTracks, WindowSize>::writeSeekIndex(Sink& ioSink,
+    unsigned inInterval)
+{
+  if (mTrackCount == 0 || (mDivision & 0x8000) || inInterval == 0)
+  {
+    return false;
+  }
+
+  // First pass: length of the song and channels used.
+  SmfChaseState state;
+  rewind();
+  forward(0xffffffffUL, state);
+  const unsigned long entryCount = (unsigned long)((uint64_t)mTick * 4 / ((uint64_t)inInterval * mDivision)) + 1;
+  const unsigned entrySize       = SmfSeekIndex::getEntrySize(mTrackCount);
+
+  byte header[SmfSeekIndex::HeaderSize] = { 'M', 'S', 'I', 'X', SmfSeekIndex::Version, mTrackCount };
+  SmfSeekIndex::writeUInt16(header + 6, inInterval);
+  SmfSeekIndex::writeUInt32(header + 8, entryCount);
+  SmfSeekIndex::writeUInt16(header + 12, state.getChannelMask());
+  bool valid = ioSink.write(0, header, SmfSeekIndex::HeaderSize) == SmfSeekIndex::HeaderSize;
+
+  mSysExTrack = sNoTrack; // Nothing was sent.
+  state.reset();
+  rewind();
+
+  unsigned long offset         = SmfSeekIndex::HeaderSize;
+  unsigned long snapshotOffset = offset + entryCount * entrySize;
+  unsigned long snapshot       = snapshotOffset;
+  for (unsigned long entry = 0; entry < entryCount && valid; ++entry)
+  {
+    const unsigned long tick = getBeatTick(entry * inInterval);
+    forward(tick, state);
+
+    if (state.hasChanged())
+    {
+      snapshot = snapshotOffset;
+      valid &= state.write(ioSink, snapshot);
+      snapshotOffset += 2 + state.getMessageCount() * SmfSeekIndex::MessageSize;
+      state.clearChanged();
+    }
+
+    byte data[SmfSeekIndex::EntrySize];
+    SmfSeekIndex::writeUInt32(data, tick);
+    SmfSeekIndex::writeUInt32(data + 4, mTempo);
+    SmfSeekIndex::writeUInt32(data + 8, snapshot);
+    valid &= ioSink.write(offset, data, SmfSeekIndex::EntrySize) == SmfSeekIndex::EntrySize;
+    offset += SmfSeekIndex::EntrySize;
+
+    bool active[MaxTracks] = {};
+    for (byte i = 0; i < mHeapSize; ++i)
+    {
+      active[mHeap[i]] = true;
+    }
+    for (byte i = 0; i < mTrackCount; ++i)
+    {
+      // The window holds the bytes of the next event, after its delta time.
+      const Track& track = mTracks[i];
+      byte trackState[SmfSeekIndex::TrackStateSize];
+      SmfSeekIndex::writeUInt32(trackState, active[i] ? track.mOffset - (track.mLength - track.mPosition) : 0);
+      SmfSeekIndex::writeUInt32(trackState + 4, track.mTick);
+      trackState[8] = track.mRunningStatus;
+      valid &= ioSink.write(offset, trackState, SmfSeekIndex::TrackStateSize) == SmfSeekIndex::TrackStateSize;
+      offset += SmfSeekIndex::TrackStateSize;
+    }
+  }
+
+  mSysExTrack = sNoTrack;
+  rewind();
+  return valid;
+}
+
+// -----------------------------------------------------------------------------
+
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+inline bool SmfPlayer<Interface, Source, MaxTracks, WindowSize>::isPlaying() const
+{
+  return mPlaying;
+}
+
+/*! \brief All tracks have been played (or the file is not open). */
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+inline bool SmfPlayer<Interface, Source, MaxTracks, WindowSize>::isFinished() const
+{
+  return mHeapSize == 0;
+}
+
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+inline unsigned SmfPlayer<Interface, Source, MaxTracks, WindowSize>::getFormat() const
+{
+  return mFormat;
+}
+
+/*! \brief Number of tracks played. */
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+inline unsigned SmfPlayer<Interface, Source, MaxTracks, WindowSize>::getTrackCount() const
+{
+  return mTrackCount;
+}
+
+/*! \brief Time division, as in the header: ticks per quarter note, or SMPTE
+  format (bit 15 set) and ticks per frame.
+*/
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+inline unsigned SmfPlayer<Interface, Source, MaxTracks, WindowSize>::getDivision() const
+{
+  return mDivision;
+}
+
+/*! \brief Current tempo, in microseconds per quarter note. */
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+inline unsigned long SmfPlayer<Interface, Source, MaxTracks, WindowSize>::getTempo() const
+{
+  return mTempo;
+}
+
+/*! \brief Time of the last event played, in ticks. */
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+inline unsigned long SmfPlayer<Interface, Source, MaxTracks, WindowSize>::getTick() const
+{
+  return mTick;
+}
+
+/*! \brief Time at which the next event is due, on the clock given to update
+  (eg: to sleep until then, or to render the file offline).
+  Only meaningful while playing and not finished.
+*/
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+inline unsigned long SmfPlayer<Interface, Source, MaxTracks, WindowSize>::getNextEventTime() const
+{
+  if (mHeapSize == 0)
+  {
+    return mAnchorTime;
+  }
+  // Rounded up, so that update sees the event due at that time.
+  const uint64_t ticks = mTracks[mHeap[0]].mTick - mAnchorTick;
+  return mAnchorTime + (unsigned long)((ticks * mTempo + mDivisor - 1) / mDivisor);
+}
+
+/*! \brief Number of events played since the last rewind, meta events included. */
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+inline unsigned long SmfPlayer<Interface, Source, MaxTracks, WindowSize>::getEventCount() const
+{
+  return mEventCount;
+}
+
+// -----------------------------------------------------------------------------
+
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+inline bool SmfPlayer<Interface, Source, MaxTracks, WindowSize>::refill(Track& ioTrack)
+{
+  const unsigned long left = ioTrack.mEnd - ioTrack.mOffset;
+  if (left == 0)
+  {
+    return false;
+  }
+  const unsigned size  = left < WindowSize ? unsigned(left) : WindowSize;
+  const unsigned count = mSource.read(ioTrack.mOffset, ioTrack.mWindow, size);
+  if (count == 0)
+  {
+    return false;
+  }
+  ioTrack.mOffset  += count;
+  ioTrack.mPosition = 0;
+  ioTrack.mLength   = byte(count);
+  return true;
+}
+
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+inline bool SmfPlayer<Interface, Source, MaxTracks, WindowSize>::readByte(Track& ioTrack,
+    byte& outByte)
+{
+  if (ioTrack.mPosition == ioTrack.mLength && !refill(ioTrack))
+  {
+    return false;
+  }
+  outByte = ioTrack.mWindow[ioTrack.mPosition++];
+  return true;
+}
+
+// Variable length quantity: 7 bits per byte, most significant first, bit 7
+// set on all bytes but the last. 4 bytes at most.
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+inline bool SmfPlayer<Interface, Source, MaxTracks, WindowSize>::readNumber(Track& ioTrack,
+    unsigned long& outValue)
+{
+  outValue = 0;
+  for (byte i = 0; i < 4; ++i)
+  {
+    byte value = 0;
+    if (!readByte(ioTrack, value))
+    {
+      return false;
+    }
+    outValue = (outValue << 7) | (value & 0x7f);
+    if (value < 0x80)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+inline void SmfPlayer<Interface, Source, MaxTracks, WindowSize>::skip(Track& ioTrack,
+    unsigned long inLength)
+{
+  const unsigned available = ioTrack.mLength - ioTrack.mPosition;
+  if (inLength <= available)
+  {
+    ioTrack.mPosition += byte(inLength);
+    return;
+  }
+  // Jump over the rest without reading it.
+  inLength -= available;
+  ioTrack.mPosition = ioTrack.mLength;
+  ioTrack.mOffset = ioTrack.mEnd - ioTrack.mOffset < inLength ? ioTrack.mEnd
+                                                              : ioTrack.mOffset + inLength;
+}
+
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+inline bool SmfPlayer<Interface, Source, MaxTracks, WindowSize>::readDelta(Track& ioTrack)
+{
+  unsigned long delta = 0;
+  if (!readNumber(ioTrack, delta))
+  {
+    return false;
+  }
+  ioTrack.mTick += delta;
+  return true;
+}
+
+// Send the next event of the merged tracks, and read the delta time of the
+// one following it on the same track.
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+template<class Target>
+inline void SmfPlayer<Interface, Source, MaxTracks, WindowSize>::playNext(Target& ioTarget)
+{
+  Track& track = mTracks[mHeap[0]];
+  mTick = track.mTick;
+  if (dispatch(track, ioTarget) && readDelta(track))
+  {
+    siftDown(0);
+  }
+  else if (--mHeapSize > 0)
+  {
+    mHeap[0] = mHeap[mHeapSize];
+    siftDown(0);
+  }
+}
+
+// Send the events before a tick, whatever the time.
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+template<class Target>
+inline void SmfPlayer<Interface, Source, MaxTracks, WindowSize>::forward(unsigned long inTick,
+    Target& ioTarget)
+{
+  while (mHeapSize > 0 && mTracks[mHeap[0]].mTick < inTick)
+  {
+    playNext(ioTarget);
+  }
+}
+
+// Send the event at the read position, returns false at the end of the track
+// (or if it is malformed).
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+template<class Target>
+inline bool SmfPlayer<Interface, Source, MaxTracks, WindowSize>::dispatch(Track& ioTrack,
+    Target& ioTarget)
+{
+  byte status = 0;
+  byte data1  = 0;
+  if (!readByte(ioTrack, status))
+  {
+    return false;
+  }
+
+  if (status < 0x80)
+  {
+    data1  = status; // Running Status
+    status = ioTrack.mRunningStatus;
+    if (status == 0)
+    {
+      return false;
+    }
+  }
+  else if (status < SystemExclusive)
+  {
+    ioTrack.mRunningStatus = status;
+    if (!readByte(ioTrack, data1))
+    {
+      return false;
+    }
+  }
+
+  if (status < SystemExclusive)
+  {
+    byte data2 = 0;
+    if (Smf::getDataSize(status) > 1 && !readByte(ioTrack, data2))
+    {
+      return false;
+    }
+    closeSysEx(ioTarget);
+    ioTarget.send(MidiType(status & 0xf0), data1, data2, Channel((status & 0x0f) + 1));
+    return true;
+  }
+
+  if (status == Smf::Meta)
+  {
+    byte type = 0;
+    unsigned long length = 0;
+    if (!readByte(ioTrack, type) || !readNumber(ioTrack, length) || type == Smf::EndOfTrack)
+    {
+      return false;
+    }
+    byte tempo[3];
+    if (type == Smf::Tempo && length == 3 &&
+        readByte(ioTrack, tempo[0]) && readByte(ioTrack, tempo[1]) && readByte(ioTrack, tempo[2]))
+    {
+      setTempo(ioTrack.mTick, (unsigned long)tempo[0] << 16 | (unsigned long)tempo[1] << 8 | tempo[2]);
+    }
+    else
+    {
+      skip(ioTrack, length);
+    }
+    return true;
+  }
+
+  unsigned long length = 0;
+  if (!readNumber(ioTrack, length))
+  {
+    return false;
+  }
+
+  // A divided SysEx owns the output from its 0xf0 event: any other message
+  // (from its track or another one) terminates the frame, and the packets
+  // left are skipped, a receiver would not resume a broken frame.
+  const byte index = byte(&ioTrack - mTracks);
+  if (status == SystemExclusive)
+  {
+    closeSysEx(ioTarget); // Previous divided SysEx never terminated
+    ioTarget.beginSysEx();
+    mSysExTrack      = index;
+    ioTrack.mInSysEx = true;
+    sendSysExData(ioTrack, length, ioTarget);
+    return true;
+  }
+  if (status == Smf::Escape)
+  {
+    if (!ioTrack.mInSysEx)
+    {
+      sendEscaped(ioTrack, length, ioTarget);
+    }
+    else if (mSysExTrack == index)
+    {
+      sendSysExData(ioTrack, length, ioTarget); // Divided SysEx continuation
+    }
+    else
+    {
+      skipSysExData(ioTrack, length);
+    }
+    return true;
+  }
+  return false;
+}
+
+// Stream SysEx bytes from the window, the frame ends with a 0xf7 last byte.
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+template<class Target>
+inline void SmfPlayer<Interface, Source, MaxTracks, WindowSize>::sendSysExData(Track& ioTrack,
+    unsigned long inLength, Target& ioTarget)
+{
+  while (inLength > 0)
+  {
+    if (ioTrack.mPosition == ioTrack.mLength && !refill(ioTrack))
+    {
+      return;
+    }
+    unsigned count = ioTrack.mLength - ioTrack.mPosition;
+    if (count > inLength)
+    {
+      count = unsigned(inLength);
+    }
+    const byte* data = ioTrack.mWindow + ioTrack.mPosition;
+    ioTrack.mPosition += byte(count);
+    inLength -= count;
+
+    if (inLength == 0 && data[count - 1] == 0xf7)
+    {
+      ioTarget.sendSysExData(count - 1, data);
+      ioTarget.endSysEx();
+      mSysExTrack      = sNoTrack;
+      ioTrack.mInSysEx = false;
+      return;
+    }
+    ioTarget.sendSysExData(count, data);
+  }
+}
+
+// Escape events outside SysEx: send the System Common and Real Time
+// messages they hold, other bytes are skipped.
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+template<class Target>
+inline void SmfPlayer<Interface, Source, MaxTracks, WindowSize>::sendEscaped(Track& ioTrack,
+    unsigned long inLength, Target& ioTarget)
+{
+  while (inLength > 0)
+  {
+    byte status = 0;
+    if (!readByte(ioTrack, status))
+    {
+      return;
+    }
+    inLength--;
+
+    if (status >= Clock)
+    {
+      ioTarget.sendRealTime(MidiType(status)); // Allowed inside SysEx
+      continue;
+    }
+
+    const byte size = Smf::getDataSize(status);
+    byte data[2] = { 0, 0 };
+    if (size > inLength)
+    {
+      skip(ioTrack, inLength);
+      return;
+    }
+    for (byte i = 0; i < size; ++i)
+    {
+      readByte(ioTrack, data[i]);
+    }
+    inLength -= size;
+
+    if (status == TimeCodeQuarterFrame || status == SongPosition ||
+        status == SongSelect || status == TuneRequest)
+    {
+      closeSysEx(ioTarget);
+    }
+    switch (status)
+    {
+      case TimeCodeQuarterFrame:  ioTarget.sendTimeCodeQuarterFrame(data[0]); break;
+      case SongPosition:          ioTarget.sendSongPosition(data[0] | unsigned(data[1]) << 7); break;
+      case SongSelect:            ioTarget.sendSongSelect(data[0]); break;
+      case TuneRequest:           ioTarget.sendTuneRequest(); break;
+      default:                    break;
+    }
+  }
+}
+
+// Terminate the SysEx frame open on the output, if any.
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+template<class Target>
+inline void SmfPlayer<Interface, Source, MaxTracks, WindowSize>::closeSysEx(Target& ioTarget)
+{
+  if (mSysExTrack != sNoTrack)
+  {
+    ioTarget.endSysEx();
+    mSysExTrack = sNoTrack;
+  }
+}
+
+// Skip a divided SysEx packet whose frame was terminated, the 0xf7 last byte
+// still ends the SysEx of the track.
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+inline void SmfPlayer<Interface, Source, MaxTracks, WindowSize>::skipSysExData(Track& ioTrack,
+    unsigned long inLength)
+{
+  if (inLength == 0)
+  {
+    return;
+  }
+  skip(ioTrack, inLength - 1);
+  byte last = 0;
+  if (readByte(ioTrack, last) && last == 0xf7)
+  {
+    ioTrack.mInSysEx = false;
+  }
+}
+
+// Send the messages of a seek index snapshot.
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+template<class IndexSource>
+inline bool SmfPlayer<Interface, Source, MaxTracks, WindowSize>::sendSnapshot(IndexSource& ioIndex,
+    unsigned long inOffset)
+{
+  byte data[5 * SmfSeekIndex::MessageSize];
+  if (ioIndex.read(inOffset, data, 2) != 2)
+  {
+    return false;
+  }
+  unsigned count = Smf::readUInt16(data);
+  inOffset += 2;
+
+  while (count > 0)
+  {
+    const byte chunk = count < 5 ? byte(count) : 5;
+    const unsigned size = chunk * SmfSeekIndex::MessageSize;
+    if (ioIndex.read(inOffset, data, size) != size)
+    {
+      return false;
+    }
+    for (const byte* message = data; message < data + size; message += SmfSeekIndex::MessageSize)
+    {
+      mMidi.send(MidiType(message[0] & 0xf0), message[1], message[2], Channel((message[0] & 0x0f) + 1));
+    }
+    inOffset += size;
+    count    -= chunk;
+  }
+  return true;
+}
+
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+inline void SmfPlayer<Interface, Source, MaxTracks, WindowSize>::setTempo(unsigned long inTick,
+    unsigned long inTempo)
+{
+  if ((mDivision & 0x8000) || inTempo == 0)
+  {
+    return; // SMPTE time does not depend on the tempo.
+  }
+  mAnchorTime += (unsigned long)((uint64_t)(inTick - mAnchorTick) * mTempo / mDivisor);
+  mAnchorTick  = inTick;
+  mTempo       = inTempo;
+}
+
+// Last tick due at the given time. Times are relative to the anchor, which
+// is moved forward when it gets old, so that they never wrap around (eg:
+// micros() wraps around every 71 minutes, long songs have few tempo changes).
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+inline unsigned long SmfPlayer<Interface, Source, MaxTracks, WindowSize>::getDueTick(unsigned long inNowMicros)
+{
+  const unsigned long elapsed = inNowMicros - mAnchorTime;
+  const unsigned long ticks   = (unsigned long)((uint64_t)elapsed * mDivisor / mTempo);
+  if (elapsed >= 0x40000000UL)
+  {
+    mAnchorTime += (unsigned long)((uint64_t)ticks * mTempo / mDivisor);
+    mAnchorTick += ticks;
+    return mAnchorTick;
+  }
+  return mAnchorTick + ticks;
+}
+
+// Tick of a position in MIDI beats (sixteenth notes).
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+inline unsigned long SmfPlayer<Interface, Source, MaxTracks, WindowSize>::getBeatTick(unsigned long inBeats) const
+{
+  return (unsigned long)((uint64_t)inBeats * mDivision / 4);
+}
+
+// -----------------------------------------------------------------------------
+// Min-heap of the tracks, by time of their next event, then track number so
+// that simultaneous events keep the file order.
+
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+inline bool SmfPlayer<Interface, Source, MaxTracks, WindowSize>::isBefore(byte inTrackA,
+    byte inTrackB) const
+{
+  const unsigned long tickA = mTracks[inTrackA].mTick;
+  const unsigned long tickB = mTracks[inTrackB].mTick;
+  return tickA < tickB || (tickA == tickB && inTrackA < inTrackB);
+}
+
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+inline void SmfPlayer<Interface, Source, MaxTracks, WindowSize>::siftUp(byte inIndex)
+{
+  unsigned index = inIndex;
+  while (index > 0)
+  {
+    const unsigned parent = (index - 1) / 2;
+    if (!isBefore(mHeap[index], mHeap[parent]))
+    {
+      break;
+    }
+    const byte swap = mHeap[index];
+    mHeap[index]    = mHeap[parent];
+    mHeap[parent]   = swap;
+    index = parent;
+  }
+}
+
+template<class Interface, class Source, unsigned MaxTracks, unsigned WindowSize>
+inline void SmfPlayer<Interface, Source, MaxTracks, WindowSize>::siftDown(byte inIndex)
+{
+  unsigned index = inIndex;
+  for (;;)
+  {
+    unsigned child = 2 * index + 1;
+    if (child >= mHeapSize)
+    {
+      break;
+    }
+    if (child + 1 < mHeapSize && isBefore(mHeap[child + 1], mHeap[child]))
+    {
+      child++;
+    }
+    if (!isBefore(mHeap[child], mHeap[index]))
+    {
+      break;
+    }
+    const byte swap = mHeap[index];
+    mHeap[index]    = mHeap[child];
+    mHeap[child]    = swap;
+    index = child;
+  }
+}
+
+END_MIDI_NAMESPACE
@@ -0,0 +1,247 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#pragma once
+
+#include "XE_MIDI_Defs.h"
+#include "XE_MIDI_Smf.h"
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief Seek index of a Standard MIDI File, for SmfPlayer::seek.
+
+  Made by SmfPlayer::writeSeekIndex (or extras/tools/SeekIndex.cpp), it holds
+  an entry every Interval MIDI beats (sixteenth notes, the unit of Song
+  Position Pointer): where each track resumes, the tempo, and a chase
+  snapshot, the messages that restore the controllers, programs, pitch bend,
+  channel pressure and held notes at that position. Seeking reads one entry,
+  whatever the file length, then plays the events up to the position,
+  holding back the notes that start there until the position is reached.
+
+  Big endian layout, as the SMF:
+  - header (16 bytes): "MSIX", version, number of tracks, interval in beats
+    (2 bytes), number of entries (4 bytes), mask of the channels used
+    (2 bytes, bit 0 for channel 1), 2 reserved bytes,
+  - entries, entry i at beat i * Interval: tick (4 bytes), tempo (4 bytes),
+    offset of its snapshot (4 bytes), then for each track: offset of its next
+    event (4 bytes, 0 once the track is over), tick of that event (4 bytes)
+    and running status,
+  - snapshots: number of messages (2 bytes), then 3 bytes per message.
+    Entries share the snapshot of the previous one when nothing changed.
+*/
+struct SmfSeekIndex
+{
+  enum
+  {
+    Version         = 1,
+    HeaderSize      = 16,
+    EntrySize       = 12,       ///< Without the track states.
+    TrackStateSize  = 9,
+    MessageSize     = 3,
+    DefaultInterval = 16,       ///< One 4/4 bar.
+  };
+
+  /*! Size of an entry of an index of inTrackCount tracks. */
+  static inline unsigned getEntrySize(unsigned inTrackCount)
+  {
+    return EntrySize + inTrackCount * TrackStateSize;
+  }
+
+  static inline void writeUInt16(byte* outData, unsigned inValue)
+  {
+    outData[0] = byte(inValue >> 8);
+    outData[1] = byte(inValue);
+  }
+
+  static inline void writeUInt32(byte* outData, unsigned long inValue)
+  {
+    outData[0] = byte(inValue >> 24);
+    outData[1] = byte(inValue >> 16);
+    outData[2] = byte(inValue >> 8);
+    outData[3] = byte(inValue);
+  }
+};
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Channel state followed while building a seek index.
+
+  Takes the place of the interface of SmfPlayer: remembers the last value of
+  each controller (channel mode messages excluded), program, pitch bend and
+  channel pressure, and the velocity of held notes, on each channel.
+  Data Entry and Data Increment/Decrement are followed by parameter: the
+  value of the first MaxParameters RPN & NRPN set on each channel is kept
+  with its number, so that it is restored with its selection.
+  About 5kB of RAM.
+*/
+class SmfChaseState
+{
+  public:
+    inline SmfChaseState();
+
+  public:
+    inline void reset();
+    inline unsigned getMessageCount() const;
+    template<class Sink>
+    inline bool write(Sink& ioSink, unsigned long inOffset) const;
+    inline unsigned getChannelMask() const;
+    inline bool hasChanged() const;
+    inline void clearChanged();
+
+  public: // Interface used by SmfPlayer
+    inline void send(MidiType inType, DataByte inData1, DataByte inData2, Channel inChannel);
+    inline void beginSysEx() {}
+    template<class Source>
+    inline void sendSysExData(unsigned, const Source&) {}
+    inline void endSysEx() {}
+    inline void sendTimeCodeQuarterFrame(DataByte) {}
+    inline void sendSongPosition(unsigned) {}
+    inline void sendSongSelect(DataByte) {}
+    inline void sendTuneRequest() {}
+    inline void sendRealTime(MidiType) {}
+
+  private:
+    enum
+    {
+      ControllerCount = 120,    ///< Channel mode messages (120 to 127) are not state.
+      MaxParameters   = 8,      ///< RPN & NRPN followed on each channel.
+      Unset           = 0xff,
+    };
+
+    struct Parameter
+    {
+      byte mSelect;             ///< RPNMSB or NRPNMSB.
+      byte mNumber[2];          ///< MSB, LSB.
+      byte mValue[2];           ///< Data Entry MSB, LSB.
+    };
+
+    static inline bool isParameterController(byte inController);
+    inline void sendDataEntry(byte inChannel, byte inController, byte inValue);
+    inline unsigned getParameterMessageCount(byte inChannel) const;
+
+    template<class Sink>
+    static inline bool writeMessage(Sink& ioSink, unsigned long& ioOffset,
+                                    byte inStatus, byte inData1, byte inData2);
+
+    byte mControllers[16][ControllerCount];
+    byte mPrograms[16];
+    byte mPitchBend[16][2];
+    byte mPressure[16];
+    byte mNotes[16][128];       ///< Velocity of held notes, 0 if released.
+    Parameter mParameters[16][MaxParameters];
+    byte mParameterCounts[16];
+    byte mSelections[16];       ///< RPNMSB or NRPNMSB, as last selected, 0 if none.
+    unsigned mChannelMask;
+    bool mChanged;
+};
+
+/*! \brief Interface wrapper of SmfPlayer when it plays up to a seek position:
+  state messages (controllers, programs, pitch bend, channel pressure,
+  SysEx) go through, polyphonic pressure, System Common and Real Time
+  messages don't.
+  Note Off messages (and Note On with a null velocity) go through, to
+  release the notes of the snapshot that end before the position. Other
+  Note On messages are held back: the notes still held at the position are
+  sent by flush, up to MaxNotes of them.
+*/
+template<class Interface, unsigned MaxNotes = 16>
+class SmfChaseFilter
+{
+  public:
+    inline explicit SmfChaseFilter(Interface& ioMidi)
+      : mMidi(ioMidi)
+      , mNoteCount(0)
+    {
+    }
+
+  public:
+    inline void send(MidiType inType, DataByte inData1, DataByte inData2, Channel inChannel)
+    {
+      if (inType == NoteOn && inData2 != 0)
+      {
+        holdNote(inData1, inData2, inChannel);
+      }
+      else if (inType != AfterTouchPoly)
+      {
+        if (inType == NoteOn || inType == NoteOff)
+        {
+          releaseNote(inData1, inChannel);
+        }
+        mMidi.send(inType, inData1, inData2, inChannel);
+      }
+    }
+    inline void beginSysEx()                                  { mMidi.beginSysEx(); }
+    template<class Source>
+    inline void sendSysExData(unsigned inLength, const Source& inData) { mMidi.sendSysExData(inLength, inData); }
+    inline void endSysEx()                                    { mMidi.endSysEx(); }
+    inline void sendTimeCodeQuarterFrame(DataByte) {}
+    inline void sendSongPosition(unsigned) {}
+    inline void sendSongSelect(DataByte) {}
+    inline void sendTuneRequest() {}
+    inline void sendRealTime(MidiType) {}
+
+  public:
+    /*! Send the notes started and still held. */
+    inline void flush()
+    {
+      for (byte i = 0; i < mNoteCount; ++i)
+      {
+        mMidi.send(NoteOn, mNotes[i][1], mNotes[i][2], Channel(mNotes[i][0]));
+      }
+      mNoteCount = 0;
+    }
+
+  private:
+    inline void holdNote(DataByte inNote, DataByte inVelocity, Channel inChannel)
+    {
+      releaseNote(inNote, inChannel); // Retriggered: keep the last velocity.
+      if (mNoteCount < MaxNotes)
+      {
+        byte* note = mNotes[mNoteCount++];
+        note[0] = inChannel;
+        note[1] = inNote;
+        note[2] = inVelocity;
+      }
+    }
+
+    inline void releaseNote(DataByte inNote, Channel inChannel)
+    {
+      for (byte i = 0; i < mNoteCount; ++i)
+      {
+        if (mNotes[i][0] == inChannel && mNotes[i][1] == inNote)
+        {
+          memmove(mNotes[i], mNotes[i + 1], (mNoteCount - i - 1) * sizeof(mNotes[0]));
+          mNoteCount--;
+          return;
+        }
+      }
+    }
+
+  private:
+    typedef char MaxNotesCheck[(MaxNotes >= 1 && MaxNotes <= 255) ? 1 : -1];
+
+    Interface&  mMidi;
+    byte        mNotes[MaxNotes][3];    ///< Channel, note and velocity, by start.
+    byte        mNoteCount;
+};
+
+END_MIDI_NAMESPACE
+
+#include "XE_MIDI_SmfSeekIndex.hpp"
@@ -0,0 +1,357 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#pragma once
+
+BEGIN_MIDI_NAMESPACE
+
+inline SmfChaseState::SmfChaseState()
+{
+  reset();
+}
+
+inline void SmfChaseState::reset()
+{
+  memset(mControllers, Unset, sizeof(mControllers));
+  memset(mPrograms, Unset, sizeof(mPrograms));
+  memset(mPitchBend, Unset, sizeof(mPitchBend));
+  memset(mPressure, Unset, sizeof(mPressure));
+  memset(mNotes, 0, sizeof(mNotes));
+  memset(mParameterCounts, 0, sizeof(mParameterCounts));
+  memset(mSelections, 0, sizeof(mSelections));
+  mChannelMask = 0;
+  mChanged     = true;
+}
+
+/*! \brief Number of messages needed to restore the state. */
+inline unsigned SmfChaseState::getMessageCount() const
+{
+  unsigned count = 0;
+  for (byte channel = 0; channel < 16; ++channel)
+  {
+    for (byte i = 0; i < ControllerCount; ++i)
+    {
+      count += mControllers[channel][i] != Unset && !isParameterController(i);
+    }
+    count += getParameterMessageCount(channel);
+    for (byte note = 0; note < 128; ++note)
+    {
+      count += mNotes[channel][note] != 0;
+    }
+    count += mPrograms[channel] != Unset;
+    count += mPitchBend[channel][1] != Unset;
+    count += mPressure[channel] != Unset;
+  }
+  return count;
+}
+
+/*! \brief Write the snapshot: number of messages, then the messages, bank
+  select before program change, program change before the other
+  controllers, then each RPN & NRPN value after its selection and the
+  selection in use last (or the null RPN), held notes last.
+  \return false if the sink is full.
+*/
+template<class Sink>
+inline bool SmfChaseState::write(Sink& ioSink, unsigned long inOffset) const
+{
+  byte count[2];
+  SmfSeekIndex::writeUInt16(count, getMessageCount());
+  if (ioSink.write(inOffset, count, 2) != 2)
+  {
+    return false;
+  }
+  inOffset += 2;
+
+  bool valid = true;
+  for (byte channel = 0; channel < 16; ++channel)
+  {
+    const byte* controllers = mControllers[channel];
+    const byte bankSelect[] = { BankSelect, BankSelect + 32 };
+    for (byte i = 0; i < 2; ++i)
+    {
+      if (controllers[bankSelect[i]] != Unset)
+      {
+        valid &= writeMessage(ioSink, inOffset, ControlChange | channel, bankSelect[i], controllers[bankSelect[i]]);
+      }
+    }
+    if (mPrograms[channel] != Unset)
+    {
+      valid &= writeMessage(ioSink, inOffset, ProgramChange | channel, mPrograms[channel], 0);
+    }
+    for (byte i = 0; i < ControllerCount; ++i)
+    {
+      if (controllers[i] != Unset && i != bankSelect[0] && i != bankSelect[1] &&
+          !isParameterController(i))
+      {
+        valid &= writeMessage(ioSink, inOffset, ControlChange | channel, i, controllers[i]);
+      }
+    }
+    for (byte i = 0; i < mParameterCounts[channel]; ++i)
+    {
+      const Parameter& parameter = mParameters[channel][i];
+      valid &= writeMessage(ioSink, inOffset, ControlChange | channel, parameter.mSelect, parameter.mNumber[0]);
+      valid &= writeMessage(ioSink, inOffset, ControlChange | channel, parameter.mSelect - 1, parameter.mNumber[1]);
+      if (parameter.mValue[0] != Unset)
+      {
+        valid &= writeMessage(ioSink, inOffset, ControlChange | channel, DataEntryMSB, parameter.mValue[0]);
+      }
+      if (parameter.mValue[1] != Unset)
+      {
+        valid &= writeMessage(ioSink, inOffset, ControlChange | channel, DataEntryLSB, parameter.mValue[1]);
+      }
+    }
+    const byte select = mSelections[channel];
+    if (select != 0)
+    {
+      for (byte i = 0; i < 2; ++i)
+      {
+        if (controllers[select - i] != Unset)
+        {
+          valid &= writeMessage(ioSink, inOffset, ControlChange | channel, select - i, controllers[select - i]);
+        }
+      }
+    }
+    else if (mParameterCounts[channel] != 0)
+    {
+      valid &= writeMessage(ioSink, inOffset, ControlChange | channel, RPNMSB, 0x7f);
+      valid &= writeMessage(ioSink, inOffset, ControlChange | channel, RPNLSB, 0x7f);
+    }
+    if (mPitchBend[channel][1] != Unset)
+    {
+      valid &= writeMessage(ioSink, inOffset, PitchBend | channel, mPitchBend[channel][0], mPitchBend[channel][1]);
+    }
+    if (mPressure[channel] != Unset)
+    {
+      valid &= writeMessage(ioSink, inOffset, AfterTouchChannel | channel, mPressure[channel], 0);
+    }
+    for (byte note = 0; note < 128; ++note)
+    {
+      if (mNotes[channel][note] != 0)
+      {
+        valid &= writeMessage(ioSink, inOffset, NoteOn | channel, note, mNotes[channel][note]);
+      }
+    }
+  }
+  return valid;
+}
+
+/*! \brief Channels that had messages, bit 0 for channel 1. */
+inline unsigned SmfChaseState::getChannelMask() const
+{
+  return mChannelMask;
+}
+
+/*! \brief The state changed since the last call to clearChanged. */
+inline bool SmfChaseState::hasChanged() const
+{
+  return mChanged;
+}
+
+inline void SmfChaseState::clearChanged()
+{
+  mChanged = false;
+}
+
+// -----------------------------------------------------------------------------
+
+inline void SmfChaseState::send(MidiType inType, DataByte inData1, DataByte inData2,
+                                Channel inChannel)
+{
+  const byte channel = (inChannel - 1) & 0x0f;
+  const byte note    = inData1 & 0x7f;
+  mChannelMask |= 1u << channel;
+
+  byte* value = 0;
+  byte newValue = inData1;
+  switch (inType)
+  {
+    case NoteOn:
+      value    = &mNotes[channel][note];
+      newValue = inData2;
+      break;
+
+    case NoteOff:
+      value    = &mNotes[channel][note];
+      newValue = 0;
+      break;
+
+    case ControlChange:
+      if (inData1 == DataEntryMSB || inData1 == DataEntryLSB ||
+          inData1 == DataIncrement || inData1 == DataDecrement)
+      {
+        sendDataEntry(channel, inData1, inData2);
+      }
+      else if (inData1 < ControllerCount)
+      {
+        if (inData1 >= NRPNLSB && inData1 <= RPNMSB)
+        {
+          const byte select = inData1 >= RPNLSB ? byte(RPNMSB) : byte(NRPNMSB);
+          mChanged |= mSelections[channel] != select;
+          mSelections[channel] = select;
+        }
+        value    = &mControllers[channel][inData1];
+        newValue = inData2;
+      }
+      else if (inData1 == ResetAllControllers)
+      {
+        // Parameter values are kept, only the selection is nulled.
+        memset(mControllers[channel], Unset, ControllerCount);
+        mSelections[channel] = 0;
+        mPitchBend[channel][0] = mPitchBend[channel][1] = Unset;
+        mPressure[channel] = Unset;
+        mChanged = true;
+      }
+      else if (inData1 == AllSoundOff || inData1 >= AllNotesOff)
+      {
+        memset(mNotes[channel], 0, 128);
+        mChanged = true;
+      }
+      break;
+
+    case ProgramChange:
+      value = &mPrograms[channel];
+      break;
+
+    case AfterTouchChannel:
+      value = &mPressure[channel];
+      break;
+
+    case PitchBend:
+      mChanged |= mPitchBend[channel][0] != inData1 || mPitchBend[channel][1] != inData2;
+      mPitchBend[channel][0] = inData1;
+      mPitchBend[channel][1] = inData2;
+      break;
+
+    default:
+      break;
+  }
+
+  if (value != 0 && *value != newValue)
+  {
+    *value   = newValue;
+    mChanged = true;
+  }
+}
+
+/*! Data entry and selection controllers, restored by parameter. */
+inline bool SmfChaseState::isParameterController(byte inController)
+{
+  return inController == DataEntryMSB || inController == DataEntryLSB ||
+         (inController >= DataIncrement && inController <= RPNMSB);
+}
+
+inline void SmfChaseState::sendDataEntry(byte inChannel, byte inController, byte inValue)
+{
+  const byte select = mSelections[inChannel];
+  if (select == 0)
+  {
+    return;
+  }
+  const byte numberMsb = mControllers[inChannel][select];
+  const byte numberLsb = mControllers[inChannel][select - 1];
+  if (numberMsb == Unset || numberLsb == Unset || (numberMsb == 0x7f && numberLsb == 0x7f))
+  {
+    return; // No parameter, or the null one.
+  }
+
+  Parameter* parameters = mParameters[inChannel];
+  byte index = 0;
+  while (index < mParameterCounts[inChannel] &&
+         (parameters[index].mSelect != select ||
+          parameters[index].mNumber[0] != numberMsb ||
+          parameters[index].mNumber[1] != numberLsb))
+  {
+    index++;
+  }
+  const bool step = inController == DataIncrement || inController == DataDecrement;
+  if (index == mParameterCounts[inChannel])
+  {
+    if (step || index == MaxParameters)
+    {
+      return; // Unknown value, or no room left.
+    }
+    Parameter& parameter = parameters[mParameterCounts[inChannel]++];
+    parameter.mSelect    = select;
+    parameter.mNumber[0] = numberMsb;
+    parameter.mNumber[1] = numberLsb;
+    parameter.mValue[0]  = parameter.mValue[1] = Unset;
+  }
+
+  Parameter& parameter = parameters[index];
+  byte value[2] = { parameter.mValue[0], parameter.mValue[1] };
+  if (inController == DataEntryMSB)
+  {
+    value[0] = inValue;
+  }
+  else if (inController == DataEntryLSB)
+  {
+    value[1] = inValue;
+  }
+  else if (value[0] != Unset)
+  {
+    unsigned combined = unsigned(value[0]) << 7 | (value[1] != Unset ? value[1] : 0);
+    if (inController == DataIncrement && combined < 0x3fff)
+    {
+      combined++;
+    }
+    else if (inController == DataDecrement && combined > 0)
+    {
+      combined--;
+    }
+    value[0] = byte(combined >> 7);
+    value[1] = byte(combined & 0x7f);
+  }
+  mChanged |= value[0] != parameter.mValue[0] || value[1] != parameter.mValue[1];
+  parameter.mValue[0] = value[0];
+  parameter.mValue[1] = value[1];
+}
+
+/*! Messages of the RPN & NRPN values and the selection, see write. */
+inline unsigned SmfChaseState::getParameterMessageCount(byte inChannel) const
+{
+  unsigned count = 0;
+  for (byte i = 0; i < mParameterCounts[inChannel]; ++i)
+  {
+    const Parameter& parameter = mParameters[inChannel][i];
+    count += 2 + (parameter.mValue[0] != Unset) + (parameter.mValue[1] != Unset);
+  }
+  const byte select = mSelections[inChannel];
+  if (select != 0)
+  {
+    count += (mControllers[inChannel][select] != Unset) + (mControllers[inChannel][select - 1] != Unset);
+  }
+  else if (mParameterCounts[inChannel] != 0)
+  {
+    count += 2;
+  }
+  return count;
+}
+
+template<class Sink>
+inline bool SmfChaseState::writeMessage(Sink& ioSink, unsigned long& ioOffset,
+                                        byte inStatus, byte inData1, byte inData2)
+{
+  const byte message[SmfSeekIndex::MessageSize] = { inStatus, inData1, inData2 };
+  const bool valid = ioSink.write(ioOffset, message, SmfSeekIndex::MessageSize) == SmfSeekIndex::MessageSize;
+  ioOffset += SmfSeekIndex::MessageSize;
+  return valid;
+}
+
+END_MIDI_NAMESPACE
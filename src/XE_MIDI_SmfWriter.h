@@ -0,0 +1,107 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#pragma once
+
+#include "XE_MIDI_Defs.h"
+#include "XE_MIDI_Smf.h"
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief Streaming Standard MIDI File writer, to record a MidiInterface
+  input without keeping the session in memory.
+
+  Events are encoded as they come (variable length delta times, Running
+  Status) into a block of BlockSize bytes, written to the Sink (see
+  XE_MIDI_Smf.h) when full: use the sector size (512) for SD cards. The
+  track length is written back by end().
+
+  Files are type 0 (a single track), or type 1 with a tempo track followed
+  by the recorded track. Times are converted to ticks with the division and
+  tempo given to begin(). System Common messages are stored as escape
+  events, Real Time ones only when enabled with setRecordRealTime.
+
+  \code{.cpp}
+  void setup() { writer.begin(micros()); }
+  void loop()
+  {
+    if (MIDI.read())
+      writer.record(MIDI, micros());
+    if (stopButtonPressed())
+      writer.end(micros());
+  }
+  \endcode
+*/
+template<class Sink, unsigned BlockSize = 64>
+class SmfWriter
+{
+  public:
+    inline SmfWriter(Sink& ioSink);
+
+  public:
+    inline bool begin(unsigned long inNowMicros,
+                      byte inFormat = 1,
+                      unsigned inDivision = 480,
+                      unsigned long inTempo = Smf::DefaultTempo);
+    inline bool end(unsigned long inNowMicros);
+
+    template<class Interface>
+    inline void record(const Interface& inMidi, unsigned long inNowMicros);
+    inline void writeMessage(byte inStatus, byte inData1, byte inData2, unsigned long inNowMicros);
+    inline void writeSysEx(const byte* inData, unsigned inLength, unsigned long inNowMicros);
+
+  public:
+    inline void setRecordRealTime(bool inRecord);
+    inline bool isRecording() const;
+    inline bool hasError() const;
+    inline unsigned long getEventCount() const;
+    inline unsigned long getSize() const;
+
+  private:
+    inline void writeDelta(unsigned long inNowMicros);
+    inline void writeTempoTrackEvents();
+    inline void put(byte inByte);
+    inline void putNumber(unsigned long inValue);
+    inline void putUInt32(unsigned long inValue);
+    inline void flushBlock();
+
+  private:
+    typedef char BlockSizeCheck[(BlockSize >= 8 && BlockSize <= 4096) ? 1 : -1];
+
+    Sink&           mSink;
+    byte            mBlock[BlockSize];
+    unsigned        mBlockUsed;
+    unsigned long   mBlockOffset;       ///< File offset of the block.
+    unsigned long   mTrackOffset;       ///< File offset of the recorded track events.
+    unsigned        mDivision;
+    unsigned long   mTempo;
+    unsigned long   mAnchorTime;        ///< Time of mAnchorTick, in microseconds.
+    unsigned long   mAnchorTick;
+    unsigned long   mLastTick;
+    unsigned long   mEventCount;
+    byte            mRunningStatus;
+    bool            mRecording;
+    bool            mRecordRealTime;
+    bool            mError;
+};
+
+END_MIDI_NAMESPACE
+
+#include "XE_MIDI_SmfWriter.hpp"
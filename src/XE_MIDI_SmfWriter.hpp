@@ -0,0 +1,357 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#pragma once
+
+BEGIN_MIDI_NAMESPACE
+
+template<class Sink, unsigned BlockSize>
+inline SmfWriter<Sink, BlockSize>::SmfWriter(Sink& ioSink)
+  : mSink(ioSink)
+  , mBlockUsed(0)
+  , mBlockOffset(0)
+  , mTrackOffset(0)
+  , mDivision(480)
+  , mTempo(Smf::DefaultTempo)
+  , mAnchorTime(0)
+  , mAnchorTick(0)
+  , mLastTick(0)
+  , mEventCount(0)
+  , mRunningStatus(0)
+  , mRecording(false)
+  , mRecordRealTime(false)
+  , mError(false)
+{
+}
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Write the file header and start recording.
+  \param inNowMicros  Current time in microseconds (eg: micros()), time 0
+                      of the file.
+  \param inFormat     0 (single track) or 1 (tempo track + recorded track).
+  \param inDivision   Ticks per quarter note.
+  \param inTempo      Microseconds per quarter note.
+  \return false for an invalid format or division.
+*/
+template<class Sink, unsigned BlockSize>
+inline bool SmfWriter<Sink, BlockSize>::begin(unsigned long inNowMicros,
+    byte inFormat,
+    unsigned inDivision,
+    unsigned long inTempo)
+{
+  if (inFormat > 1 || inDivision == 0 || inDivision > 0x7fff || inTempo == 0 || inTempo > 0xffffff)
+  {
+    return false;
+  }
+
+  mBlockUsed      = 0;
+  mBlockOffset    = 0;
+  mDivision       = inDivision;
+  mTempo          = inTempo;
+  mAnchorTime     = inNowMicros;
+  mAnchorTick     = 0;
+  mLastTick       = 0;
+  mEventCount     = 0;
+  mRunningStatus  = 0;
+  mError          = false;
+
+  static const byte header[] = { 'M', 'T', 'h', 'd', 0, 0, 0, 6, 0 };
+  for (byte i = 0; i < sizeof(header); ++i)
+  {
+    put(header[i]);
+  }
+  put(inFormat);
+  put(0);
+  put(inFormat == 0 ? 1 : 2);
+  put(byte(inDivision >> 8));
+  put(byte(inDivision));
+
+  if (inFormat == 1)
+  {
+    // Tempo track: tempo, time signature & end of track (19 bytes).
+    put('M'); put('T'); put('r'); put('k');
+    putUInt32(19);
+    writeTempoTrackEvents();
+    put(0); put(Smf::Meta); put(Smf::EndOfTrack); put(0);
+  }
+
+  put('M'); put('T'); put('r'); put('k');
+  putUInt32(0); // Written back by end()
+  mTrackOffset = mBlockOffset + mBlockUsed;
+
+  if (inFormat == 0)
+  {
+    writeTempoTrackEvents();
+  }
+
+  mRecording = true;
+  return !mError;
+}
+
+/*! \brief Write the end of the track, flush and write back the track length.
+  \param inNowMicros  Current time in microseconds: end of the file.
+  \return false if the Sink failed to write at some point.
+*/
+template<class Sink, unsigned BlockSize>
+inline bool SmfWriter<Sink, BlockSize>::end(unsigned long inNowMicros)
+{
+  if (!mRecording)
+  {
+    return false;
+  }
+  writeDelta(inNowMicros);
+  put(Smf::Meta);
+  put(Smf::EndOfTrack);
+  put(0);
+  flushBlock();
+
+  byte length[4];
+  const unsigned long size = mBlockOffset - mTrackOffset;
+  length[0] = byte(size >> 24);
+  length[1] = byte(size >> 16);
+  length[2] = byte(size >> 8);
+  length[3] = byte(size);
+  if (mSink.write(mTrackOffset - 4, length, 4) != 4)
+  {
+    mError = true;
+  }
+
+  mRecording = false;
+  return !mError;
+}
+
+/*! \brief Record the last message read by an interface.
+  \code{.cpp}
+  if (MIDI.read()) writer.record(MIDI, micros());
+  \endcode
+*/
+template<class Sink, unsigned BlockSize>
+template<class Interface>
+inline void SmfWriter<Sink, BlockSize>::record(const Interface& inMidi, unsigned long inNowMicros)
+{
+  const MidiType type = inMidi.getType();
+  if (type == InvalidType || (type >= Clock && !mRecordRealTime))
+  {
+    return;
+  }
+  if (type == SystemExclusive)
+  {
+    writeSysEx(inMidi.getSysExArray(), inMidi.getSysExArrayLength(), inNowMicros);
+    return;
+  }
+  const byte status = type < SystemExclusive ? byte(type | ((inMidi.getChannel() - 1) & 0x0f))
+                                             : byte(type);
+  writeMessage(status, inMidi.getData1(), inMidi.getData2(), inNowMicros);
+}
+
+/*! \brief Record a message, from its status and data bytes.
+  System Common and Real Time messages are written as escape events.
+*/
+template<class Sink, unsigned BlockSize>
+inline void SmfWriter<Sink, BlockSize>::writeMessage(byte inStatus,
+    byte inData1,
+    byte inData2,
+    unsigned long inNowMicros)
+{
+  if (!mRecording || inStatus < 0x80 || inStatus == SystemExclusive)
+  {
+    return;
+  }
+
+  const byte size = Smf::getDataSize(inStatus);
+  writeDelta(inNowMicros);
+  if (inStatus < SystemExclusive)
+  {
+    if (inStatus != mRunningStatus)
+    {
+      mRunningStatus = inStatus;
+      put(inStatus);
+    }
+  }
+  else
+  {
+    mRunningStatus = 0;
+    put(Smf::Escape);
+    put(1 + size);
+    put(inStatus);
+  }
+  if (size > 0) put(inData1 & 0x7f);
+  if (size > 1) put(inData2 & 0x7f);
+  mEventCount++;
+}
+
+/*! \brief Record a SysEx frame, with or without its 0xf0 / 0xf7 boundaries. */
+template<class Sink, unsigned BlockSize>
+inline void SmfWriter<Sink, BlockSize>::writeSysEx(const byte* inData,
+    unsigned inLength,
+    unsigned long inNowMicros)
+{
+  if (!mRecording)
+  {
+    return;
+  }
+  if (inLength > 0 && inData[0] == 0xf0)
+  {
+    inData++;
+    inLength--;
+  }
+  const bool terminated = inLength > 0 && inData[inLength - 1] == 0xf7;
+
+  writeDelta(inNowMicros);
+  mRunningStatus = 0;
+  put(SystemExclusive);
+  putNumber(terminated ? inLength : inLength + 1); // 0xf7 included
+  for (unsigned i = 0; i < inLength; ++i)
+  {
+    put(inData[i]);
+  }
+  if (!terminated)
+  {
+    put(0xf7);
+  }
+  mEventCount++;
+}
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Record Real Time messages (Clock, Start...) too, off by default. */
+template<class Sink, unsigned BlockSize>
+inline void SmfWriter<Sink, BlockSize>::setRecordRealTime(bool inRecord)
+{
+  mRecordRealTime = inRecord;
+}
+
+template<class Sink, unsigned BlockSize>
+inline bool SmfWriter<Sink, BlockSize>::isRecording() const
+{
+  return mRecording;
+}
+
+/*! \brief The Sink failed to write (eg: disk full), the file is incomplete. */
+template<class Sink, unsigned BlockSize>
+inline bool SmfWriter<Sink, BlockSize>::hasError() const
+{
+  return mError;
+}
+
+template<class Sink, unsigned BlockSize>
+inline unsigned long SmfWriter<Sink, BlockSize>::getEventCount() const
+{
+  return mEventCount;
+}
+
+/*! \brief Size of the file so far, the block not written yet included. */
+template<class Sink, unsigned BlockSize>
+inline unsigned long SmfWriter<Sink, BlockSize>::getSize() const
+{
+  return mBlockOffset + mBlockUsed;
+}
+
+// -----------------------------------------------------------------------------
+
+// Ticks are computed from the time since an anchor rather than accumulated
+// from one event to the next, so rounding errors don't add up. The anchor is
+// moved forward when it gets old, as micros() wraps around every 71 minutes
+// (silences must be shorter than that).
+template<class Sink, unsigned BlockSize>
+inline void SmfWriter<Sink, BlockSize>::writeDelta(unsigned long inNowMicros)
+{
+  const unsigned long elapsed = inNowMicros - mAnchorTime;
+  const unsigned long ticks   = (unsigned long)((uint64_t)elapsed * mDivision / mTempo);
+  const unsigned long tick    = mAnchorTick + ticks;
+  if (elapsed >= 0x40000000UL)
+  {
+    mAnchorTime += (unsigned long)((uint64_t)ticks * mTempo / mDivision);
+    mAnchorTick  = tick;
+  }
+
+  putNumber(tick > mLastTick ? tick - mLastTick : 0);
+  mLastTick = tick > mLastTick ? tick : mLastTick;
+}
+
+template<class Sink, unsigned BlockSize>
+inline void SmfWriter<Sink, BlockSize>::writeTempoTrackEvents()
+{
+  put(0); put(Smf::Meta); put(Smf::Tempo); put(3);
+  put(byte(mTempo >> 16));
+  put(byte(mTempo >> 8));
+  put(byte(mTempo));
+
+  // 4/4, 24 MIDI clocks per metronome click, 8 32nd notes per quarter note.
+  put(0); put(Smf::Meta); put(Smf::TimeSignature); put(4);
+  put(4); put(2); put(24); put(8);
+}
+
+template<class Sink, unsigned BlockSize>
+inline void SmfWriter<Sink, BlockSize>::put(byte inByte)
+{
+  mBlock[mBlockUsed++] = inByte;
+  if (mBlockUsed == BlockSize)
+  {
+    flushBlock();
+  }
+}
+
+// Variable length quantity: 7 bits per byte, most significant first.
+template<class Sink, unsigned BlockSize>
+inline void SmfWriter<Sink, BlockSize>::putNumber(unsigned long inValue)
+{
+  if (inValue > 0x0fffffffUL)
+  {
+    inValue = 0x0fffffffUL; // 4 bytes at most
+  }
+  byte shift = 21;
+  while (shift > 0 && (inValue >> shift) == 0)
+  {
+    shift -= 7;
+  }
+  for (; shift > 0; shift -= 7)
+  {
+    put(byte(((inValue >> shift) & 0x7f) | 0x80));
+  }
+  put(byte(inValue & 0x7f));
+}
+
+template<class Sink, unsigned BlockSize>
+inline void SmfWriter<Sink, BlockSize>::putUInt32(unsigned long inValue)
+{
+  put(byte(inValue >> 24));
+  put(byte(inValue >> 16));
+  put(byte(inValue >> 8));
+  put(byte(inValue));
+}
+
+template<class Sink, unsigned BlockSize>
+inline void SmfWriter<Sink, BlockSize>::flushBlock()
+{
+  if (mBlockUsed == 0)
+  {
+    return;
+  }
+  if (mSink.write(mBlockOffset, mBlock, mBlockUsed) != mBlockUsed)
+  {
+    mError = true;
+  }
+  mBlockOffset += mBlockUsed;
+  mBlockUsed = 0;
+}
+
+END_MIDI_NAMESPACE
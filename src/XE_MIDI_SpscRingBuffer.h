@@ -0,0 +1,103 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#pragma once
+
+#include "XE_MIDI_Namespace.h"
+#include <string.h>
+
+#if defined(__AVR__)
+#include <util/atomic.h>
+#else
+#include <atomic>
+#endif
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief Single producer / single consumer lock-free ring buffer.
+
+  Safe to share between an interrupt handler and the main loop, or between
+  two threads on a host, as long as one side only writes and the other side
+  only reads. Indices run freely and are masked on access, so Size must be a
+  power of two, and all Size slots can be used.
+
+  Unlike RingBuffer, data is never overwritten: writes that don't fit are
+  dropped and counted, see getOverflowCount.
+  Bulk transfers are done with at most two memcpy calls, DataType must be
+  trivially copyable.
+
+  The region API gives direct access to the storage, for DMA or system calls
+  that fill or drain the buffer without intermediate copies:
+  \code
+  byte* region;
+  const unsigned space = buffer.writeRegion(region);
+  buffer.commitWrite(::read(fd, region, space));
+  \endcode
+*/
+template<typename DataType, unsigned Size>
+class SpscRingBuffer
+{
+  public:
+    inline SpscRingBuffer();
+
+  public: // Producer side
+    inline bool write(DataType inData);
+    inline unsigned write(const DataType* inData, unsigned inSize);
+    inline unsigned getFreeSpace() const;
+    inline bool isFull() const;
+    inline unsigned getOverflowCount() const;
+    inline unsigned writeRegion(DataType*& outRegion);
+    inline void commitWrite(unsigned inCount);
+
+  public: // Consumer side
+    inline bool read(DataType& outData);
+    inline DataType read();
+    inline unsigned read(DataType* outData, unsigned inSize);
+    inline unsigned getLength() const;
+    inline bool isEmpty() const;
+    inline void clear();
+    inline unsigned readRegion(const DataType*& outRegion) const;
+    inline void consume(unsigned inCount);
+
+  private:
+#if defined(__AVR__)
+    typedef volatile unsigned Index;
+#else
+    typedef std::atomic<unsigned> Index;
+#endif
+
+    static inline unsigned loadAcquire(const Index& inIndex);
+    static inline void storeRelease(Index& outIndex, unsigned inValue);
+
+    static const unsigned sMask = Size - 1;
+
+    // Compile-time check: Size must be a (non-zero) power of two.
+    typedef char SizeMustBeAPowerOfTwo[(Size != 0 && (Size & sMask) == 0) ? 1 : -1];
+
+  private:
+    DataType mData[Size];
+    Index mWriteIndex;    ///< Only modified by the producer.
+    Index mReadIndex;     ///< Only modified by the consumer.
+    Index mOverflowCount; ///< Only modified by the producer.
+};
+
+END_MIDI_NAMESPACE
+
+#include "XE_MIDI_SpscRingBuffer.hpp"
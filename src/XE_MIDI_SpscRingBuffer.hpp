@@ -0,0 +1,261 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#pragma once
+
+BEGIN_MIDI_NAMESPACE
+
+template<typename DataType, unsigned Size>
+inline SpscRingBuffer<DataType, Size>::SpscRingBuffer()
+  : mWriteIndex(0)
+  , mReadIndex(0)
+  , mOverflowCount(0)
+{
+}
+
+// -----------------------------------------------------------------------------
+
+#if defined(__AVR__)
+
+// 16 bit accesses are not atomic on AVR, interrupts are held off around
+// them. ATOMIC_BLOCK also acts as a compiler memory barrier.
+template<typename DataType, unsigned Size>
+inline unsigned SpscRingBuffer<DataType, Size>::loadAcquire(const Index& inIndex)
+{
+  unsigned value;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    value = inIndex;
+  }
+  return value;
+}
+
+template<typename DataType, unsigned Size>
+inline void SpscRingBuffer<DataType, Size>::storeRelease(Index& outIndex, unsigned inValue)
+{
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    outIndex = inValue;
+  }
+}
+
+#else
+
+template<typename DataType, unsigned Size>
+inline unsigned SpscRingBuffer<DataType, Size>::loadAcquire(const Index& inIndex)
+{
+  return inIndex.load(std::memory_order_acquire);
+}
+
+template<typename DataType, unsigned Size>
+inline void SpscRingBuffer<DataType, Size>::storeRelease(Index& outIndex, unsigned inValue)
+{
+  outIndex.store(inValue, std::memory_order_release);
+}
+
+#endif
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Write one element.
+  \return False if the buffer was full, the element is then dropped.
+*/
+template<typename DataType, unsigned Size>
+inline bool SpscRingBuffer<DataType, Size>::write(DataType inData)
+{
+  const unsigned writeIndex = loadAcquire(mWriteIndex);
+  if (writeIndex - loadAcquire(mReadIndex) == Size)
+  {
+    storeRelease(mOverflowCount, loadAcquire(mOverflowCount) + 1);
+    return false;
+  }
+
+  mData[writeIndex & sMask] = inData;
+  storeRelease(mWriteIndex, writeIndex + 1);
+  return true;
+}
+
+/*! \brief Write as many elements as possible from an array.
+  \return The number of elements written, the others are dropped.
+*/
+template<typename DataType, unsigned Size>
+inline unsigned SpscRingBuffer<DataType, Size>::write(const DataType* inData,
+                                                       unsigned inSize)
+{
+  const unsigned writeIndex = loadAcquire(mWriteIndex);
+  const unsigned freeSpace  = Size - (writeIndex - loadAcquire(mReadIndex));
+  const unsigned count      = inSize < freeSpace ? inSize : freeSpace;
+
+  if (count < inSize)
+  {
+    storeRelease(mOverflowCount, loadAcquire(mOverflowCount) + (inSize - count));
+  }
+
+  // Up to the end of the storage, then from its start.
+  const unsigned offset = writeIndex & sMask;
+  const unsigned first  = count < Size - offset ? count : Size - offset;
+  memcpy(mData + offset, inData, first * sizeof(DataType));
+  memcpy(mData, inData + first, (count - first) * sizeof(DataType));
+
+  storeRelease(mWriteIndex, writeIndex + count);
+  return count;
+}
+
+template<typename DataType, unsigned Size>
+inline unsigned SpscRingBuffer<DataType, Size>::getFreeSpace() const
+{
+  return Size - getLength();
+}
+
+template<typename DataType, unsigned Size>
+inline bool SpscRingBuffer<DataType, Size>::isFull() const
+{
+  return getLength() == Size;
+}
+
+/*! \brief Number of elements dropped because the buffer was full,
+  since construction. Can be polled from the consumer side.
+*/
+template<typename DataType, unsigned Size>
+inline unsigned SpscRingBuffer<DataType, Size>::getOverflowCount() const
+{
+  return loadAcquire(mOverflowCount);
+}
+
+/*! \brief Get the largest contiguous free region, to be filled in place.
+  \param outRegion Set to the start of the region.
+  \return The number of elements that can be written there, which can be
+  less than getFreeSpace when the free space wraps around the storage end.
+  Call commitWrite with the number of elements actually written.
+*/
+template<typename DataType, unsigned Size>
+inline unsigned SpscRingBuffer<DataType, Size>::writeRegion(DataType*& outRegion)
+{
+  const unsigned writeIndex = loadAcquire(mWriteIndex);
+  const unsigned freeSpace  = Size - (writeIndex - loadAcquire(mReadIndex));
+  const unsigned offset     = writeIndex & sMask;
+
+  outRegion = mData + offset;
+  return freeSpace < Size - offset ? freeSpace : Size - offset;
+}
+
+/*! \brief Publish elements written in the region given by writeRegion.
+*/
+template<typename DataType, unsigned Size>
+inline void SpscRingBuffer<DataType, Size>::commitWrite(unsigned inCount)
+{
+  storeRelease(mWriteIndex, loadAcquire(mWriteIndex) + inCount);
+}
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Read one element.
+  \return False if the buffer was empty.
+*/
+template<typename DataType, unsigned Size>
+inline bool SpscRingBuffer<DataType, Size>::read(DataType& outData)
+{
+  const unsigned readIndex = loadAcquire(mReadIndex);
+  if (readIndex == loadAcquire(mWriteIndex))
+    return false;
+
+  outData = mData[readIndex & sMask];
+  storeRelease(mReadIndex, readIndex + 1);
+  return true;
+}
+
+/*! \brief Read one element, the buffer must not be empty
+  (same contract as RingBuffer::read).
+*/
+template<typename DataType, unsigned Size>
+inline DataType SpscRingBuffer<DataType, Size>::read()
+{
+  const unsigned readIndex = loadAcquire(mReadIndex);
+  const DataType data = mData[readIndex & sMask];
+  storeRelease(mReadIndex, readIndex + 1);
+  return data;
+}
+
+/*! \brief Read up to inSize elements into an array.
+  \return The number of elements read.
+*/
+template<typename DataType, unsigned Size>
+inline unsigned SpscRingBuffer<DataType, Size>::read(DataType* outData, unsigned inSize)
+{
+  const unsigned readIndex = loadAcquire(mReadIndex);
+  const unsigned length    = loadAcquire(mWriteIndex) - readIndex;
+  const unsigned count     = inSize < length ? inSize : length;
+
+  const unsigned offset = readIndex & sMask;
+  const unsigned first  = count < Size - offset ? count : Size - offset;
+  memcpy(outData, mData + offset, first * sizeof(DataType));
+  memcpy(outData + first, mData, (count - first) * sizeof(DataType));
+
+  storeRelease(mReadIndex, readIndex + count);
+  return count;
+}
+
+template<typename DataType, unsigned Size>
+inline unsigned SpscRingBuffer<DataType, Size>::getLength() const
+{
+  return loadAcquire(mWriteIndex) - loadAcquire(mReadIndex);
+}
+
+template<typename DataType, unsigned Size>
+inline bool SpscRingBuffer<DataType, Size>::isEmpty() const
+{
+  return getLength() == 0;
+}
+
+/*! \brief Discard all pending elements (consumer side).
+*/
+template<typename DataType, unsigned Size>
+inline void SpscRingBuffer<DataType, Size>::clear()
+{
+  storeRelease(mReadIndex, loadAcquire(mWriteIndex));
+}
+
+/*! \brief Get the largest contiguous region of pending elements, to be
+  processed in place.
+  \param outRegion Set to the start of the region.
+  \return The number of elements available there, which can be less than
+  getLength when the data wraps around the storage end.
+  Call consume with the number of elements actually processed.
+*/
+template<typename DataType, unsigned Size>
+inline unsigned SpscRingBuffer<DataType, Size>::readRegion(const DataType*& outRegion) const
+{
+  const unsigned readIndex = loadAcquire(mReadIndex);
+  const unsigned length    = loadAcquire(mWriteIndex) - readIndex;
+  const unsigned offset    = readIndex & sMask;
+
+  outRegion = mData + offset;
+  return length < Size - offset ? length : Size - offset;
+}
+
+/*! \brief Release elements processed in the region given by readRegion.
+*/
+template<typename DataType, unsigned Size>
+inline void SpscRingBuffer<DataType, Size>::consume(unsigned inCount)
+{
+  storeRelease(mReadIndex, loadAcquire(mReadIndex) + inCount);
+}
+
+END_MIDI_NAMESPACE
@@ -0,0 +1,216 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#pragma once
+
+#include "XE_MIDI_Defs.h"
+
+BEGIN_MIDI_NAMESPACE
+
+// -----------------------------------------------------------------------------
+// Statistics policies, see DefaultSettings::Statistics.
+// MidiInterface calls the on... hooks as it parses and sends, the policy
+// decides what to keep.
+
+/*! \brief No statistics (default): the hooks are empty and optimised out.
+*/
+struct NoStatistics
+{
+  inline void reset() {}
+
+  inline void onByteReceived() {}
+  inline void onMessageReceived(MidiType) {}
+  inline void onMessageSent(MidiType, unsigned) {}
+  inline void onRunningStatusReceived() {}
+  inline void onRunningStatusSent() {}
+  inline void onParseError() {}
+  inline void onSysExOverflow() {}
+  inline void onThru() {}
+
+  template<class Output> inline void writeText(Output&) const {}
+  template<class Output> inline void writeSysEx(Output&) const {}
+};
+
+/*! \brief Counters of the traffic seen by a MidiInterface.
+
+  Enable them with a custom Settings:
+  \code
+  struct MySettings : public midi::DefaultSettings
+  {
+    typedef midi::MidiStatistics Statistics;
+  };
+  \endcode
+  then read them with MidiInterface::getStatistics (a snapshot), and clear
+  them with resetStatistics. They use 212 bytes of RAM.
+  Overflows of the transport buffers are not seen by the interface, see the
+  transport (eg: UsbTransport::getOverflowCount).
+*/
+struct MidiStatistics
+{
+  /*! 32 bits on all targets, so that reports have the same format. */
+  typedef uint32_t Counter;
+
+  static const byte sCounterDigits   = 10; ///< Decimal digits of the largest Counter.
+  static const byte sCounterSeptets  = 5;  ///< 7-bit groups of a Counter in writeSysEx.
+
+  /*! Message types are counted in 23 slots: 7 channel messages, then the
+    16 system status bytes (0xf0 to 0xff).
+  */
+  static const unsigned sTypeCount = 23;
+
+  static inline unsigned getTypeIndex(MidiType inType)
+  {
+    return inType < 0xf0 ? (inType >> 4) - 8 : (inType & 0x0f) + 7;
+  }
+
+  inline MidiStatistics()
+  {
+    reset();
+  }
+
+  inline void reset()
+  {
+    memset(this, 0, sizeof(MidiStatistics));
+  }
+
+  inline void onByteReceived()                  { bytesReceived++; }
+  inline void onMessageReceived(MidiType inType) { messagesReceived[getTypeIndex(inType)]++; }
+  inline void onMessageSent(MidiType inType, unsigned inSize)
+  {
+    messagesSent[getTypeIndex(inType)]++;
+    bytesSent += inSize;
+  }
+  inline void onRunningStatusReceived()         { runningStatusReceived++; }
+  inline void onRunningStatusSent()             { runningStatusSaved++; }
+  inline void onParseError()                    { parseErrors++; }
+  inline void onSysExOverflow()                 { sysExOverflows++; }
+  inline void onThru()                          { thruMessages++; }
+
+  template<class Output> inline void writeText(Output& ioOutput) const;
+  template<class Output> inline void writeSysEx(Output& ioOutput) const;
+
+  Counter bytesReceived;
+  Counter bytesSent;
+  Counter messagesReceived[sTypeCount];
+  Counter messagesSent[sTypeCount];
+  Counter runningStatusReceived;  ///< Messages received without status byte.
+  Counter runningStatusSaved;     ///< Status bytes not sent thanks to Running Status.
+  Counter parseErrors;            ///< Unexpected bytes that reset the parser.
+  Counter sysExOverflows;         ///< SysEx frames dropped, larger than Settings::SysExMaxSize.
+  Counter thruMessages;           ///< Messages forwarded by the soft thru.
+
+  /*! SysEx sub-ID used by writeSysEx, after the non-commercial ID (0x7d). */
+  static const byte sSysExId = 0x53;
+
+  // Compile-time check: the report formats hold a whole Counter.
+  typedef char CounterSizeCheck[(sizeof(Counter) == 4 && sCounterSeptets * 7 >= 32) ? 1 : -1];
+};
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Write a text report, one "name value" line per non-null counter.
+  \param ioOutput Any object with a write(byte) method, like a serial port.
+*/
+template<class Output>
+inline void MidiStatistics::writeText(Output& ioOutput) const
+{
+  struct Writer
+  {
+    static void text(Output& ioOutput, const char* inText)
+    {
+      while (*inText)
+      {
+        ioOutput.write(byte(*inText++));
+      }
+    }
+    static void line(Output& ioOutput, const char* inName, byte inIndex, Counter inValue)
+    {
+      if (inValue == 0)
+        return;
+
+      text(ioOutput, inName);
+      if (inIndex != 0)
+      {
+        static const char hex[] = "0123456789abcdef";
+        text(ioOutput, " 0x");
+        ioOutput.write(byte(hex[inIndex >> 4]));
+        ioOutput.write(byte(hex[inIndex & 0x0f]));
+      }
+      ioOutput.write(byte(' '));
+
+      char digits[sCounterDigits];
+      byte count = 0;
+      do
+      {
+        digits[count++] = char('0' + inValue % 10);
+        inValue /= 10;
+      }
+      while (inValue != 0);
+      while (count != 0)
+      {
+        ioOutput.write(byte(digits[--count]));
+      }
+      ioOutput.write(byte('\n'));
+    }
+  };
+
+  Writer::line(ioOutput, "bytes_in",       0, bytesReceived);
+  Writer::line(ioOutput, "bytes_out",      0, bytesSent);
+  for (byte i = 0; i < sTypeCount; ++i)
+  {
+    // Message types are reported by status (channel nibble cleared).
+    const byte status = i < 7 ? (i + 8) << 4 : 0xf0 + i - 7;
+    Writer::line(ioOutput, "in",  status, messagesReceived[i]);
+    Writer::line(ioOutput, "out", status, messagesSent[i]);
+  }
+  Writer::line(ioOutput, "running_status_in",    0, runningStatusReceived);
+  Writer::line(ioOutput, "running_status_saved", 0, runningStatusSaved);
+  Writer::line(ioOutput, "parse_errors",         0, parseErrors);
+  Writer::line(ioOutput, "sysex_overflows",      0, sysExOverflows);
+  Writer::line(ioOutput, "thru",                 0, thruMessages);
+}
+
+/*! \brief Write the counters as a SysEx frame:
+  F0 7D 53 [counter x 5 bytes]... F7, in declaration order, each 32-bit
+  counter as five 7-bit groups (least significant first).
+  \param ioOutput Any object with a write(byte) method, like a serial port.
+*/
+template<class Output>
+inline void MidiStatistics::writeSysEx(Output& ioOutput) const
+{
+  ioOutput.write(0xf0);
+  ioOutput.write(0x7d);
+  ioOutput.write(sSysExId);
+
+  const Counter* counters = &bytesReceived;
+  const unsigned count = sizeof(MidiStatistics) / sizeof(Counter);
+  for (unsigned i = 0; i < count; ++i)
+  {
+    Counter value = counters[i];
+    for (byte j = 0; j < sCounterSeptets; ++j)
+    {
+      ioOutput.write(byte(value & 0x7f));
+      value >>= 7;
+    }
+  }
+  ioOutput.write(0xf7);
+}
+
+END_MIDI_NAMESPACE
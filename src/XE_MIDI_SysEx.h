@@ -0,0 +1,219 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#pragma once
+
+#include "XE_MIDI_Defs.h"
+
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+#endif
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief Incremental 7-bit SysEx encoder.
+  Packs 8-bit data on the fly, in the same format as encodeSysEx, writing
+  each 8-byte block to an output as soon as it is complete. Only one block
+  is held in memory, whatever the size of the data.
+  The output can be any object with a write(byte) method, like a serial port.
+  @see encodeSysEx
+*/
+class SysExEncoder
+{
+  public:
+    inline SysExEncoder()
+    {
+      reset();
+    }
+
+  public:
+    inline void reset()
+    {
+      mBlock[0] = 0;
+      mCount    = 0;
+      mMask     = 0x40;
+    }
+
+    /*! Add a data byte, and write the current block when full. */
+    template<class Output>
+    inline void write(byte inData, Output& ioOutput)
+    {
+      if (inData & 0x80)
+      {
+        mBlock[0] |= mMask;
+      }
+      mBlock[++mCount] = inData & 0x7f;
+      mMask >>= 1;
+
+      if (mCount == 7)
+      {
+        flush(ioOutput);
+      }
+    }
+
+    /*! Write the pending (possibly incomplete) block, if any. */
+    template<class Output>
+    inline void flush(Output& ioOutput)
+    {
+      if (mCount != 0)
+      {
+        for (byte i = 0; i <= mCount; ++i)
+        {
+          ioOutput.write(mBlock[i]);
+        }
+      }
+      reset();
+    }
+
+  private:
+    byte mBlock[8];
+    byte mCount;
+    byte mMask;
+};
+
+// -----------------------------------------------------------------------------
+// SysEx checksum policies, see DefaultSettings::SysExChecksum.
+// Each policy accumulates data bytes with update(), and get() returns the
+// 7-bit checksum byte to append to (or expect at the end of) the frame.
+
+/*! \brief No checksum (default): costs nothing. */
+struct NoChecksum
+{
+  static const unsigned Size = 0;
+
+  inline void reset() {}
+  inline void update(byte) {}
+  inline byte get() const { return 0; }
+};
+
+/*! \brief Roland checksum: the sum of the checksum and the covered bytes
+  is a multiple of 128. Covers the address & data in DT1 / RQ1 messages.
+*/
+struct RolandChecksum
+{
+  static const unsigned Size = 1;
+
+  inline RolandChecksum() : mSum(0) {}
+  inline void reset() { mSum = 0; }
+  inline void update(byte inData) { mSum += inData; }
+  inline byte get() const { return (0x80 - (mSum & 0x7f)) & 0x7f; }
+
+  byte mSum;
+};
+
+/*! \brief Exclusive OR of the covered bytes, as used by the Sample Dump
+  Standard and many manufacturers.
+*/
+struct XorChecksum
+{
+  static const unsigned Size = 1;
+
+  inline XorChecksum() : mValue(0) {}
+  inline void reset() { mValue = 0; }
+  inline void update(byte inData) { mValue ^= inData; }
+  inline byte get() const { return mValue & 0x7f; }
+
+  byte mValue;
+};
+
+/*! \brief 7-bit CRC (polynomial x^7 + x^3 + 1), fits in a single data byte
+  and catches more errors than a sum.
+*/
+struct Crc7Checksum
+{
+  static const unsigned Size = 1;
+
+  inline Crc7Checksum() : mCrc(0) {}
+  inline void reset() { mCrc = 0; }
+  inline void update(byte inData)
+  {
+    // CRC kept in the 7 upper bits.
+    mCrc ^= inData;
+    for (byte i = 0; i < 8; ++i)
+    {
+      mCrc = (mCrc & 0x80) ? byte(mCrc << 1) ^ 0x12 : byte(mCrc << 1);
+    }
+  }
+  inline byte get() const { return mCrc >> 1; }
+
+  byte mCrc;
+};
+
+/*! \brief Output adapter updating a checksum with the bytes written
+  from a given position in the frame, 0xf0 being at position 0.
+*/
+template<class Output, class Checksum>
+class SysExChecksumWriter
+{
+  public:
+    inline SysExChecksumWriter(Output& ioOutput,
+                               Checksum& ioChecksum,
+                               unsigned& ioPosition,
+                               unsigned inOffset)
+      : mOutput(ioOutput)
+      , mChecksum(ioChecksum)
+      , mPosition(ioPosition)
+      , mOffset(inOffset)
+    {
+    }
+
+  public:
+    inline void write(byte inData)
+    {
+      if (Checksum::Size != 0 && mPosition >= mOffset)
+      {
+        mChecksum.update(inData);
+      }
+      mPosition++;
+      mOutput.write(inData);
+    }
+
+  private:
+    Output& mOutput;
+    Checksum& mChecksum;
+    unsigned& mPosition;
+    const unsigned mOffset;
+};
+
+// -----------------------------------------------------------------------------
+
+#if defined(__AVR__)
+
+/*! \brief Data source reading from program memory (PROGMEM) on AVR,
+  for use with MidiInterface::sendSysExEncoded & co. Other architectures map
+  their flash memory in the address space, so plain pointers can be used.
+*/
+struct ProgmemSource
+{
+  inline ProgmemSource(const byte* inData)
+    : mData(inData)
+  {
+  }
+
+  inline byte operator[](unsigned inIndex) const
+  {
+    return pgm_read_byte(mData + inIndex);
+  }
+
+  const byte* mData;
+};
+
+#endif
+
+END_MIDI_NAMESPACE
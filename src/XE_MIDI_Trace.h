@@ -0,0 +1,145 @@
+/*
+  This file is part of the XE_MIDI library.
+  Copyright (c) 2021-2022 Xander Electronics. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 3.0 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#pragma once
+
+#include "XE_MIDI_Defs.h"
+#include "XE_MIDI_Latency.h"
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief Events recorded by tracers, as begin / end pairs. */
+struct TraceEvent
+{
+  enum Event
+  {
+    Parse = 0,  ///< First byte of a message read -> message complete.
+    Callback,   ///< Input callback dispatch.
+    Thru,       ///< Soft thru forwarding.
+    Send,       ///< Message written to the transport.
+    Count,
+  };
+
+  enum Phase
+  {
+    Begin = 0,
+    End,
+  };
+};
+
+// -----------------------------------------------------------------------------
+// Tracer policies, see DefaultSettings::Tracer.
+
+/*! \brief No tracing (default): costs nothing. */
+struct NoTracer
+{
+  inline void begin(TraceEvent::Event, byte) {}
+  inline void end(TraceEvent::Event, byte) {}
+};
+
+/*! \brief Records the last Size trace events in a ring, timed with Clock
+  (MicrosClock on Arduino, SteadyClock on host).
+
+  Enable it with a custom Settings:
+  \code
+  struct MySettings : public midi::DefaultSettings
+  {
+    typedef midi::TraceRing<midi::MicrosClock, 64> Tracer;
+  };
+  \endcode
+  Each record takes sizeof(Record) bytes: 7 on AVR, 8 on 32-bit ARM, 16 on
+  64-bit hosts. The argument of each event is the message type (status
+  byte, channel nibble cleared) when known, 0 otherwise. Parse events nest
+  when a Real Time message is read inside another message, and the ones of
+  dropped messages end with a 0 argument.
+  Read the ring with MidiInterface::getTracer, see extras/host/ChromeTrace.h
+  to export it for chrome://tracing or the Perfetto UI.
+*/
+template<class Clock, unsigned Size = 64>
+class TraceRing
+{
+  public:
+    struct Record
+    {
+      unsigned long mTime;  ///< Microseconds, from Clock.
+      byte mEvent;          ///< TraceEvent::Event
+      byte mPhase;          ///< TraceEvent::Phase
+      byte mArgument;
+    };
+
+  public:
+    inline TraceRing()
+      : mWriteIndex(0)
+      , mCount(0)
+    {
+    }
+
+    inline void clear()
+    {
+      mWriteIndex = 0;
+      mCount      = 0;
+    }
+
+    inline void begin(TraceEvent::Event inEvent, byte inArgument)
+    {
+      record(inEvent, TraceEvent::Begin, inArgument);
+    }
+
+    inline void end(TraceEvent::Event inEvent, byte inArgument)
+    {
+      record(inEvent, TraceEvent::End, inArgument);
+    }
+
+    /*! Number of records available, at most Size. */
+    inline unsigned getCount() const
+    {
+      return mCount;
+    }
+
+    /*! Get a record, 0 being the oldest one still in the ring. */
+    inline const Record& get(unsigned inIndex) const
+    {
+      const unsigned first = mCount < Size ? 0 : mWriteIndex;
+      return mRecords[(first + inIndex) % Size];
+    }
+
+  private:
+    inline void record(TraceEvent::Event inEvent, byte inPhase, byte inArgument)
+    {
+      Record& entry   = mRecords[mWriteIndex];
+      entry.mTime     = Clock::now();
+      entry.mEvent    = inEvent;
+      entry.mPhase    = inPhase;
+      entry.mArgument = inArgument;
+
+      mWriteIndex = (mWriteIndex + 1) % Size;
+      if (mCount < Size)
+      {
+        mCount++;
+      }
+    }
+
+  private:
+    Record mRecords[Size];
+    unsigned mWriteIndex;
+    unsigned mCount;
+};
+
+END_MIDI_NAMESPACE
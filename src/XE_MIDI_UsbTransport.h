@@ -20,12 +20,27 @@
 #pragma once
 
 #include "XE_MIDI_Defs.h"
-#include "XE_MIDI_RingBuffer.h"
+#include "XE_MIDI_SpscRingBuffer.h"
+#include "XE_MIDI_UsbDefs.h"
 #include <MIDIUSB.h>
 
 BEGIN_MIDI_NAMESPACE
 
-template<unsigned BuffersSize>
+/*! \brief USB-MIDI transport, to use MidiInterface with native USB boards.
+
+  Outgoing bytes are packed into correctly classified USB-MIDI event packets,
+  which are collected until a full 64-byte bulk endpoint transfer is ready.
+  Call flush() once per loop to send the remaining ones.
+  SysEx is packetized on the fly (CIN 0x4 to 0x7), so dumps of any length are
+  sent at the USB link rate without being buffered.
+
+  The transport can expose up to 16 virtual cables (ports) to the host:
+  incoming packets are routed to per-cable buffers by their cable number, and
+  each cable has its own packetizer. The Serial API addresses cable 0, use
+  UsbCable to bind a MidiInterface to another cable.
+  BuffersSize (per cable receive buffer) must be a power of two.
+*/
+template<unsigned BuffersSize, unsigned NumCables = 1>
 class UsbTransport
 {
   public:
@@ -38,27 +53,72 @@ class UsbTransport
     inline byte read();
     inline void write(byte inData);
 
+  public: // Cable API
+    inline unsigned available(byte inCable);
+    inline byte read(byte inCable);
+    inline void write(byte inData, byte inCable);
+    inline unsigned getOverflowCount() const;
+
+  public: // Packet API, see MidiInterface::read(const UsbMidiEventPacket&)
+    inline bool readPacket(UsbMidiEventPacket& outPacket);
+    inline void flush();
+
   private:
+    struct TxState
+    {
+      UsbMidiEventPacket mPacket;
+      byte mByteIndex;
+      byte mLength;
+      byte mCodeIndexNumber;
+      StatusByte mRunningStatus;
+    };
+
     inline bool pollUsbMidi();
-    inline void recomposeAndSendTxPackets();
-    inline void resetTx();
-    static inline byte encodePacketHeader(StatusByte inStatusByte);
-    static inline int getPacketLength(const midiEventPacket_t& inPacket);
+    inline void resetTx(TxState& ioState);
+    inline void sendTxPacket(TxState& ioState, byte inCable, byte inCodeIndexNumber);
+    inline void sendTxPackets();
 
   private:
-    typedef RingBuffer<byte, BuffersSize> Buffer;
-    Buffer mTxBuffer;
-    Buffer mRxBuffer;
+    typedef SpscRingBuffer<byte, BuffersSize> Buffer;
+    Buffer mRxBuffers[NumCables];
+    TxState mTxStates[NumCables];
 
-    union TxPacket
-    {
-      byte mDataArray[4];
-      midiEventPacket_t mPacket;
-    };
-    TxPacket mCurrentTxPacket;
-    int mCurrentTxPacketByteIndex;
+    // A full-speed bulk endpoint transfer holds 16 packets (64 bytes).
+    static const unsigned sTxPacketCount = 16;
+
+    UsbMidiEventPacket mTxPackets[sTxPacketCount];
+    unsigned mTxPacketCount;
+};
+
+// -----------------------------------------------------------------------------
+
+/*! \brief One virtual cable of a UsbTransport, usable as a MidiInterface port.
+
+  Example, for a second port:
+  \code
+  typedef midi::UsbTransport<64, 2> UsbTransport;
+  UsbTransport sUsbTransport;
+  midi::UsbCable<UsbTransport> sUsbCable1(sUsbTransport, 1);
+  MIDI_CREATE_INSTANCE(midi::UsbCable<UsbTransport>, sUsbCable1, MIDI1);
+  \endcode
+*/
+template<class Transport>
+class UsbCable
+{
+  public:
+    inline UsbCable(Transport& inTransport, byte inCable);
+
+  public: // Serial / Stream API required for template compatibility
+    inline void begin(unsigned inBaudrate);
+    inline unsigned available();
+    inline byte read();
+    inline void write(byte inData);
+
+  private:
+    Transport& mTransport;
+    const byte mCable;
 };
 
 END_MIDI_NAMESPACE
 
-#include "midi_UsbTransport.hpp"
+#include "XE_MIDI_UsbTransport.hpp"
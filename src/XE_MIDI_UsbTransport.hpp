@@ -21,51 +21,214 @@
 
 BEGIN_MIDI_NAMESPACE
 
-template<unsigned BufferSize>
-inline UsbTransport<BufferSize>::UsbTransport()
+template<unsigned BufferSize, unsigned NumCables>
+inline UsbTransport<BufferSize, NumCables>::UsbTransport()
+  : mTxPacketCount(0)
 {
-
+  for (unsigned cable = 0; cable < NumCables; ++cable)
+  {
+    resetTx(mTxStates[cable]);
+    mTxStates[cable].mRunningStatus = 0;
+  }
 }
 
-template<unsigned BufferSize>
-inline UsbTransport<BufferSize>::~UsbTransport()
+template<unsigned BufferSize, unsigned NumCables>
+inline UsbTransport<BufferSize, NumCables>::~UsbTransport()
 {
 
 }
 
 // -----------------------------------------------------------------------------
 
-template<unsigned BufferSize>
-inline void UsbTransport<BufferSize>::begin(unsigned inBaudrate)
+template<unsigned BufferSize, unsigned NumCables>
+inline void UsbTransport<BufferSize, NumCables>::begin(unsigned /*inBaudrate*/)
 {
-  mTxBuffer.clear();
-  mRxBuffer.clear();
+  for (unsigned cable = 0; cable < NumCables; ++cable)
+  {
+    mRxBuffers[cable].clear();
+    resetTx(mTxStates[cable]);
+    mTxStates[cable].mRunningStatus = 0;
+  }
+  mTxPacketCount = 0;
 }
 
-template<unsigned BufferSize>
-inline unsigned UsbTransport<BufferSize>::available()
+template<unsigned BufferSize, unsigned NumCables>
+inline unsigned UsbTransport<BufferSize, NumCables>::available()
+{
+  return available(0);
+}
+
+template<unsigned BufferSize, unsigned NumCables>
+inline byte UsbTransport<BufferSize, NumCables>::read()
+{
+  return read(0);
+}
+
+template<unsigned BufferSize, unsigned NumCables>
+inline void UsbTransport<BufferSize, NumCables>::write(byte inData)
+{
+  write(inData, 0);
+}
+
+// -----------------------------------------------------------------------------
+
+template<unsigned BufferSize, unsigned NumCables>
+inline unsigned UsbTransport<BufferSize, NumCables>::available(byte inCable)
 {
   pollUsbMidi();
-  return mRxBuffer.getLength();
+  return mRxBuffers[inCable].getLength();
 }
 
-template<unsigned BufferSize>
-inline byte UsbTransport<BufferSize>::read()
+template<unsigned BufferSize, unsigned NumCables>
+inline byte UsbTransport<BufferSize, NumCables>::read(byte inCable)
 {
-  return mRxBuffer.read();
+  return mRxBuffers[inCable].read();
 }
 
-template<unsigned BufferSize>
-inline void UsbTransport<BufferSize>::write(byte inData)
+template<unsigned BufferSize, unsigned NumCables>
+inline void UsbTransport<BufferSize, NumCables>::write(byte inData, byte inCable)
 {
-  mTxBuffer.write(inData);
-  recomposeAndSendTxPackets();
+  if (inData >= 0xf8)
+  {
+    // Real Time: single byte packet, can be interleaved in any message.
+    UsbMidiEventPacket& packet = mTxPackets[mTxPacketCount];
+    packet.setHeader(inCable, CodeIndexNumbers::singleByte);
+    packet.mData[1] = inData;
+    packet.mData[2] = 0;
+    packet.mData[3] = 0;
+    if (++mTxPacketCount == sTxPacketCount)
+    {
+      sendTxPackets();
+    }
+    return;
+  }
+
+  TxState& state = mTxStates[inCable];
+
+  if (inData == 0xf7)
+  {
+    // End of SysEx: the packet carries the last 1 to 3 bytes.
+    if (state.mRunningStatus == SystemExclusive)
+    {
+      state.mPacket.mData[1 + state.mByteIndex] = inData;
+      sendTxPacket(state, inCable, CodeIndexNumbers::sysExEnds1Byte + state.mByteIndex);
+      state.mRunningStatus = 0;
+    }
+    return;
+  }
+
+  if (inData >= 0x80)
+  {
+    resetTx(state);
+
+    if (inData < 0xf0)
+    {
+      // Channel messages: Code Index Number matches the status nibble.
+      state.mRunningStatus = inData;
+      state.mCodeIndexNumber = inData >> 4;
+      state.mLength = CodeIndexNumbers::getSize(state.mCodeIndexNumber);
+    }
+    else
+    {
+      state.mRunningStatus = 0;
+
+      switch (inData)
+      {
+        case TimeCodeQuarterFrame:
+        case SongSelect:
+          state.mCodeIndexNumber = CodeIndexNumbers::systemCommon2Bytes;
+          break;
+
+        case SongPosition:
+          state.mCodeIndexNumber = CodeIndexNumbers::systemCommon3Bytes;
+          break;
+
+        case TuneRequest:
+          state.mCodeIndexNumber = CodeIndexNumbers::systemCommon1Byte;
+          break;
+
+        case SystemExclusive:
+          // SysEx is sent as it comes, 3 bytes per packet.
+          state.mRunningStatus = SystemExclusive;
+          state.mCodeIndexNumber = CodeIndexNumbers::sysExStart;
+          break;
+
+        default:
+          return; // Undefined
+      }
+      state.mLength = CodeIndexNumbers::getSize(state.mCodeIndexNumber);
+    }
+  }
+  else if (state.mByteIndex == 0)
+  {
+    if (state.mRunningStatus == SystemExclusive)
+    {
+      state.mCodeIndexNumber = CodeIndexNumbers::sysExContinue;
+      state.mLength = 3;
+    }
+    else if (state.mRunningStatus != 0)
+    {
+      // Running Status: USB packets always carry the status byte.
+      state.mCodeIndexNumber = state.mRunningStatus >> 4;
+      state.mLength = CodeIndexNumbers::getSize(state.mCodeIndexNumber);
+      state.mPacket.mData[1] = state.mRunningStatus;
+      state.mByteIndex = 1;
+    }
+    else
+    {
+      return; // Stray data byte
+    }
+  }
+
+  state.mPacket.mData[1 + state.mByteIndex++] = inData;
+
+  if (state.mByteIndex == state.mLength)
+  {
+    sendTxPacket(state, inCable, state.mCodeIndexNumber);
+  }
+}
+
+/*! \brief Number of received bytes dropped because a cable buffer was full.
+*/
+template<unsigned BufferSize, unsigned NumCables>
+inline unsigned UsbTransport<BufferSize, NumCables>::getOverflowCount() const
+{
+  unsigned count = 0;
+  for (unsigned cable = 0; cable < NumCables; ++cable)
+  {
+    count += mRxBuffers[cable].getOverflowCount();
+  }
+  return count;
 }
 
 // -----------------------------------------------------------------------------
 
-template<unsigned BufferSize>
-inline bool UsbTransport<BufferSize>::pollUsbMidi()
+/*! \brief Read the next USB-MIDI event packet, if any.
+
+  To be used with MidiInterface::read(const UsbMidiEventPacket&), which decodes
+  packets as a whole instead of reparsing their bytes. Don't mix it with the
+  byte API (available / read) on the same transport. With several cables,
+  dispatch the packet to the interface matching getCableNumber().
+  \return True if a packet was received.
+*/
+template<unsigned BufferSize, unsigned NumCables>
+inline bool UsbTransport<BufferSize, NumCables>::readPacket(UsbMidiEventPacket& outPacket)
+{
+  const midiEventPacket_t packet = MidiUSB.read();
+  if (packet.header == 0)
+    return false;
+
+  outPacket.mData[0] = packet.header;
+  outPacket.mData[1] = packet.byte1;
+  outPacket.mData[2] = packet.byte2;
+  outPacket.mData[3] = packet.byte3;
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+
+template<unsigned BufferSize, unsigned NumCables>
+inline bool UsbTransport<BufferSize, NumCables>::pollUsbMidi()
 {
   bool received = false;
   midiEventPacket_t packet = MidiUSB.read();
@@ -73,46 +236,29 @@ inline bool UsbTransport<BufferSize>::pollUsbMidi()
   {
     received = true;
 
-    switch (packet.header << 4)
+    // Packets for cables we don't expose are dropped.
+    const byte cable = packet.header >> 4;
+    if (cable < NumCables)
     {
-      // 3 bytes messages
-      case midi::NoteOff:
-      case midi::NoteOn:
-      case midi::AfterTouchPoly:
-      case midi::ControlChange:
-      case midi::PitchBend:
-        mRxBuffer.write(packet.byte1);
-        mRxBuffer.write(packet.byte2);
-        mRxBuffer.write(packet.byte3);
-        break;
-
-      // 2 bytes messages
-      case midi::ProgramChange:
-      case midi::AfterTouchChannel:
-        mRxBuffer.write(packet.byte1);
-        mRxBuffer.write(packet.byte2);
-        break;
-
-      // 1 byte message
-      case midi::TuneRequest:
-      case midi::Clock:
-      case midi::Start:
-      case midi::Continue:
-      case midi::Stop:
-      case midi::ActiveSensing:
-      case midi::SystemReset:
-        mRxBuffer.write(packet.byte1);
-        break;
-
-      // Special cases
-      // case midi::SystemExclusive:
-      // case midi::TimeCodeQuarterFrame:
-      // case midi::SongPosition:
-      // case midi::SongSelect:
-      //   break;
-
-      default:
-        break;
+      // The Code Index Number gives the number of MIDI bytes in the packet,
+      // SysEx start / continue / end included.
+      // They are copied straight into the buffer storage when it has room
+      // for a whole packet, only the meaningful bytes are committed.
+      Buffer& buffer = mRxBuffers[cable];
+      const byte size = CodeIndexNumbers::getSize(packet.header & 0x0f);
+      byte* region;
+      if (buffer.writeRegion(region) >= 3)
+      {
+        region[0] = packet.byte1;
+        region[1] = packet.byte2;
+        region[2] = packet.byte3;
+        buffer.commitWrite(size);
+      }
+      else
+      {
+        const byte data[3] = { packet.byte1, packet.byte2, packet.byte3 };
+        buffer.write(data, size);
+      }
     }
 
     packet = MidiUSB.read();
@@ -120,53 +266,91 @@ inline bool UsbTransport<BufferSize>::pollUsbMidi()
   return received;
 }
 
-template<unsigned BufferSize>
-inline void UsbTransport<BufferSize>::recomposeAndSendTxPackets()
+/*! \brief Send the pending packets to the host.
+
+  Packets are sent by full endpoint transfers (16 packets) as they are
+  written: call this once per loop to send the remaining ones.
+*/
+template<unsigned BufferSize, unsigned NumCables>
+inline void UsbTransport<BufferSize, NumCables>::flush()
 {
-  while (!mTxBuffer.isEmpty())
+  if (mTxPacketCount != 0)
   {
-    const byte data = mTxBuffer.read();
-    if (mCurrentTxPacketByteIndex == 0)
-    {
-      mCurrentTxPacket.mPacket.header = encodePacketHeader(data);
-    }
-    else
-    {
-      mCurrentTxPacket.mDataArray[mCurrentTxPacketByteIndex] = data;
-    }
-    mCurrentTxPacketByteIndex++;
+    sendTxPackets();
+  }
+  MidiUSB.flush();
+}
 
-    const int packetLength = getPacketLength(mCurrentTxPacket.mPacket);
+// -----------------------------------------------------------------------------
 
-    if (mCurrentTxPacketByteIndex == packetLength)
-    {
-      MidiUSB.write(mCurrentTxPacket.mDataArray, packetLength);
-      resetTx();
-    }
+template<unsigned BufferSize, unsigned NumCables>
+inline void UsbTransport<BufferSize, NumCables>::resetTx(TxState& ioState)
+{
+  ioState.mPacket.mData[1] = 0;
+  ioState.mPacket.mData[2] = 0;
+  ioState.mPacket.mData[3] = 0;
+  ioState.mByteIndex = 0;
+  ioState.mLength = 0;
+  ioState.mCodeIndexNumber = 0;
+}
+
+template<unsigned BufferSize, unsigned NumCables>
+inline void UsbTransport<BufferSize, NumCables>::sendTxPacket(TxState& ioState,
+                                                              byte inCable,
+                                                              byte inCodeIndexNumber)
+{
+  ioState.mPacket.setHeader(inCable, inCodeIndexNumber);
+  mTxPackets[mTxPacketCount] = ioState.mPacket;
+  resetTx(ioState);
+
+  if (++mTxPacketCount == sTxPacketCount)
+  {
+    sendTxPackets();
   }
 }
 
-template<unsigned BufferSize>
-inline void UsbTransport<BufferSize>::resetTx()
+template<unsigned BufferSize, unsigned NumCables>
+inline void UsbTransport<BufferSize, NumCables>::sendTxPackets()
+{
+  MidiUSB.write(mTxPackets[0].mData, mTxPacketCount * sizeof(UsbMidiEventPacket));
+  mTxPacketCount = 0;
+}
+
+// -----------------------------------------------------------------------------
+
+template<class Transport>
+inline UsbCable<Transport>::UsbCable(Transport& inTransport, byte inCable)
+  : mTransport(inTransport)
+  , mCable(inCable)
+{
+
+}
+
+/*! \brief Does nothing: the shared transport is started by the cable 0
+  interface (or by calling its begin method), which resets all cables.
+*/
+template<class Transport>
+inline void UsbCable<Transport>::begin(unsigned /*inBaudrate*/)
+{
+
+}
+
+template<class Transport>
+inline unsigned UsbCable<Transport>::available()
 {
-  mCurrentTxPacket.mPacket.header = 0;
-  mCurrentTxPacket.mPacket.byte1  = 0;
-  mCurrentTxPacket.mPacket.byte2  = 0;
-  mCurrentTxPacket.mPacket.byte3  = 0;
-  mCurrentTxPacketByteIndex = 0;
+  return mTransport.available(mCable);
 }
 
-template<unsigned BufferSize>
-inline byte UsbTransport<BufferSize>::encodePacketHeader(StatusByte inStatusByte)
+template<class Transport>
+inline byte UsbCable<Transport>::read()
 {
-  // todo: fix me for other types than channel
-  return inStatusByte >> 4;
+  return mTransport.read(mCable);
 }
 
-template<unsigned BufferSize>
-inline int UsbTransport<BufferSize>::getPacketLength(const midiEventPacket_t& inPacket)
+template<class Transport>
+inline void UsbCable<Transport>::write(byte inData)
 {
-  return 3;
+  mTransport.write(inData, mCable);
 }
 
 END_MIDI_NAMESPACE